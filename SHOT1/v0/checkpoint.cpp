@@ -0,0 +1,44 @@
+#include "checkpoint.h"
+#include "tiles.h"            // for tiles_t
+#include "extra/player.h"     // for player_t, player_state_t, get_player_state, set_player_state
+#include "extra/utility.h"    // for random_get_stream
+
+#include "../../common/random.h"           // for random_t
+#include "../../common/world_checkpoint.h" // for world_checkpoint_t, world_checkpoint_writer_t, WORLD_CHECKPOINT_ID
+
+
+static uint32_t const CHECKPOINT_APP = WORLD_CHECKPOINT_ID ('S', 'H', 'T', '1');
+static uint32_t const CHECKPOINT_LAYOUT = 1u; // bump when vector4, player_state_t or random_t change
+static uint32_t const CHECKPOINT_PLAYER = WORLD_CHECKPOINT_ID ('P', 'L', 'Y', 'R');
+static uint32_t const CHECKPOINT_RANDOM = WORLD_CHECKPOINT_ID ('R', 'A', 'N', 'D');
+
+
+bool checkpoint_save (char const* path, player_t const& player, tiles_t const& tiles)
+{
+  player_state_t const saved_player = get_player_state (player);
+
+  world_checkpoint_writer_t writer;
+  writer.add (CHECKPOINT_PLAYER, &saved_player, 1u);
+  writer.add (CHECKPOINT_RANDOM, &random_get_stream (), 1u);
+  tiles.save_checkpoint (writer);
+  return writer.write (path, CHECKPOINT_APP, CHECKPOINT_LAYOUT);
+}
+
+bool checkpoint_load (char const* path, player_t*& player, tiles_t& tiles)
+{
+  world_checkpoint_t checkpoint;
+  player_state_t loaded_player;
+  random_t random;
+  if (!checkpoint.open (path, CHECKPOINT_APP, CHECKPOINT_LAYOUT)
+    || !checkpoint.copy (CHECKPOINT_PLAYER, &loaded_player, 1u)
+    || (loaded_player.id != PLAYER_ID_NORMAL && loaded_player.id != PLAYER_ID_FAST)
+    || !checkpoint.copy (CHECKPOINT_RANDOM, &random, 1u)
+    || !tiles.load_checkpoint (checkpoint))
+  {
+    return false;
+  }
+
+  set_player_state (player, loaded_player);
+  random_get_stream () = random;
+  return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+
+struct player_t; // forward declare
+struct tiles_t;
+
+
+/// @brief write the player (with its points), every tile & the game's random number stream to a checkpoint
+/// the tile arrays are written straight from tiles_t, see common/world_checkpoint.h
+/// @return false if the file could not be written
+bool checkpoint_save (char const* path, player_t const& player, tiles_t const& tiles);
+
+/// @brief carry on from a checkpoint written by checkpoint_save, in place of the current player & tiles
+/// the file is mapped & each tile array is copied into tiles_t with a single memcpy, nothing is parsed or constructed per tile
+/// @param player replaced by a new player of the saved type
+/// @return false if the checkpoint could not be loaded (not a SHOT1 checkpoint, or saved with a different NUM_TILES),
+/// the world is then left as it was
+bool checkpoint_load (char const* path, player_t*& player, tiles_t& tiles);
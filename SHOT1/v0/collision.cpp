@@ -2,6 +2,9 @@
 #include "tiles.h"            // for tile_t
 #include "extra/player.h"     // for player_t
 #include "extra/walls.h"      // for wall_t
+#include "frame_context.h"    // for frame_context_t
+
+#include "../../common/frame_arena.h" // for frame_sub_arena_t, frame_vector_t
 
 
 /// @brief check whether 2 AABBs (axis-aligned bounding box) are overlapping
@@ -37,73 +40,136 @@ static bool is_overlapping (double lhs_position_x, double lhs_position_y, double
   // Hint: can you spot any wasted computations above?
 }
 
-void resolve_collisions (pigeon::gfx::spritesheet spritesheet,
+
+// DISPATCH
+//
+// Collision detection/resolution strategy:
+// 1. Test every pair of objects that can collide (player v tile, player v wall, tile v wall), adding each
+//    overlapping pair to the list of its combination of object types, e.g. (PLAYER_TYPE, TILE_TYPE).
+// 2. Look each list's handler up in COLLISION_HANDLERS, by the 2 object types, and hand it the whole list.
+//    A handler knows the types of both sides, so it resolves both without any casting or re-checking of types & ids,
+//    in one tight loop over its pairs.
+//
+// Every pair is found before any is resolved, which changes nothing: the player v tile pairs are resolved first
+// (as they always were) and only score the player & mark tiles eaten, the player v wall pairs only move the player
+// & the tile v wall pairs only move the tiles, so no response changes what another combination tested.
+
+/// @brief everything the batch handlers work on, each kind of object as its own type
+struct collision_world_t
+{
+  player_t&            player;
+  tiles_t&             tiles;
+  wall_t const* const* walls;       // [collision_pair_t::rhs]
+  texture_rect const&  player_rect; // looked up once a tick, rather than once a pair
+  texture_rect const&  tile_rect;
+};
+
+/// @brief resolves every pair of one combination of object types, both sides of each
+using collision_batch_handler_t = void (*) (collision_world_t& world, collision_pair_t const* pairs, size_t num_pairs);
+
+
+/// @brief PLAYER v TILE: the tiles are eaten & the player scores them, all at once
+static void resolve_player_tile (collision_world_t& world, collision_pair_t const* pairs, size_t num_pairs)
+{
+  for (size_t i = 0u; i < num_pairs; ++i)
+  {
+    world.tiles.on_eaten ((int)pairs [i].rhs);
+  }
+  world.player.on_tiles_eaten ((unsigned)num_pairs);
+}
+
+/// @brief PLAYER v WALL: the player is pushed back out, the wall does nothing
+static void resolve_player_wall (collision_world_t& world, collision_pair_t const* pairs, size_t num_pairs)
+{
+  for (size_t i = 0u; i < num_pairs; ++i)
+  {
+    world.player.on_wall_hit (*world.walls [pairs [i].rhs], world.player_rect);
+  }
+}
+
+/// @brief TILE v WALL: each tile is reflected & pushed back out, the walls do nothing
+static void resolve_tile_wall (collision_world_t& world, collision_pair_t const* pairs, size_t num_pairs)
+{
+  for (size_t i = 0u; i < num_pairs; ++i)
+  {
+    world.tiles.on_wall_hit ((int)pairs [i].lhs, *world.walls [pairs [i].rhs], world.tile_rect);
+  }
+}
+
+
+static_assert (PLAYER_TYPE == 0 && TILE_TYPE == 1 && WALL_TYPE == 2, "COLLISION_HANDLERS is laid out in object type order");
+
+/// @brief [lhs type][rhs type], nullptr where the combination is never tested
+static collision_batch_handler_t const COLLISION_HANDLERS [NUM_OBJECT_TYPES][NUM_OBJECT_TYPES] =
+{
+  //                 PLAYER_TYPE  TILE_TYPE            WALL_TYPE
+  /* PLAYER_TYPE */ { nullptr,    resolve_player_tile, resolve_player_wall },
+  /* TILE_TYPE   */ { nullptr,    nullptr,             resolve_tile_wall   }, // tile v tile is not tested, see below
+  /* WALL_TYPE   */ { nullptr,    nullptr,             nullptr             },
+};
+
+/// @brief the overlapping pairs of one combination of object types
+struct collision_batch_t
+{
+  object_type_t                     lhs_type;
+  object_type_t                     rhs_type;
+  frame_vector_t <collision_pair_t> pairs;
+};
+
+
+void resolve_collisions (pigeon::gfx::spritesheet& spritesheet,
   player_t& player,
   tiles_t& tiles,
-  walls_t& walls)
+  frame_context_t& frame)
 {
   // lhs = left hand side
   // rhs = right hand side
 
+  // the size of the player and of every tile, via their spritesheet size
+  texture_rect const* player_rect = get_player_texture_rect (spritesheet, player.get_id ());
+  texture_rect const* tile_rect = get_tile_texture_rect (spritesheet, tiles.get_id ());
 
-  /// Collison detection/resolution strategy:
-  /// e.g. for PLAYER v TILE
-  ///
-  /// lhs = player
-  /// rhs = individual tile
-  ///
-  /// 1. Iterate over all tiles.
-  /// 2. Check whether this player-tile pair overlap with eachother.
-  /// 3. Once we find an overlapping player-tile pair:
-  ///   Call on_collision for each object
-  ///   a. Tell player that it has collided with a TILE_TYPE object.
-  ///      Provide the player a way to access that tile's data.
-  ///      Currently, this is via a pointer to the individual tile,
-  ///      but after DOD, there will be such thing as a pointer to a single tile...
-  ///      Finally, pass the spritesheet so the player can get the tile's size. (All tile's have the same size, this seems a bit inefficient...)
-  ///   b. Tell tile that it has collided with a PLAYER_TYPE object...
-  ///
-  /// The 'on_collision' function 'resolves' the actual collision.
-  /// The 'on_collision' function only resolves the collison for the object it is called on,
-  /// so must be called twice, once on 'lhs' and again on 'rhs'.
-  ///
-  /// This same strategy in used in subsequent 'OBJECT A v OBJECT B' collision detection/resolution strategies.
+  // the pair lists are per frame scratch, given back (newest first) as they go out of scope, see common/frame_arena.h
+  frame_sub_arena_t& scratch = frame.arena.get (0u);
+  frame_vector_t <wall_t const*> walls (scratch);
+  walls.reserve (frame.walls.data.size ());
+  for (wall_t const& wall : frame.walls.data)
+  {
+    walls.push_back (&wall);
+  }
+  unsigned const num_walls = (unsigned)walls.size ();
+
+  collision_batch_t batches [] =
+  {
+    { PLAYER_TYPE, TILE_TYPE, frame_vector_t <collision_pair_t> (scratch) },
+    { PLAYER_TYPE, WALL_TYPE, frame_vector_t <collision_pair_t> (scratch) },
+    { TILE_TYPE,   WALL_TYPE, frame_vector_t <collision_pair_t> (scratch) },
+  };
+  frame_vector_t <collision_pair_t>& player_tile = batches [0].pairs;
+  frame_vector_t <collision_pair_t>& player_wall = batches [1].pairs;
+  frame_vector_t <collision_pair_t>& tile_wall = batches [2].pairs;
+  player_tile.reserve (NUM_TILES);
+  player_wall.reserve (num_walls);
+  tile_wall.reserve (2u * NUM_TILES); // a tile in a corner overlaps 2 walls
 
 
   // PLAYER v TILE
-  // get size of player and tile via their spritesheet size
-  for (int i = 0; i < NUM_TILES; ++i)
+  for (unsigned i = 0u; i < NUM_TILES; ++i)
   {
-    texture_rect const* lhs_rect = get_player_texture_rect (spritesheet, player.get_id ());
-    texture_rect const* rhs_rect = get_tile_texture_rect (spritesheet, tiles.get_id ());
-      
-    if (is_overlapping (player.position.x, player.position.y, lhs_rect->width, lhs_rect->height,
-    tiles.position[i].x, tiles.position[i].y, rhs_rect->width, rhs_rect->height))
+    if (is_overlapping (player.position.x, player.position.y, player_rect->width, player_rect->height,
+      tiles.position [i].x, tiles.position [i].y, tile_rect->width, tile_rect->height))
     {
-    player.on_collision (TILE_TYPE,   (void*)&tiles, spritesheet, i); // tell player it hit a tile
-    tiles.on_collision (PLAYER_TYPE, (void*)&player, spritesheet, i); // tell tile it hit the player
+      player_tile.push_back ({ 0u, i });
     }
-
   }
 
   // PLAYER v WALL
-  // lhs = player
-  // rhs = wall
+  for (unsigned w = 0u; w < num_walls; ++w)
   {
-    player_t* lhs = &player;
-    for (auto rhs_it = walls.data.begin (); rhs_it != walls.data.end (); rhs_it++) // for each wall
+    if (is_overlapping (player.position.x, player.position.y, player_rect->width, player_rect->height,
+      walls [w]->position.x, walls [w]->position.y, walls [w]->size, walls [w]->size))
     {
-      wall_t* rhs = &(*rhs_it);
-
-      // get size of player via their spritesheet size
-      texture_rect const* lhs_rect = get_player_texture_rect (spritesheet, lhs->get_id ());
-      for(int i = 0; i < NUM_TILES; ++i)
-      if (is_overlapping (lhs->position.x, lhs->position.y, lhs_rect->width, lhs_rect->height,
-        rhs->position.x, rhs->position.y, rhs->size, rhs->size))
-      {
-        lhs->on_collision (WALL_TYPE,   (void*)rhs, spritesheet, i); // tell player it hit a wall
-        rhs->on_collision (PLAYER_TYPE, (void*)lhs, spritesheet); // tell wall the player hit it
-      }
+      player_wall.push_back ({ 0u, w });
     }
   }
 
@@ -131,43 +197,27 @@ void resolve_collisions (pigeon::gfx::spritesheet spritesheet,
 
 
   // TILE v WALL
-  // lhs = tile
-  // rhs = wall
-  //
-  // after 'DOD'ing the tiles this code will need altering to reflect the new way
-  // in which we get tile data, i.e. via an index (0 --> NUM_TILES - 1)
-  // for convenience, feel free to comment out this code whilst testing
-  // however, PLEASE COME BACK TO UPDATE THIS CODE!!!
-  // if the tiles don't collide with the walls they will just fly away
-  // and that would be much of a demo then...
-  //for (auto lhs_it = tiles.; lhs_it != tiles.data.end (); lhs_it++) // for each tile
-  //{
-  //  tiles_t& lhs = *lhs_it;
-
-  //   /*get size of tile via their spritesheet size*/
-  // 
-
-  //}
-
-  for (int i = 0; i < NUM_TILES; ++i)
-  { 
-    texture_rect const* lhs_rect = get_tile_texture_rect (spritesheet, tiles.get_id ());
-    for (auto rhs_it = walls.data.begin (); rhs_it != walls.data.end (); rhs_it++) // for each wall
+  for (unsigned i = 0u; i < NUM_TILES; ++i)
+  {
+    for (unsigned w = 0u; w < num_walls; ++w)
     {
-      wall_t& rhs = *rhs_it;
-
-      if (is_overlapping (tiles.position[i].x, tiles.position[i].y, lhs_rect->width, lhs_rect->height,
-        rhs.position.x, rhs.position.y, rhs.size, rhs.size))
+      if (is_overlapping (tiles.position [i].x, tiles.position [i].y, tile_rect->width, tile_rect->height,
+        walls [w]->position.x, walls [w]->position.y, walls [w]->size, walls [w]->size))
       {
-        tiles.on_collision (WALL_TYPE, (void*)&rhs, spritesheet, i); // tell tile it hit a wall
-        rhs.on_collision (TILE_TYPE, (void*)&tiles, spritesheet); // tell wall a tile hit it
+        tile_wall.push_back ({ i, w });
       }
     }
   }
 
 
-
-  // Hint: that is a lot of getting object texture_rects...
-  // Do we really need all that info repeatedly every frame?
-  // Plus, how do we get that texture_rect? Is the underlying function quick?
+  // RESOLVE, a batch at a time
+  collision_world_t world { player, tiles, walls.data (), *player_rect, *tile_rect };
+  for (collision_batch_t const& batch : batches)
+  {
+    collision_batch_handler_t const handler = COLLISION_HANDLERS [batch.lhs_type][batch.rhs_type];
+    if (handler && !batch.pairs.empty ())
+    {
+      handler (world, batch.pairs.data (), batch.pairs.size ());
+    }
+  }
 }
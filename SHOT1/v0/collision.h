@@ -1,11 +1,27 @@
 #pragma once
 
 #include "pigeon/gfx/spritesheet.h"  // for pigeon::gfx::spritesheet
+#include "constants.h"               // for NUM_TILES
+
+#include <cstddef>                   // for size_t
 
 
 struct player_t; // forward declare
 struct tiles_t;
-struct walls_t;
+struct frame_context_t;
+
+
+/// @brief one overlapping pair of objects, each as an index into the objects of its type
+/// (the player is always 0, a tile is its index in tiles_t, a wall its place in walls_t)
+struct collision_pair_t
+{
+  unsigned lhs;
+  unsigned rhs;
+};
+
+/// @brief the most frame scratch resolve_collisions needs for its pair lists, see frame_context_t::arena
+/// (every tile eaten, every tile in a corner, the player in a corner)
+size_t const COLLISION_FRAME_BYTES = (NUM_TILES + 2u * NUM_TILES + 4u) * sizeof (collision_pair_t) + 3u * 64u;
 
 
 /// @brief 1. find overlapping game objects (player, tiles, walls)
@@ -13,7 +29,9 @@ struct walls_t;
 /// - i.e. make the 2 overlapping objects respond appropriately to hitting the other
 /// - this will differ for each object, i.e. the wall doesn't do anything if a tile hits it,
 ///     but the tile will have its velocity reflected.
-void resolve_collisions (pigeon::gfx::spritesheet spritesheet,
+/// The overlapping pairs are gathered into one list per combination of object types (on the frame's arena),
+/// then each list is resolved by its own typed batch handler, see collision.cpp.
+void resolve_collisions (pigeon::gfx::spritesheet& spritesheet,
   player_t& p,
   tiles_t& tiles,
-  walls_t& walls);
+  frame_context_t& frame);
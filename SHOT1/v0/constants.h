@@ -44,6 +44,7 @@ using object_type_t = int;//string veiw?
 object_type_t const PLAYER_TYPE (0);
 object_type_t const TILE_TYPE (1);
 object_type_t const WALL_TYPE (2);
+unsigned const NUM_OBJECT_TYPES = 3u; // object types are 0 to NUM_OBJECT_TYPES - 1, e.g. to index collision.cpp's dispatch table
 
 
 using object_id_t = int;
@@ -2,52 +2,53 @@
 
 #include "pigeon/systems/input/input.h"
 
-#include "../tiles.h" // for tile_t
 #include "walls.h"    // for wall_t
 
 #include <algorithm>  // for
 
 
-static void collision_resolve_player_wall (pigeon::gfx::spritesheet spritesheet, player_t* player, wall_t* wall)
+// PLAYER
+
+player_t::player_t (double position_x, double position_y, unsigned in_num_points)
+  : position { position_x, position_y, 0.0, 0.0 }
+  , previous_position { position }
+  , new_player_id {}
+  , num_points { in_num_points }
 {
-  // get the tiles spritesheet rect (position, width & height)
-  // this is to get the tile's size as required by the following code
-  texture_rect const* tex_rect = get_player_texture_rect (spritesheet, player->get_id ());
+}
 
+vector4 player_t::get_render_position (float alpha) const
+{
+  return { cuckoo::maths::lerp (previous_position.x, position.x, (double)alpha),
+    cuckoo::maths::lerp (previous_position.y, position.y, (double)alpha), 0.0, 0.0 };
+}
+
+void player_t::on_wall_hit (wall_t const& wall, texture_rect const& rect)
+{
   // position response
-  if (wall->get_id () == WALL_ID_LEFT)
+  if (wall.get_id () == WALL_ID_LEFT)
   {
-    player->position.x = wall->position.x + wall->size / 2.0;
-    player->position.x += (double)tex_rect->width / 2.0;
+    position.x = wall.position.x + wall.size / 2.0;
+    position.x += (double)rect.width / 2.0;
   }
-  else if (wall->get_id () == WALL_ID_RIGHT)
+  else if (wall.get_id () == WALL_ID_RIGHT)
   {
-    player->position.x = wall->position.x - wall->size / 2.0;
-    player->position.x -= (double)tex_rect->width / 2.0;
+    position.x = wall.position.x - wall.size / 2.0;
+    position.x -= (double)rect.width / 2.0;
   }
-  else if (wall->get_id () == WALL_ID_TOP)
+  else if (wall.get_id () == WALL_ID_TOP)
   {
-    player->position.y = wall->position.y - wall->size / 2.0;
-    player->position.y -= (double)tex_rect->height / 2.0;
+    position.y = wall.position.y - wall.size / 2.0;
+    position.y -= (double)rect.height / 2.0;
   }
-  else if (wall->get_id () == WALL_ID_BOTTOM)
+  else if (wall.get_id () == WALL_ID_BOTTOM)
   {
-    player->position.y = wall->position.y + wall->size / 2.0;
-    player->position.y += (double)tex_rect->height / 2.0;
+    position.y = wall.position.y + wall.size / 2.0;
+    position.y += (double)rect.height / 2.0;
   }
 }
 
 
-// PLAYER
-
-player_t::player_t (double position_x, double position_y, unsigned in_num_points)
-  : position { position_x, position_y, 0.0, 0.0 }
-  , new_player_id {}
-  , num_points { in_num_points }
-{
-}
-
-
 // PLAYER NORMAL
 
 player_normal_t::player_normal_t (double position_x, double position_y, unsigned in_num_points)
@@ -76,44 +77,27 @@ void player_normal_t::update (double elapsed, pigeon::gfx::spritesheet spriteshe
   }
 }
 void player_normal_t::render (pigeon::gfx::sprite_batch& sprite_batch,
-  pigeon::gfx::spritesheet spritesheet)
+  pigeon::gfx::spritesheet spritesheet, float alpha)
 {
   texture_rect const* tex_rect = get_player_texture_rect (spritesheet, get_id ());
   CUCKOO_ASSERT (tex_rect);
 
+  vector4 const render_position = get_render_position (alpha);
   sprite_batch.draw (*tex_rect,
-    (float)position.x, (float)position.y,
+    (float)render_position.x, (float)render_position.y,
     0.f,
     0.f, 0.f,
     (float)tex_rect->width, (float)tex_rect->height);
 }
 
-void player_normal_t::on_collision (object_type_t other_type, void* other_data, pigeon::gfx::spritesheet spritesheet, int index)
+void player_normal_t::on_tiles_eaten (unsigned num_tiles)
 {
-  if (other_type == WALL_TYPE)
-  {
-    // 'other_data' is a wall of some kind
-
-    // player has hit a wall, make the appropriate changes to player as a result of it
-    collision_resolve_player_wall (spritesheet, this, (wall_t*)other_data);
-  }
-  else if (other_type == TILE_TYPE)
-  {
-    // 'other_data' is a tile of some kind
-
-    // this tile has hit a tile, make the appropriate changes to this tile as a result of it
-    tiles_t* tile = (tiles_t*)other_data;
-    if (tile->get_id () == TILE_ID_NORMAL)
-    {
-      ++num_points;
-      if (num_points % PLAYER_FAST_POINTS_SWITCH == 0u)
-      {
-        new_player_id = PLAYER_ID_FAST;
-      }
-    }
-  }
-  else if (other_type == PLAYER_TYPE)
+  // a point a tile, turning fast on reaching any multiple of { PLAYER_FAST_POINTS_SWITCH }
+  unsigned const old_num_points = num_points;
+  num_points += num_tiles;
+  if (num_points / PLAYER_FAST_POINTS_SWITCH != old_num_points / PLAYER_FAST_POINTS_SWITCH)
   {
+    new_player_id = PLAYER_ID_FAST;
   }
 }
 object_id_t player_normal_t::get_id () const { return PLAYER_ID_NORMAL; }
@@ -155,41 +139,22 @@ void player_fast_t::update(double elapsed, pigeon::gfx::spritesheet spritesheet)
   }
 }
 void player_fast_t::render (pigeon::gfx::sprite_batch& sprite_batch,
-  pigeon::gfx::spritesheet spritesheet)
+  pigeon::gfx::spritesheet spritesheet, float alpha)
 {
   texture_rect const* tex_rect = get_player_texture_rect (spritesheet, get_id ());
   CUCKOO_ASSERT (tex_rect);
 
+  vector4 const render_position = get_render_position (alpha);
   sprite_batch.draw (*tex_rect,
-    (float)position.x, (float)position.y,
+    (float)render_position.x, (float)render_position.y,
     0.f,
     0.f, 0.f,
     (float)tex_rect->width, (float)tex_rect->height);
 }
 
-void player_fast_t::on_collision (object_type_t other_type, void* other_data, pigeon::gfx::spritesheet spritesheet, int index)
+void player_fast_t::on_tiles_eaten (unsigned num_tiles)
 {
-  if (other_type == WALL_TYPE)
-  {
-    // 'other_data' is a wall of some kind
-
-    // player has hit a wall, make the appropriate changes to player as a result of it
-    collision_resolve_player_wall (spritesheet, this, (wall_t*)other_data);
-  }
-  else if (other_type == TILE_TYPE)
-  {
-    // 'other_data' is a tile of some kind
-
-    // this tile has hit a tile, make the appropriate changes to this tile as a result of it
-    tiles_t* tile = (tiles_t*)other_data;
-    if (tile->get_id () == TILE_ID_NORMAL)
-    {
-      ++num_points;
-    }
-  }
-  else if (other_type == PLAYER_TYPE)
-  {
-  }
+  num_points += num_tiles;
 }
 object_id_t player_fast_t::get_id () const { return PLAYER_ID_FAST; }
 
@@ -209,15 +174,19 @@ void check_player_needs_replacing (player_t*& player)
   {
     vector4 const old_position = player->position;
     unsigned const old_num_pints = player->num_points;
+    vector4 const old_previous_position = player->previous_position;
     delete player;
     player = new player_fast_t (old_position.x, old_position.y, old_num_pints);
+    player->previous_position = old_previous_position; // carry on interpolating from where it was
   }
   else if (player->new_player_id == PLAYER_ID_NORMAL)
   {
     vector4 const old_position = player->position;
     unsigned const old_num_pints = player->num_points;
+    vector4 const old_previous_position = player->previous_position;
     delete player;
     player = new player_normal_t (old_position.x, old_position.y, old_num_pints);
+    player->previous_position = old_previous_position; // carry on interpolating from where it was
   }
 }
 
@@ -227,6 +196,37 @@ void release_player (player_t*& player)
   player = nullptr;
 }
 
+player_state_t get_player_state (player_t const& player)
+{
+  player_fast_t const* fast = player.get_id () == PLAYER_ID_FAST ? (player_fast_t const*)&player : nullptr;
+  return { player.get_id (), player.new_player_id, player.num_points, 0u,
+    player.position, player.previous_position, fast ? fast->get_lifetime () : 0.0 };
+}
+
+bool set_player_state (player_t*& player, player_state_t const& state)
+{
+  if (state.id != PLAYER_ID_NORMAL && state.id != PLAYER_ID_FAST)
+  {
+    return false;
+  }
+
+  delete player;
+  if (state.id == PLAYER_ID_FAST)
+  {
+    player_fast_t* fast = new player_fast_t (state.position.x, state.position.y, state.num_points);
+    fast->set_lifetime (state.lifetime);
+    player = fast;
+  }
+  else
+  {
+    player = new player_normal_t (state.position.x, state.position.y, state.num_points);
+  }
+  player->position = state.position;
+  player->previous_position = state.previous_position;
+  player->new_player_id = state.new_player_id;
+  return true;
+}
+
 
 texture_rect const* get_player_texture_rect (pigeon::gfx::spritesheet const& spritesheet, object_id_t id)
 {
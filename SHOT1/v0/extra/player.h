@@ -6,6 +6,8 @@
 #include "../constants.h"            // for object_type_t, object_id_t...
 #include "utility.h"                 // for vector4
 
+struct wall_t; // forward declare, see walls.h
+
 
 // PLAYER
 
@@ -17,20 +19,28 @@ public:
   virtual ~player_t () = default;
 
   virtual void update (double elapsed, pigeon::gfx::spritesheet spritesheet) = 0;
+  /// @param alpha where the display is between the previous tick (0) and the latest (1), see common/fixed_timestep.h
   virtual void render (pigeon::gfx::sprite_batch& sprite_batch,
-    pigeon::gfx::spritesheet spritesheet) = 0;
-
-  /// @brief the player has collided with something
-  /// check what type of object it is and resolve the collision appropriately
-  /// @param other_type the identifier of the other object
-  /// @param other_data pointer to some data, could be a tile or wall, or anything!
-  /// @param spritesheet spritesheet data, required to get size of other object
-  virtual void on_collision (object_type_t other_type, void* other_data, pigeon::gfx::spritesheet spritesheet, int index) = 0;
+    pigeon::gfx::spritesheet spritesheet, float alpha) = 0;
+
+  /// @brief the player has eaten 'num_tiles' tiles this tick, all at once (see collision.cpp)
+  virtual void on_tiles_eaten (unsigned num_tiles) = 0;
   virtual object_id_t get_id () const = 0;
 
+  /// @brief the player has run into 'wall', push it back out
+  /// @param rect the player's sub-sprite, whose size is the player's size in the game world
+  void on_wall_hit (wall_t const& wall, texture_rect const& rect);
+
+  /// @brief keep the current position as the previous tick's, before a fixed time step tick changes it
+  void begin_tick () { previous_position = position; }
+
+  /// @brief the position 'alpha' of the way from the previous tick's to the latest
+  vector4 get_render_position (float alpha) const;
+
 
 public:
   vector4 position;
+  vector4 previous_position; // at the end of the previous tick, only read by render
   object_id_t new_player_id;
   unsigned num_points;
 };
@@ -47,9 +57,9 @@ public:
 
   void update (double elapsed, pigeon::gfx::spritesheet spritesheet) override;
   void render (pigeon::gfx::sprite_batch& sprite_batch,
-    pigeon::gfx::spritesheet spritesheet) override;
+    pigeon::gfx::spritesheet spritesheet, float alpha) override;
 
-  void on_collision (object_type_t other_type, void* other_data, pigeon::gfx::spritesheet spritesheet, int index) override;
+  void on_tiles_eaten (unsigned num_tiles) override;
   object_id_t get_id () const override;
 };
 
@@ -67,11 +77,15 @@ public:
 
   void update (double elapsed, pigeon::gfx::spritesheet spritesheet) override;
   void render (pigeon::gfx::sprite_batch& sprite_batch,
-    pigeon::gfx::spritesheet spritesheet) override;
+    pigeon::gfx::spritesheet spritesheet, float alpha) override;
 
-  void on_collision (object_type_t other_type, void* other_data, pigeon::gfx::spritesheet spritesheet, int index) override;
+  void on_tiles_eaten (unsigned num_tiles) override;
   object_id_t get_id () const override;
 
+  /// @brief seconds left before reverting to player_normal, see player_state_t
+  double get_lifetime () const { return lifetime; }
+  void set_lifetime (double in_lifetime) { lifetime = in_lifetime; }
+
 
 private:
   double lifetime;
@@ -91,6 +105,26 @@ void check_player_needs_replacing (player_t*& player);
 void release_player (player_t*& player);
 
 
+/// @brief everything needed to recreate a player, as plain data (see checkpoint.h & rollback.h)
+struct player_state_t
+{
+  object_id_t id;                 // PLAYER_ID_NORMAL or PLAYER_ID_FAST
+  object_id_t new_player_id;
+  unsigned    num_points;
+  unsigned    reserved;
+  vector4     position;
+  vector4     previous_position;
+  double      lifetime;           // player_fast_t only
+};
+
+/// @brief capture the player as plain data
+player_state_t get_player_state (player_t const& player);
+
+/// @brief replace the player with a new one of the captured kind & state
+/// @return false if 'state' is not of a known kind of player, the player is then left as it was
+bool set_player_state (player_t*& player, player_state_t const& state);
+
+
 /// @brief search the spritesheet for the sub-sprite associated with a particular type of plater
 /// NOTE: this app uses the size of the sub-sprite as the size of the object in the game world.
 /// @return a pointer to the texture_rect of the object's sub-sprite on the spritesheet
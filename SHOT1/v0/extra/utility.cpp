@@ -2,17 +2,37 @@
 
 #include "cuckoo/core/asserts.h" // for CUCKOO_ASSERT
 
-#include <cstdlib>               // for rand
+#include "../../../common/random.h" // for random_t
 
 
+/// @brief the game's random number stream, only ever used from the main thread
+static random_t& random_stream (void)
+{
+  static random_t random = []
+  {
+    random_t r;
+    random_seed (r, 0u);
+    return r;
+  } ();
+  return random;
+}
+
+void random_set_seed (unsigned long long seed)
+{
+  random_seed (random_stream (), seed);
+}
+
+random_t& random_get_stream ()
+{
+  return random_stream ();
+}
+
 double random_getd (double min, double max)
 {
   CUCKOO_ASSERT (max > min);
 
 
-  double const random = (double)rand () / (double)RAND_MAX;
-  double const range = max - min;
-  return (random * range) + min;
+  return random_getd (random_stream (), min, max);
 }
 
 float convert_km_to_miles (float km) { return km * 0.621371f; }
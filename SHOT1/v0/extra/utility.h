@@ -1,5 +1,7 @@
 #pragma once
 
+struct random_t; // forward declare, see common/random.h
+
 
 struct vector4
 {
@@ -10,10 +12,16 @@ struct vector4
 };
 
 
+/// @brief restart the game's random number stream, the same seed always gives the same game
+void random_set_seed (unsigned long long seed);
+
 /// @brief get a number between min and max (inclusive)
 /// @param min minimum random number (inclusive)
 /// @param max maximum random number (inclusive)
 /// @return random number between min & max (inclusive)
 double random_getd (double min, double max);
 
+/// @brief the game's random number stream itself, e.g. to save & restore it with a checkpoint
+random_t& random_get_stream ();
+
 float convert_km_to_miles (float km);
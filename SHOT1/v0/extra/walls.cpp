@@ -27,7 +27,6 @@ void wall_t::render (pigeon::gfx::sprite_batch& sprite_batch,
   }
 }
 
-void wall_t::on_collision (object_type_t other_type, void* other_data, pigeon::gfx::spritesheet spritesheet) {}
 object_id_t wall_t::get_id () const { return id; }
 
 
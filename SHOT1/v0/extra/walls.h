@@ -18,12 +18,7 @@ public:
   void render (pigeon::gfx::sprite_batch& sprite_batch,
     pigeon::gfx::spritesheet spritesheet);
 
-  /// @brief the wall has collided with something
-  /// check what type of object it is and resolve the collision appropriately
-  /// @param other_type the identifier of the other object
-  /// @param other_data pointer to some data, could be a tile, a player, or anything!
-  /// @param spritesheet spritesheet data, required to get size of other object
-  void on_collision (object_type_t other_type, void* other_data, pigeon::gfx::spritesheet spritesheet);
+  // walls do not respond to being hit, see collision.cpp
   object_id_t get_id () const;
 
 
@@ -0,0 +1,33 @@
+#include "frame_context.h"
+#include "collision.h"     // for COLLISION_FRAME_BYTES
+
+#include "pigeon/gfx/driver.h" // for pigeon::gfx::driver::get_screen_size
+
+
+void frame_context_capture (frame_context_t& frame)
+{
+  auto const screen_size = pigeon::gfx::driver::get_screen_size ();
+  vector4 const window_size = { (double)screen_size.x, (double)screen_size.y, 0.0, 0.0 };
+
+  // allocated along with the first walls, from then on only reset
+  if (frame.walls.data.empty ())
+  {
+    frame.arena.initialise (COLLISION_FRAME_BYTES, 1u);
+  }
+  frame.arena.reset ();
+
+  if (!frame.walls.data.empty () && window_size.x == frame.window_size.x && window_size.y == frame.window_size.y)
+  {
+    return;
+  }
+
+  frame.window_size = window_size;
+  release_walls (frame.walls);
+  frame.walls = initialise_walls (window_size);
+}
+
+void frame_context_release (frame_context_t& frame)
+{
+  release_walls (frame.walls);
+  frame.arena.release ();
+}
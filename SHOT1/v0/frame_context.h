@@ -0,0 +1,27 @@
+#pragma once
+
+#include "extra/utility.h"  // for vector4
+#include "extra/walls.h"    // for walls_t
+
+#include "../../common/frame_arena.h" // for frame_arena_t
+
+
+/// @brief everything the game needs to know about the screen, captured once per frame
+/// and passed to the update, collision & render code, rather than each of them asking the driver for it
+struct frame_context_t
+{
+  vector4 window_size = {};
+
+  // derived from the window size, only rebuilt when it changes
+  walls_t walls;
+
+  // scratch memory for this frame only, e.g. resolve_collisions' pair lists, see common/frame_arena.h
+  frame_arena_t arena;
+};
+
+/// @brief capture this frame's window size & take back the previous frame's scratch memory
+/// the walls are only rebuilt if the window size has changed
+void frame_context_capture (frame_context_t& frame);
+
+/// @brief post game loop tear down code
+void frame_context_release (frame_context_t& frame);
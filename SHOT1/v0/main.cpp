@@ -88,7 +88,17 @@
 #include "extra/player.h"            // for player_t
 #include "extra/walls.h"             // for walls_t
 #include "Timer.h"                   // for timer class
-#include <cstdlib>                   // for srand                  
+#include "frame_context.h"           // for frame_context_t
+#include "checkpoint.h"              // for checkpoint_load, checkpoint_save
+#include "rollback.h"                // for rollback_ring_t
+#include "../../common/telemetry_log.h" // for telemetry_log, TELEMETRY_LOG
+#include "../../common/trace.h"         // for trace_start, trace_write, TRACE_ZONE
+#include "../../common/perf_counters.h" // for perf_profile, perf_zone_t
+#include "../../common/fixed_timestep.h" // for fixed_timestep_t, fixed_timestep_from_environment
+#define ALLOC_TRACKER_IMPLEMENTATION    // the counting operators new & delete live here
+#include "../../common/alloc_tracker.h" // for alloc_tracker, ALLOC_ZONE
+#include <cstdio>                    // for std::fopen, std::fclose, FILE
+#include <cstdlib>                   // for srand, std::getenv, std::strtoul
 
 
 ENTRY_POINT
@@ -127,12 +137,21 @@ ENTRY_POINT
 
   // SETUP
 
+  random_set_seed (0u);
+
   player_t* player;
   initialise_player(player);
 
   tiles_t tiles;
   initialise_tiles(tiles);
 
+  // start from a saved world with SHOT_CHECKPOINT_LOAD, save the final one to SHOT_CHECKPOINT_SAVE, see common/world_checkpoint.h
+  if (char const* checkpoint_path = std::getenv("SHOT_CHECKPOINT_LOAD"))
+  {
+      bool const is_loaded = checkpoint_load(checkpoint_path, player, tiles);
+      cuckoo::printf("checkpoint: %s %s\n", is_loaded ? "loaded from" : "FAILED to load", checkpoint_path);
+  }
+
   pigeon::gfx::spritesheet spritesheet = {};
   if (!spritesheet.initialise("data/textures/SHOT1/sprites.xml"))
   {
@@ -154,19 +173,71 @@ ENTRY_POINT
       }
   }
 
+  // the per-frame output is written out by the telemetry log's own thread, to SHOT_LOG_FILE if set, otherwise as before
+  FILE* log_file = std::getenv("SHOT_LOG_FILE") ? std::fopen(std::getenv("SHOT_LOG_FILE"), "w") : nullptr;
+  if (log_file)
+  {
+      telemetry_log.start(telemetry_log_t::file_sink, log_file);
+  }
+  else
+  {
+      telemetry_log.start([](char const* text, void*) { cuckoo::printf("%s", text); }, nullptr);
+  }
+
+  // a timeline of the frame's work, written to SHOT_TRACE (if set) on exit, see common/trace.h
+  char const* trace_path = std::getenv("SHOT_TRACE");
+  if (trace_path)
+  {
+      trace_set_lane(TRACE_LANE_MAIN, "main");
+      trace_start(1u << 20);
+  }
+
+  // hardware counters (cache & branch misses, IPC) per tile, with SHOT_PERF set, see common/perf_counters.h
+  if (std::getenv("SHOT_PERF") && !perf_profile.open())
+  {
+      cuckoo::printf("perf: no counters could be opened (see /proc/sys/kernel/perf_event_paranoid)\n");
+  }
+
+  // heap allocations per frame & zone with SHOT_ALLOC set, SHOT_ZERO_ALLOC=N asserts on any after N frames, see common/alloc_tracker.h
+  alloc_tracker.set_reporting(std::getenv("SHOT_ALLOC") != nullptr);
+  if (char const* warmup_frames = std::getenv("SHOT_ZERO_ALLOC"))
+  {
+      alloc_tracker.enforce_after((unsigned)std::strtoul(warmup_frames, nullptr, 10));
+  }
+
   timer FrameTimer;
 
+  frame_context_t frame_context;
+
+  // the simulation advances in fixed ticks, SHOT_TICK_RATE a second, see common/fixed_timestep.h
+  fixed_timestep_t timestep = fixed_timestep_from_environment();
+
+  // the last SHOT_ROLLBACK ticks kept as keyframes every SHOT_ROLLBACK_KEYFRAME ticks & deltas, see rollback.h
+  // SHOT_ROLLBACK_REWIND=N goes back to the oldest of them every N ticks & simulates on from there
+  rollback_ring_t rollback;
+  unsigned rollback_rewind_ticks = 0u;
+  if (char const* rollback_ticks = std::getenv("SHOT_ROLLBACK"))
+  {
+      char const* keyframe_ticks = std::getenv("SHOT_ROLLBACK_KEYFRAME");
+      rollback.initialise((unsigned)std::strtoul(rollback_ticks, nullptr, 10), keyframe_ticks ? (unsigned)std::strtoul(keyframe_ticks, nullptr, 10) : 30u);
+      char const* rewind_ticks = std::getenv("SHOT_ROLLBACK_REWIND");
+      rollback_rewind_ticks = rewind_ticks ? (unsigned)std::strtoul(rewind_ticks, nullptr, 10) : 0u;
+      cuckoo::printf("rollback: %.1f MB reserved\n", (double)rollback.get_reserved_bytes() / (1024.0 * 1024.0));
+  }
+
 
 
   FrameTimer.start_timer();  // start frame timer, have really small first frame elapsed seconds, rather than an unknown time
   // GAME LOOP
   while (pigeon::gfx::driver::process_os_messages())
   {
+      TRACE_ZONE("frame");
+
       FrameTimer.end_timer();
       float elapsed_seconds = FrameTimer.get_elapsed_time_secs();//end timer
 
       FrameTimer.start_timer(); // start frame timer
-      cuckoo::printf("FrameTime : %.5f seconds\n", elapsed_seconds);
+      TELEMETRY_LOG(0u, "FrameTime : %.5f seconds\n", elapsed_seconds);
 
       float average_time;//working out average time
       int frames_passed = 0;
@@ -176,7 +247,7 @@ ENTRY_POINT
       if (frames_passed < 100)
       {
           average_time = elapsed_seconds / frames_passed;
-          cuckoo::printf("AverageTime : %.5f seconds\n", average_time);
+          TELEMETRY_LOG(0u, "AverageTime : %.5f seconds\n", average_time);
       }
 
 
@@ -187,23 +258,57 @@ ENTRY_POINT
 
     // UPDATE
     {
-        // PLAYER
-        {
-          player->update(elapsed_seconds, spritesheet);
-        }
+        TRACE_ZONE("update");
+        ALLOC_ZONE("update");
 
-        // TILES
-        tiles.update(elapsed_seconds);
+        // screen size & walls, once per frame
+        frame_context_capture(frame_context);
 
-        // COLLISIONS
+        // as many fixed ticks as this frame's time allows, up to the catch-up cap
+        unsigned const num_ticks = timestep.advance(elapsed_seconds);
+        double const tick_seconds = timestep.get_tick_seconds();
+        for (unsigned tick = 0u; tick < num_ticks; ++tick)
         {
-            vector4 window_size = { (double)pigeon::gfx::driver::get_screen_size().x, (double)pigeon::gfx::driver::get_screen_size().y, 0.0, 0.0 };
-            walls_t walls = initialise_walls(window_size);
-            resolve_collisions(spritesheet, *player, tiles, walls);
-            release_walls(walls);
+          TRACE_ZONE("tick");
+
+          // render interpolates from here
+          player->begin_tick();
+          tiles.begin_tick();
+
+          // PLAYER
+          {
+            player->update(tick_seconds, spritesheet);
+          }
+
+          // TILES
+          {
+              TRACE_ZONE("tiles");
+              ALLOC_ZONE("tiles");
+              perf_zone_t const perf_zone("tiles", NUM_TILES);
+              tiles.update(tick_seconds);
+          }
+
+          // COLLISIONS
+          {
+              TRACE_ZONE("collisions");
+              ALLOC_ZONE("collisions");
+              perf_zone_t const perf_zone("collisions", NUM_TILES);
+              resolve_collisions(spritesheet, *player, tiles, frame_context);
+          }
+          check_player_needs_replacing(player);
+          tiles = replace_expired_tiles(tiles);
+
+          if (rollback.is_enabled())
+          {
+              TRACE_ZONE("rollback");
+              unsigned long long const recorded_tick = rollback.record(*player, tiles, tick_seconds);
+              unsigned long long first_tick, last_tick;
+              if (rollback_rewind_ticks > 0u && (recorded_tick + 1u) % rollback_rewind_ticks == 0u && rollback.get_window(first_tick, last_tick))
+              {
+                  rollback.restore(first_tick, player, tiles);
+              }
+          }
         }
-        check_player_needs_replacing(player);
-        tiles = replace_expired_tiles(tiles);
       }
 
 
@@ -228,9 +333,17 @@ ENTRY_POINT
             ////////////////////////////////////////////////
 
 
+            // (until the end of the frame, so this includes submitting the batch)
+            TRACE_ZONE("render");
+            ALLOC_ZONE("render");
+            perf_zone_t const perf_zone("render", NUM_TILES);
+
+            // where the display is between the last 2 ticks
+            float const alpha = (float)timestep.get_alpha();
+
             // PLAYER
             {
-                player->render(sprite_batch, spritesheet);
+                player->render(sprite_batch, spritesheet, alpha);
             }
 
             // TILES
@@ -239,17 +352,14 @@ ENTRY_POINT
                 // e.g. vectors, lists and maps // https://en.cppreference.com/w/cpp/container
                 // iterators are 'special' in that they can be incremented to go to the next element in the collection
                 // (even if it is not physically next to it in memory // https://en.cppreference.com/w/cpp/iterator)
-                tiles.render(sprite_batch, spritesheet);
+                tiles.render(sprite_batch, spritesheet, alpha);
 
                 // WALLS
                 {
-                    vector4 window_size = { (double)pigeon::gfx::driver::get_screen_size().x, (double)pigeon::gfx::driver::get_screen_size().y, 0.0, 0.0 };
-                    walls_t walls = initialise_walls(window_size);
-                    for (auto& wall : walls.data)
+                    for (auto& wall : frame_context.walls.data)
                     {
                         wall.render(sprite_batch, spritesheet);
                     }
-                    release_walls(walls);
                 }
 
 
@@ -270,6 +380,12 @@ ENTRY_POINT
 
     }
 
+    perf_profile.end_frame();
+    if (!alloc_tracker.end_frame())
+    {
+        telemetry_log.stop(); // so what allocated is written out first
+        CUCKOO_ASSERT(!"the game loop allocated, see SHOT_ZERO_ALLOC");
+    }
             } // GAME LOOP: END
 
 
@@ -277,7 +393,42 @@ ENTRY_POINT
             {
                 sprite_batch.release();//release what you have used in reverse order
                 spritesheet.release();
+                if (char const* checkpoint_path = std::getenv("SHOT_CHECKPOINT_SAVE"))
+                {
+                    bool const is_saved = checkpoint_save(checkpoint_path, *player, tiles);
+                    cuckoo::printf("checkpoint: %s %s\n", is_saved ? "saved to" : "FAILED to save", checkpoint_path);
+                }
                 release_player(player);
+                frame_context_release(frame_context);
+
+                if (rollback.is_enabled())
+                {
+                    rollback_stats_t const& stats = rollback.get_stats();
+                    cuckoo::printf("rollback: %llu ticks recorded, %llu keyframes, %.1f tiles patched a tick, %.3f ms a record, %llu restores at %.3f ms\n",
+                        stats.num_records, stats.num_keyframes, stats.num_records ? (double)stats.num_patches / (double)stats.num_records : 0.0,
+                        stats.num_records ? stats.record_seconds * 1000.0 / (double)stats.num_records : 0.0,
+                        stats.num_restores, stats.num_restores ? stats.restore_seconds * 1000.0 / (double)stats.num_restores : 0.0);
+                    rollback.release();
+                }
+
+                if (perf_profile.is_enabled())
+                {
+                    perf_profile.report([](char const* text, void*) { cuckoo::printf("%s", text); }, nullptr);
+                    perf_profile.close();
+                }
+
+                if (trace_path)
+                {
+                    trace_stop();
+                    cuckoo::printf("trace: %s %s\n", trace_write(trace_path, "SHOT1") ? "written to" : "FAILED to write", trace_path);
+                }
+
+                // write out whatever is still queued
+                telemetry_log.stop();
+                if (log_file)
+                {
+                    std::fclose(log_file);
+                }
 
 
               pigeon::gfx::driver::release();
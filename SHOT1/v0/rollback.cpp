@@ -0,0 +1,282 @@
+#include "rollback.h"
+
+#include <chrono>                      // for std::chrono::steady_clock
+#include <cstring>                     // for std::memcmp
+
+
+static double seconds_since (std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration <double> (std::chrono::steady_clock::now () - start).count ();
+}
+
+static unsigned const ROLLBACK_COMPARE_BLOCK = 16u; // tiles
+
+/// @brief bitwise, so -0 & 0 differ and a NaN is the same as itself
+template <typename value_t>
+static bool is_same_bits (value_t const* a, value_t const* b, unsigned count)
+{
+  return std::memcmp (a, b, count * sizeof (value_t)) == 0;
+}
+
+
+// SET UP
+
+void rollback_ring_t::initialise (unsigned num_ticks, unsigned keyframe_interval_, unsigned long long max_patches)
+{
+  release ();
+  if (num_ticks == 0u)
+  {
+    return;
+  }
+
+  keyframe_interval = keyframe_interval_ > 0u ? keyframe_interval_ : 1u;
+
+  // one keyframe span more than asked for, so evicting the oldest span always leaves 'num_ticks'
+  unsigned const num_entries = num_ticks + keyframe_interval;
+  entries.resize (num_entries);
+
+  // the spans in the window, plus the one being started
+  unsigned const num_keyframes = (num_entries + keyframe_interval - 1u) / keyframe_interval + 1u;
+  keyframes.resize (num_keyframes);
+  for (std::unique_ptr <tiles_t>& keyframe : keyframes)
+  {
+    keyframe.reset (new tiles_t);
+  }
+  keyframe_ticks.resize (num_keyframes, 0u);
+  reconstruction.reset (new tiles_t);
+
+  patches.resize (max_patches > 0u ? max_patches : (unsigned long long)num_entries * (NUM_TILES / 64u + 1u));
+}
+
+void rollback_ring_t::release ()
+{
+  entries.clear ();
+  entries.shrink_to_fit ();
+  keyframes.clear ();
+  keyframes.shrink_to_fit ();
+  keyframe_ticks.clear ();
+  keyframe_ticks.shrink_to_fit ();
+  patches.clear ();
+  patches.shrink_to_fit ();
+  reconstruction.reset ();
+
+  next_keyframe_slot = 0u;
+  num_live_keyframes = 0u;
+  first_tick = 0u;
+  next_tick = 0u;
+  last_keyframe_tick = 0u;
+  next_patch = 0u;
+  stats = {};
+}
+
+size_t rollback_ring_t::get_reserved_bytes () const
+{
+  return entries.capacity () * sizeof (rollback_entry_t)
+    + (keyframes.size () + (reconstruction ? 1u : 0u)) * sizeof (tiles_t)
+    + patches.capacity () * sizeof (rollback_tile_patch_t);
+}
+
+
+// RECORD
+
+bool rollback_ring_t::evict_oldest_keyframe ()
+{
+  if (num_live_keyframes <= 1u)
+  {
+    return false;
+  }
+
+  unsigned const num_slots = (unsigned)keyframes.size ();
+  unsigned const next_oldest_slot = (next_keyframe_slot + num_slots - num_live_keyframes + 1u) % num_slots;
+  first_tick = keyframe_ticks [next_oldest_slot];
+  --num_live_keyframes;
+  return true;
+}
+
+bool rollback_ring_t::record_patches (rollback_entry_t& recorded, tiles_t const& tiles)
+{
+  // move the reconstruction on exactly as the tick moved the tiles, anything else the tick did shows up as a difference
+  tiles_t& rebuilt = *reconstruction;
+  rebuilt.begin_tick ();
+  rebuilt.update (recorded.tick_seconds);
+
+  for (unsigned i = 0u; i < NUM_TILES; ++i)
+  {
+    // most tiles only moved, so whole blocks of them are skipped with a few wide compares
+    if (i % ROLLBACK_COMPARE_BLOCK == 0u)
+    {
+      unsigned const count = NUM_TILES - i < ROLLBACK_COMPARE_BLOCK ? NUM_TILES - i : ROLLBACK_COMPARE_BLOCK;
+      if (is_same_bits (rebuilt.position + i, tiles.position + i, count)
+        && is_same_bits (rebuilt.direction + i, tiles.direction + i, count)
+        && is_same_bits (rebuilt.angle_radians + i, tiles.angle_radians + i, count)
+        && is_same_bits (rebuilt.previous_position + i, tiles.previous_position + i, count)
+        && is_same_bits (rebuilt.previous_angle_radians + i, tiles.previous_angle_radians + i, count)
+        && is_same_bits (rebuilt.is_eaten + i, tiles.is_eaten + i, count))
+      {
+        i += count - 1u;
+        continue;
+      }
+    }
+    if (is_same_bits (&rebuilt.position [i], &tiles.position [i], 1u)
+      && is_same_bits (&rebuilt.direction [i], &tiles.direction [i], 1u)
+      && is_same_bits (&rebuilt.angle_radians [i], &tiles.angle_radians [i], 1u)
+      && is_same_bits (&rebuilt.previous_position [i], &tiles.previous_position [i], 1u)
+      && is_same_bits (&rebuilt.previous_angle_radians [i], &tiles.previous_angle_radians [i], 1u)
+      && rebuilt.is_eaten [i] == tiles.is_eaten [i])
+    {
+      continue;
+    }
+
+    // make room, a whole keyframe span at a time, but never from under the span being recorded
+    while (next_patch - entry (first_tick).first_patch >= patches.size ())
+    {
+      if (!evict_oldest_keyframe ())
+      {
+        return false;
+      }
+    }
+
+    rollback_tile_patch_t& patch = patches [next_patch % patches.size ()];
+    patch.position = tiles.position [i];
+    patch.direction = tiles.direction [i];
+    patch.previous_position = tiles.previous_position [i];
+    patch.angle_radians = tiles.angle_radians [i];
+    patch.previous_angle_radians = tiles.previous_angle_radians [i];
+    patch.index = i;
+    patch.is_eaten = tiles.is_eaten [i];
+    ++next_patch;
+    ++recorded.num_patches;
+
+    rebuilt.position [i] = tiles.position [i];
+    rebuilt.direction [i] = tiles.direction [i];
+    rebuilt.previous_position [i] = tiles.previous_position [i];
+    rebuilt.angle_radians [i] = tiles.angle_radians [i];
+    rebuilt.previous_angle_radians [i] = tiles.previous_angle_radians [i];
+    rebuilt.is_eaten [i] = tiles.is_eaten [i];
+  }
+  return true;
+}
+
+unsigned long long rollback_ring_t::record (player_t const& player, tiles_t const& tiles, double tick_seconds)
+{
+  auto const start = std::chrono::steady_clock::now ();
+  unsigned long long const tick = next_tick;
+
+  // the oldest span goes once the window is full
+  if (num_live_keyframes > 0u && tick - first_tick >= entries.size ())
+  {
+    evict_oldest_keyframe ();
+  }
+
+  rollback_entry_t& recorded = entry (tick);
+  recorded.tick = tick;
+  recorded.first_patch = next_patch;
+  recorded.num_patches = 0u;
+  recorded.tick_seconds = tick_seconds;
+  recorded.player = get_player_state (player);
+  recorded.random = random_get_stream ();
+
+  bool is_keyframe = num_live_keyframes == 0u || tick - last_keyframe_tick >= keyframe_interval;
+  if (!is_keyframe)
+  {
+    recorded.keyframe_tick = last_keyframe_tick;
+    recorded.keyframe_slot = (next_keyframe_slot + (unsigned)keyframes.size () - 1u) % (unsigned)keyframes.size ();
+    if (!record_patches (recorded, tiles))
+    {
+      // more changed than the patches can hold, a keyframe is cheaper anyway
+      next_patch = recorded.first_patch;
+      recorded.num_patches = 0u;
+      is_keyframe = true;
+    }
+  }
+
+  if (is_keyframe)
+  {
+    if (num_live_keyframes == keyframes.size ())
+    {
+      evict_oldest_keyframe ();
+    }
+    unsigned const slot = next_keyframe_slot;
+    *keyframes [slot] = tiles;
+    *reconstruction = tiles;
+    keyframe_ticks [slot] = tick;
+    next_keyframe_slot = (slot + 1u) % (unsigned)keyframes.size ();
+    ++num_live_keyframes;
+    last_keyframe_tick = tick;
+
+    recorded.keyframe_tick = tick;
+    recorded.keyframe_slot = slot;
+    ++stats.num_keyframes;
+  }
+  if (num_live_keyframes == 1u)
+  {
+    first_tick = last_keyframe_tick;
+  }
+
+  next_tick = tick + 1u;
+  ++stats.num_records;
+  stats.num_patches += recorded.num_patches;
+  stats.record_seconds += seconds_since (start);
+  return tick;
+}
+
+
+// RESTORE
+
+bool rollback_ring_t::get_window (unsigned long long& first, unsigned long long& last) const
+{
+  if (num_live_keyframes == 0u)
+  {
+    return false;
+  }
+  first = first_tick;
+  last = next_tick - 1u;
+  return true;
+}
+
+bool rollback_ring_t::restore (unsigned long long tick, player_t*& player, tiles_t& tiles)
+{
+  if (num_live_keyframes == 0u || tick < first_tick || tick >= next_tick)
+  {
+    return false;
+  }
+  auto const start = std::chrono::steady_clock::now ();
+
+  // the keyframe, then every tick after it as it was recorded
+  rollback_entry_t const& restored = entry (tick);
+  tiles = *keyframes [restored.keyframe_slot];
+  for (unsigned long long replayed = restored.keyframe_tick + 1u; replayed <= tick; ++replayed)
+  {
+    rollback_entry_t const& delta = entry (replayed);
+    tiles.begin_tick ();
+    tiles.update (delta.tick_seconds);
+    for (unsigned long long p = delta.first_patch; p < delta.first_patch + delta.num_patches; ++p)
+    {
+      rollback_tile_patch_t const& patch = patches [p % patches.size ()];
+      unsigned const i = patch.index;
+      tiles.position [i] = patch.position;
+      tiles.direction [i] = patch.direction;
+      tiles.previous_position [i] = patch.previous_position;
+      tiles.angle_radians [i] = patch.angle_radians;
+      tiles.previous_angle_radians [i] = patch.previous_angle_radians;
+      tiles.is_eaten [i] = patch.is_eaten;
+    }
+  }
+  *reconstruction = tiles;
+
+  set_player_state (player, restored.player);
+  random_get_stream () = restored.random;
+
+  // forget everything after 'tick', including the keyframes it is not built on
+  unsigned const num_slots = (unsigned)keyframes.size ();
+  unsigned const oldest_slot = (next_keyframe_slot + num_slots - num_live_keyframes) % num_slots;
+  num_live_keyframes = (restored.keyframe_slot + num_slots - oldest_slot) % num_slots + 1u;
+  next_keyframe_slot = (restored.keyframe_slot + 1u) % num_slots;
+  last_keyframe_tick = restored.keyframe_tick;
+  next_patch = restored.first_patch + restored.num_patches;
+  next_tick = tick + 1u;
+
+  ++stats.num_restores;
+  stats.restore_seconds += seconds_since (start);
+  return true;
+}
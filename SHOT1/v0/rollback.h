@@ -0,0 +1,128 @@
+#pragma once
+
+// ROLLBACK:
+//
+// Keeps the last N ticks of the world in a preallocated ring, so any of them can be restored & simulated forward again
+// (to scrub back through a replay, or to try something different from a moment ago).
+// A full copy of every tile each tick would cost more than the tick itself, so the ring stores:
+//   keyframe | every 'keyframe_interval' ticks, a full copy of tiles_t (one memcpy)
+//   delta    | every other tick, only the tiles that did not simply carry on moving: the ones that bounced off a wall
+//            | or were eaten & replaced, as whole tile records (rollback_tile_patch_t), plus the player & the random stream
+// The ring keeps its own copy of the world as it would be restored (the reconstruction): each tick it is moved on with
+// tiles_t::update, exactly as the game moves the tiles, and compared with the real tiles; a tile that differs is
+// recorded as a patch & copied across. So a delta is only as big as what collisions changed, and restoring replays
+// the keyframe through the same update with the patches applied, giving back exactly the recorded bits.
+// So recording a tick costs about one more tiles_t::update & a compare, plus a copy of tiles_t on keyframe ticks:
+// at NUM_TILES = 1 << 10, ~0.014 ms against ~0.12 ms for the tick itself, ~3 tiles patched a tick;
+// at 1 << 20, ~40 ms against ~200 ms, ~3800 tiles patched a tick, & each keyframe is a 105 MB copy
+// (so there, a longer SHOT_ROLLBACK_KEYFRAME trades restore time for memory, see main.cpp).
+// Input is not recorded: what follows a restore is simulated from whatever input is given then.
+
+#include "tiles.h"                     // for tiles_t
+#include "extra/player.h"              // for player_t, player_state_t
+#include "extra/utility.h"             // for vector4
+
+#include "../../common/random.h"       // for random_t
+
+#include <memory>                      // for std::unique_ptr
+#include <vector>                      // for std::vector
+
+
+/// @brief one tile that a delta overwrites, whole
+struct rollback_tile_patch_t
+{
+  vector4  position;
+  vector4  direction;
+  vector4  previous_position;
+  float    angle_radians;
+  float    previous_angle_radians;
+  unsigned index;
+  bool     is_eaten;
+};
+
+/// @brief what the ring holds for one tick
+struct rollback_entry_t
+{
+  unsigned long long tick = 0u;
+  unsigned long long keyframe_tick = 0u;  // the keyframe this tick is rebuilt from, this tick itself if it is one
+  unsigned           keyframe_slot = 0u;
+  unsigned long long first_patch = 0u;    // in the patch ring, counted from the first patch ever written
+  unsigned           num_patches = 0u;
+  double             tick_seconds = 0.0;
+  player_state_t     player = {};
+  random_t           random;
+};
+
+/// @brief what recording has cost so far
+struct rollback_stats_t
+{
+  unsigned long long num_records = 0u;
+  unsigned long long num_keyframes = 0u;
+  unsigned long long num_patches = 0u;
+  unsigned long long num_restores = 0u;
+  double             record_seconds = 0.0;
+  double             restore_seconds = 0.0;
+};
+
+
+/// @brief see 'ROLLBACK' above
+class rollback_ring_t
+{
+public:
+  /// @param num_ticks how many of the latest ticks can be restored, fewer only while the patches overflow (see record)
+  /// @param keyframe_interval_ ticks between full copies of the tiles, at least 1
+  /// @param max_patches tile patches held over the whole ring, 0 for a default of NUM_TILES / 64 per tick
+  void initialise (unsigned num_ticks, unsigned keyframe_interval_, unsigned long long max_patches = 0u);
+  void release ();
+
+  bool is_enabled () const { return !entries.empty (); }
+
+  /// @brief keep the world as it is at the end of a tick
+  /// when a tick changes more tiles than the patches have room for, the oldest keyframe spans are dropped to make room,
+  /// & if that is still not enough the tick is kept as a keyframe instead
+  /// @return the tick it was recorded as, counting from 0
+  unsigned long long record (player_t const& player, tiles_t const& tiles, double tick_seconds);
+
+  /// @brief the oldest & newest ticks that can be restored
+  /// @return false if nothing has been recorded
+  bool get_window (unsigned long long& first, unsigned long long& last) const;
+
+  /// @brief put the world back as it was at the end of 'tick', including the game's random number stream
+  /// the ticks recorded after it are forgotten, the next record carries on from it
+  /// @param player replaced with a new player of the recorded kind
+  /// @return false if 'tick' is not in the window, the world is then left as it was
+  bool restore (unsigned long long tick, player_t*& player, tiles_t& tiles);
+
+  rollback_stats_t const& get_stats () const { return stats; }
+
+  /// @brief bytes preallocated for the keyframes, patches & entries
+  size_t get_reserved_bytes () const;
+
+
+private:
+  rollback_entry_t& entry (unsigned long long tick) { return entries [tick % entries.size ()]; }
+  rollback_entry_t const& entry (unsigned long long tick) const { return entries [tick % entries.size ()]; }
+
+  /// @brief forget the oldest keyframe & the deltas built on it
+  /// @return false if only the newest keyframe is left
+  bool evict_oldest_keyframe ();
+
+  /// @brief compare the reconstruction, moved on by a tick, with 'tiles', recording the differences as patches
+  /// @return false if the patches would not fit even with only the newest keyframe left
+  bool record_patches (rollback_entry_t& recorded, tiles_t const& tiles);
+
+  std::vector <rollback_entry_t>       entries;       // [tick % size]
+  std::vector <std::unique_ptr <tiles_t>> keyframes;
+  std::vector <unsigned long long>     keyframe_ticks; // [slot], the tick each keyframe slot holds
+  std::vector <rollback_tile_patch_t>  patches;       // a ring, [patch % size]
+  std::unique_ptr <tiles_t>            reconstruction; // the newest tick, as restore would rebuild it
+
+  unsigned           keyframe_interval = 1u;
+  unsigned           next_keyframe_slot = 0u;
+  unsigned           num_live_keyframes = 0u;       // the slots before 'next_keyframe_slot' still in the window
+  unsigned long long first_tick = 0u;               // oldest restorable, always a keyframe
+  unsigned long long next_tick = 0u;                // the tick the next record is
+  unsigned long long last_keyframe_tick = 0u;
+  unsigned long long next_patch = 0u;
+  rollback_stats_t   stats;
+};
@@ -5,6 +5,17 @@
 
 #include "extra/walls.h"         // for wall_t
 
+#include "../../common/world_checkpoint.h" // for world_checkpoint_t, world_checkpoint_writer_t, WORLD_CHECKPOINT_ID
+
+
+// checkpoint sections, one per tile array
+static uint32_t const CHECKPOINT_TILE_POSITION = WORLD_CHECKPOINT_ID('T', 'P', 'O', 'S');
+static uint32_t const CHECKPOINT_TILE_DIRECTION = WORLD_CHECKPOINT_ID('T', 'D', 'I', 'R');
+static uint32_t const CHECKPOINT_TILE_ANGLE = WORLD_CHECKPOINT_ID('T', 'A', 'N', 'G');
+static uint32_t const CHECKPOINT_TILE_PREVIOUS_POSITION = WORLD_CHECKPOINT_ID('T', 'P', 'P', 'O');
+static uint32_t const CHECKPOINT_TILE_PREVIOUS_ANGLE = WORLD_CHECKPOINT_ID('T', 'P', 'A', 'N');
+static uint32_t const CHECKPOINT_TILE_EATEN = WORLD_CHECKPOINT_ID('T', 'E', 'A', 'T');
+
 
 static void matrix_multiply (float output[4][4], float const input_a[4][4], float const input_b[4][4])
 {
@@ -48,7 +59,7 @@ static void matrix_multiply (float output[4][4], float const input_a[4][4], floa
 }
 
 
-static void collision_resolve_tile_wall (pigeon::gfx::spritesheet spritesheet, tiles_t* tiles, wall_t* wall, int index)
+static void collision_resolve_tile_wall (tiles_t* tiles, wall_t const* wall, texture_rect const& rect, int index)
 {
   // direction response
   if (wall->get_id () == WALL_ID_LEFT || wall->get_id () == WALL_ID_RIGHT)
@@ -65,10 +76,6 @@ static void collision_resolve_tile_wall (pigeon::gfx::spritesheet spritesheet, t
     tiles->direction[index].y = -tiles->direction[index].y;
   }
 
-  // get the tiles spritesheet rect (position, width & height)
-  // this is to get the tile's size as required by the following code
-  texture_rect const* tex_rect = get_tile_texture_rect (spritesheet, tiles->get_id ());
-
   // position response
   if (wall->get_id () == WALL_ID_LEFT)
   {
@@ -77,22 +84,22 @@ static void collision_resolve_tile_wall (pigeon::gfx::spritesheet spritesheet, t
     // move tile to the rightmost edge of the left wall
     tiles->position[index].x = wall->position.x + wall->size / 2.0;
     // + half the width of the tile itself (remember the tile's origin is at its centre)
-    tiles->position[index].x += (double)tex_rect->width / 2.0;
+    tiles->position[index].x += (double)rect.width / 2.0;
   }
   else if (wall->get_id () == WALL_ID_RIGHT)
   {
     tiles->position[index].x = wall->position.x - wall->size / 2.0;
-    tiles->position[index].x -= (double)tex_rect->width / 2.0;
+    tiles->position[index].x -= (double)rect.width / 2.0;
   }
   else if (wall->get_id () == WALL_ID_TOP)
   {
     tiles->position[index].y = wall->position.y - wall->size / 2.0;
-    tiles->position[index].y -= (double)tex_rect->height / 2.0;
+    tiles->position[index].y -= (double)rect.height / 2.0;
   }
   else if (wall->get_id () == WALL_ID_BOTTOM)
   {
     tiles->position[index].y = wall->position.y + wall->size / 2.0;
-    tiles->position[index].y += (double)tex_rect->height / 2.0;
+    tiles->position[index].y += (double)rect.height / 2.0;
   }
 
   // By adjusting the tile's position we have stopped the tile and wall from overlapping.
@@ -137,7 +144,7 @@ static void collision_resolve_tile_wall (pigeon::gfx::spritesheet spritesheet, t
 // TILE
 
 
-void tiles_t::render(pigeon::gfx::sprite_batch& spritebatch, pigeon::gfx::spritesheet& spritesheet)
+void tiles_t::render(pigeon::gfx::sprite_batch& spritebatch, pigeon::gfx::spritesheet& spritesheet, float alpha)
 {
     texture_rect const* tex_rect = get_tile_texture_rect(spritesheet, TILE_ID_NORMAL);
     CUCKOO_ASSERT(tex_rect);
@@ -145,9 +152,11 @@ void tiles_t::render(pigeon::gfx::sprite_batch& spritebatch, pigeon::gfx::sprite
     {
 
 
-        float const position_x = position[i].x;
-        float const position_y = position[i].y;
-        float const angle = angle_radians[i]; // must be in radians!
+        // interpolated between the last 2 ticks, the tiles only ever spin one way, by less than a turn per tick
+        float const position_x = (float)cuckoo::maths::lerp(previous_position[i].x, position[i].x, (double)alpha);
+        float const position_y = (float)cuckoo::maths::lerp(previous_position[i].y, position[i].y, (double)alpha);
+        float const turned = cuckoo::maths::mod(angle_radians[i] - previous_angle_radians[i] + cuckoo::maths::two_pi <float>(), cuckoo::maths::two_pi <float>());
+        float const angle = previous_angle_radians[i] + turned * alpha; // must be in radians!
         float const scale_x = (float)tex_rect->width;
         float const scale_y = (float)tex_rect->height;
 
@@ -210,21 +219,10 @@ void tiles_t::render(pigeon::gfx::sprite_batch& spritebatch, pigeon::gfx::sprite
 
 }
 
-void tiles_t::on_collision(object_type_t other_type, void* other_data, pigeon::gfx::spritesheet spritesheet, int index)
+void tiles_t::on_wall_hit(int index, wall_t const& wall, texture_rect const& rect)
 {
-    if (other_type == WALL_TYPE)
-    {
-        // 'other_data' is a wall of some kind
-        // this tile has hit a wall, make the appropriate changes to this tile as a result of it
-        collision_resolve_tile_wall(spritesheet, this, (wall_t*)other_data, index);
-        
-    }
-    else if (other_type == PLAYER_TYPE)
-    {
-        // 'other_data' is a player
-
-        is_eaten[index] = true; // mark this tile as 'eaten' and therefore requires replacing 
-    }
+    // this tile has hit a wall, make the appropriate changes to this tile as a result of it
+    collision_resolve_tile_wall(this, &wall, rect, index);
 }
 
 object_id_t tiles_t::get_id() const
@@ -244,6 +242,43 @@ bool tiles_t::needs_replacing(int index)
     }
 }
 
+void tiles_t::save_checkpoint(world_checkpoint_writer_t& writer) const
+{
+    writer.add(CHECKPOINT_TILE_POSITION, position, NUM_TILES);
+    writer.add(CHECKPOINT_TILE_DIRECTION, direction, NUM_TILES);
+    writer.add(CHECKPOINT_TILE_ANGLE, angle_radians, NUM_TILES);
+    writer.add(CHECKPOINT_TILE_PREVIOUS_POSITION, previous_position, NUM_TILES);
+    writer.add(CHECKPOINT_TILE_PREVIOUS_ANGLE, previous_angle_radians, NUM_TILES);
+    writer.add(CHECKPOINT_TILE_EATEN, is_eaten, NUM_TILES);
+}
+
+bool tiles_t::load_checkpoint(world_checkpoint_t const& checkpoint)
+{
+    // check every array before copying any, so a checkpoint of another NUM_TILES changes nothing
+    size_t counts[6] = {};
+    bool const is_complete = checkpoint.find<vector4>(CHECKPOINT_TILE_POSITION, counts[0])
+        && checkpoint.find<vector4>(CHECKPOINT_TILE_DIRECTION, counts[1])
+        && checkpoint.find<float>(CHECKPOINT_TILE_ANGLE, counts[2])
+        && checkpoint.find<vector4>(CHECKPOINT_TILE_PREVIOUS_POSITION, counts[3])
+        && checkpoint.find<float>(CHECKPOINT_TILE_PREVIOUS_ANGLE, counts[4])
+        && checkpoint.find<bool>(CHECKPOINT_TILE_EATEN, counts[5]);
+    for (size_t count : counts)
+    {
+        if (!is_complete || count != NUM_TILES)
+        {
+            return false;
+        }
+    }
+
+    checkpoint.copy(CHECKPOINT_TILE_POSITION, position, NUM_TILES);
+    checkpoint.copy(CHECKPOINT_TILE_DIRECTION, direction, NUM_TILES);
+    checkpoint.copy(CHECKPOINT_TILE_ANGLE, angle_radians, NUM_TILES);
+    checkpoint.copy(CHECKPOINT_TILE_PREVIOUS_POSITION, previous_position, NUM_TILES);
+    checkpoint.copy(CHECKPOINT_TILE_PREVIOUS_ANGLE, previous_angle_radians, NUM_TILES);
+    checkpoint.copy(CHECKPOINT_TILE_EATEN, is_eaten, NUM_TILES);
+    return true;
+}
+
 
 // GENERAL
 
@@ -261,6 +296,10 @@ void tiles_t::initialise_tile(int index) //initialises the replacement of any ti
         direction[index].y /= magnitude;
         angle_radians[index] = (float)random_getd(0.0, cuckoo::maths::two_pi <double>());
     }
+
+    // a new tile is drawn where it starts, not interpolated from where the tile it replaces was
+    previous_position[index] = position[index];
+    previous_angle_radians[index] = angle_radians[index];
 }
 
 void initialise_tiles (tiles_t& tiles)
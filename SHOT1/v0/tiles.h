@@ -7,6 +7,10 @@
 #include "extra/utility.h"          // for vector4, random_getf
 #include <vector>                   // for std::vector
 
+class world_checkpoint_t; // forward declare, see common/world_checkpoint.h
+class world_checkpoint_writer_t;
+struct wall_t; // see extra/walls.h
+
 
 
 // TILE NORMAL
@@ -39,20 +43,59 @@ struct tiles_t
         }
     }
 
-    void render(pigeon::gfx::sprite_batch& spritebatch, pigeon::gfx::spritesheet& spritesheet);
+    /// <summary>
+    /// keep the current state as the previous tick's, before a fixed time step tick changes it
+    /// (render interpolates between the 2, see common/fixed_timestep.h)
+    /// </summary>
+    void begin_tick()
+    {
+        for (unsigned i = 0u; i < NUM_TILES; ++i)
+        {
+            previous_position[i] = position[i];
+            previous_angle_radians[i] = angle_radians[i];
+        }
+    }
+
+    /// <param name="alpha">where the display is between the previous tick (0) and the latest (1)</param>
+    void render(pigeon::gfx::sprite_batch& spritebatch, pigeon::gfx::spritesheet& spritesheet, float alpha);
   
 
-    void on_collision(object_type_t other_type, void* other_data, pigeon::gfx::spritesheet spritesheet, int index);
+    /// <summary>
+    /// the player has eaten this tile, mark it as requiring replacing
+    /// </summary>
+    void on_eaten(int index) { is_eaten[index] = true; }
+
+    /// <summary>
+    /// this tile has hit a wall, reflect its direction and move it back out
+    /// </summary>
+    /// <param name="rect">the tile's sub-sprite, whose size is the tile's size in the game world</param>
+    void on_wall_hit(int index, wall_t const& wall, texture_rect const& rect);
 
     object_id_t get_id() const ;
 
     bool needs_replacing(int index);
 
+    /// <summary>
+    /// add every tile array to a checkpoint, written straight from the arrays below (see checkpoint.h)
+    /// </summary>
+    void save_checkpoint(world_checkpoint_writer_t& writer) const;
+
+    /// <summary>
+    /// copy every tile array out of a checkpoint, one memcpy each
+    /// </summary>
+    /// <returns>false if the checkpoint does not hold all NUM_TILES of every array, the tiles are then left as they were</returns>
+    bool load_checkpoint(world_checkpoint_t const& checkpoint);
+
 
     vector4 position[NUM_TILES];
     vector4 direction[NUM_TILES];
     float angle_radians[NUM_TILES];
+
+    // as they were at the end of the previous tick, only read by render
+    vector4 previous_position[NUM_TILES];
+    float previous_angle_radians[NUM_TILES];
 private:
+    friend class rollback_ring_t; // patches whole tiles, see rollback.h
     bool is_eaten[NUM_TILES];
 
 };
@@ -0,0 +1,326 @@
+// ANALYTIC PARTICLES:
+//
+// Every particle type has a constant acceleration, so a particle's state at age t has a closed form:
+//   position = p0 + v0 * t + 0.5 * a * t^2
+//   colour   = lerp (end_colour, start_colour, 1 - t / life_time)
+//   dead     = t >= life_time || position.y < kill_y
+// p0, v0 & life_time are re-derived from the particle's seed whenever they are needed,
+// so a particle only stores the tick it was spawned on, its seed and its type (9 bytes).
+// Time is kept as a count of fixed ticks rather than a float clock, which would drift & round every age to a coarser
+// step the longer the game runs: an age is the whole number of ticks since the spawn tick times the tick length, so it is
+// as exact after a day as after a second.
+//
+// Nothing is integrated or written back per particle per frame, so:
+// - the update reads 9 bytes per particle rather than reading and writing the whole particle
+// - every particle can be evaluated independently, in any order, on any thread
+// - the same seed & spawn times always produce exactly the same particles
+
+
+#pragma once
+
+#include "cuckoo/core/asserts.h"       // for CUCKOO_ASSERT
+#include "cuckoo/maths/maths.h"        // for cuckoo::maths::lerp, cuckoo::maths::min
+
+#include "constants.h"                 // for NUM_PARTICLE_TYPES
+#include "particle_config.h"           // for particle_config_t, MAX_THREADS
+#include "particle_types.h"            // for particle_type_info_t, point_t
+
+#include "../../common/page_buffer.h"  // for page_buffer_t
+#include "../../common/trace.h"        // for TRACE_ZONE
+#include "../../common/worker_pool.h"  // for worker_pool_t
+
+#include <vector>                      // for std::vector
+
+
+/// @brief mix the bits of a 32-bit value (lowbias32 by C. Wellons)
+/// integer multiplies & shifts only, so the compiler can vectorise loops that call it
+static unsigned analytic_hash (unsigned x)
+{
+  x ^= x >> 16u;
+  x *= 0x7feb352du;
+  x ^= x >> 15u;
+  x *= 0x846ca68bu;
+  x ^= x >> 16u;
+  return x;
+}
+
+/// @brief the index'th uniform random number, in [0, 1], belonging to a particle's seed
+static float analytic_uniform (unsigned seed, unsigned index)
+{
+  return (float)(analytic_hash (seed * 8u + index) >> 8u) * (1.f / 16777215.f);
+}
+
+/// @brief what a particle looks like at a given point in time
+struct analytic_state_t
+{
+  float x;
+  float y;
+  float colour_t; // 1 at birth, 0 at end of life
+  bool  is_alive;
+};
+
+/// @brief evaluate a particle from its spawn parameters
+/// @param age seconds since the particle was spawned
+static analytic_state_t analytic_evaluate (float age, unsigned seed, particle_type_info_t const& type)
+{
+  float const life_time  = cuckoo::maths::lerp (type.life_time_min,  type.life_time_max,  analytic_uniform (seed, 0u));
+  float const position_x = cuckoo::maths::lerp (type.position_x_min, type.position_x_max, analytic_uniform (seed, 1u));
+  float const position_y = cuckoo::maths::lerp (type.position_y_min, type.position_y_max, analytic_uniform (seed, 2u));
+  float const velocity_x = cuckoo::maths::lerp (type.velocity_x_min, type.velocity_x_max, analytic_uniform (seed, 3u));
+  float const velocity_y = cuckoo::maths::lerp (type.velocity_y_min, type.velocity_y_max, analytic_uniform (seed, 4u));
+
+  analytic_state_t state;
+  state.x = position_x + velocity_x * age + .5f * type.acceleration_x * age * age;
+  state.y = position_y + velocity_y * age + .5f * type.acceleration_y * age * age;
+  state.colour_t = 1.f - age / life_time;
+  state.is_alive = age < life_time && state.y >= type.kill_y;
+  return state;
+}
+
+
+/// @brief the range of particles a worker is responsible for
+struct analytic_chunk_t
+{
+  unsigned begin = 0u;
+  unsigned end = 0u;
+
+  unsigned num_survivors = 0u; // survivors' points are written to [begin, begin + num_survivors) of the staging buffer
+  unsigned output_offset = 0u; // exclusive prefix sum of num_survivors
+
+  unsigned emit_offset = 0u;
+  unsigned emit_count = 0u;
+};
+
+/// @brief particles that are evaluated from their spawn parameters rather than integrated
+/// see 'ANALYTIC PARTICLES' above
+class analytic_particles_t
+{
+public:
+  /// @param config capacity, spawn rate, workers & page mode
+  /// @param seed all particles are derived from this, the same seed gives the same simulation
+  /// @param workers_ the owner's workers, started with at least config_.num_threads
+  void initialise (particle_config_t const& config_, unsigned seed, worker_pool_t& workers_)
+  {
+    config = config_;
+    workers = &workers_;
+    for (unsigned i = 0u; i < 2u; ++i)
+    {
+      spawn_tick [i].allocate (config.max_particles, config.page_mode);
+      seeds [i].allocate (config.max_particles, config.page_mode);
+      types [i].allocate (config.max_particles, config.page_mode);
+    }
+    is_alive.allocate (config.max_particles, config.page_mode);
+    // the emitted particles' points go after ALL of the last frame's particles, dead or alive
+    points.allocate ((size_t)config.max_particles + config.spawn_rate, config.page_mode);
+
+    front_index = 0u;
+    count = 0u;
+    next_seed = seed;
+    tick_now = 0u;
+    tick_seconds = 0.0;
+  }
+
+  /// @brief change how many particles are spawned per frame & how many workers are used, both at most what was initialised
+  void set_work_split (unsigned spawn_rate, unsigned num_threads)
+  {
+    config.spawn_rate = spawn_rate;
+    config.num_threads = num_threads;
+  }
+
+  /// @brief advance time by a tick, evaluate every particle into the staging buffer, remove the dead & emit new particles
+  /// @param tick_seconds_ the fixed tick, the same every update (see common/fixed_timestep.h)
+  /// @return number of active particles
+  unsigned update (double tick_seconds_, particle_type_info_t const type_info [NUM_PARTICLE_TYPES])
+  {
+    ++tick_now;
+    tick_seconds = tick_seconds_;
+
+    unsigned const num_threads = config.num_threads;
+    unsigned const chunk_size = (count + num_threads - 1u) / num_threads;
+    for (unsigned i = 0u; i < num_threads; ++i)
+    {
+      chunks [i] = {};
+      chunks [i].begin = cuckoo::maths::min (i * chunk_size, count);
+      chunks [i].end = cuckoo::maths::min (chunks [i].begin + chunk_size, count);
+    }
+
+    // 1. EVALUATE
+    workers->run (num_threads, [&] (unsigned i)
+    {
+      evaluate_chunk (chunks [i], type_info);
+    });
+
+    // 2. EXCLUSIVE PREFIX SUM & SPAWN BUDGET
+    unsigned num_survivors = 0u;
+    for (unsigned i = 0u; i < num_threads; ++i)
+    {
+      chunks [i].output_offset = num_survivors;
+      num_survivors += chunks [i].num_survivors;
+    }
+
+    // new particles are appended after the survivors,
+    // their points go after all of the old particles' points in the staging buffer
+    num_emitted = cuckoo::maths::min (config.spawn_rate, config.max_particles - num_survivors);
+    unsigned emit_offset = num_survivors;
+    for (unsigned i = 0u; i < num_threads; ++i)
+    {
+      chunks [i].emit_offset = emit_offset;
+      chunks [i].emit_count = num_emitted / num_threads + (i < num_emitted % num_threads ? 1u : 0u);
+      emit_offset += chunks [i].emit_count;
+    }
+    emitted_points_offset = count;
+
+    // 3. SCATTER & EMIT
+    workers->run (num_threads, [&] (unsigned i)
+    {
+      scatter_chunk (chunks [i], type_info);
+    });
+
+    next_seed += num_emitted;
+    front_index ^= 1u;
+    count = emit_offset;
+    return count;
+  }
+
+  /// @brief visit every point evaluated by the last update
+  template <typename function_t>
+  void for_each_point (function_t function) const
+  {
+    for (unsigned i = 0u; i < config.num_threads; ++i)
+    {
+      for (unsigned j = chunks [i].begin; j < chunks [i].begin + chunks [i].num_survivors; ++j)
+      {
+        function (points [j]);
+      }
+    }
+    for (unsigned j = emitted_points_offset; j < emitted_points_offset + num_emitted; ++j)
+    {
+      function (points [j]);
+    }
+  }
+
+  void release (void)
+  {
+    for (unsigned i = 0u; i < 2u; ++i)
+    {
+      spawn_tick [i].release ();
+      seeds [i].release ();
+      types [i].release ();
+    }
+    is_alive.release ();
+    points.release ();
+    count = 0u;
+  }
+
+
+private:
+  static unsigned const BLOCK_SIZE = 64u;
+
+  /// @brief PASS 1: evaluate every particle in the chunk, pack the survivors into the staging buffer
+  void evaluate_chunk (analytic_chunk_t& chunk, particle_type_info_t const* type_info)
+  {
+    TRACE_ZONE ("evaluate");
+
+    unsigned const*        in_spawn_tick = spawn_tick [front_index].data ();
+    unsigned const         now = (unsigned)tick_now; // ages are far shorter than 2^32 ticks, so the low bits are enough
+    unsigned const*        in_seeds = seeds [front_index].data ();
+    particle_type_t const* in_types = types [front_index].data ();
+
+    unsigned num_survivors = 0u;
+    for (unsigned block = chunk.begin; block < chunk.end; block += BLOCK_SIZE)
+    {
+      unsigned const block_count = cuckoo::maths::min (BLOCK_SIZE, chunk.end - block);
+
+      // evaluate a block of particles into SoA scratch
+      // no branches & no writes to particle memory, so this loop is free to be vectorised
+      float x [BLOCK_SIZE], y [BLOCK_SIZE], colour_t [BLOCK_SIZE];
+      unsigned char alive [BLOCK_SIZE];
+      for (unsigned i = 0u; i < block_count; ++i)
+      {
+        float const age = (float)((double)(now - in_spawn_tick [block + i]) * tick_seconds);
+        analytic_state_t const state = analytic_evaluate (age, in_seeds [block + i], type_info [in_types [block + i]]);
+        x [i] = state.x;
+        y [i] = state.y;
+        colour_t [i] = state.colour_t;
+        alive [i] = state.is_alive ? 1u : 0u;
+      }
+
+      // pack the survivors
+      for (unsigned i = 0u; i < block_count; ++i)
+      {
+        is_alive [block + i] = alive [i];
+        if (alive [i])
+        {
+          particle_type_info_t const& type = type_info [in_types [block + i]];
+          float const t = colour_t [i];
+          points [chunk.begin + num_survivors++] = { x [i], y [i],
+            vec4 (cuckoo::maths::lerp (type.end_colour.r, type.start_colour.r, t),
+              cuckoo::maths::lerp (type.end_colour.g, type.start_colour.g, t),
+              cuckoo::maths::lerp (type.end_colour.b, type.start_colour.b, t),
+              cuckoo::maths::lerp (type.end_colour.a, type.start_colour.a, t)) };
+        }
+      }
+    }
+    chunk.num_survivors = num_survivors;
+  }
+
+  /// @brief PASS 2: compact the survivors' spawn parameters into the back buffers, then emit new particles
+  void scatter_chunk (analytic_chunk_t const& chunk, particle_type_info_t const* type_info)
+  {
+    TRACE_ZONE ("compact & emit");
+
+    unsigned const front = front_index;
+    unsigned const back = front_index ^ 1u;
+
+    unsigned out = chunk.output_offset;
+    for (unsigned i = chunk.begin; i < chunk.end; ++i)
+    {
+      if (is_alive [i])
+      {
+        spawn_tick [back][out] = spawn_tick [front][i];
+        seeds [back][out] = seeds [front][i];
+        types [back][out] = types [front][i];
+        ++out;
+      }
+    }
+    CUCKOO_ASSERT (out == chunk.output_offset + chunk.num_survivors);
+
+    // emit, new particles are spread evenly between each type
+    unsigned const first_emitted = chunk.emit_offset - chunk_emit_base ();
+    for (unsigned i = 0u; i < chunk.emit_count; ++i)
+    {
+      unsigned const index = first_emitted + i;
+      unsigned const seed = analytic_hash (next_seed + index);
+      particle_type_t const type = (particle_type_t)(index % NUM_PARTICLE_TYPES);
+
+      spawn_tick [back][chunk.emit_offset + i] = (unsigned)tick_now;
+      seeds [back][chunk.emit_offset + i] = seed;
+      types [back][chunk.emit_offset + i] = type;
+
+      // a particle has no colour until it has been updated for the first time
+      analytic_state_t const state = analytic_evaluate (0.f, seed, type_info [type]);
+      points [emitted_points_offset + index] = { state.x, state.y, vec4 (0.f, 0.f, 0.f, 0.f) };
+    }
+  }
+
+  /// @brief where this frame's emitted particles start in the back buffers
+  unsigned chunk_emit_base (void) const { return chunks [0].emit_offset; }
+
+  page_buffer_t <unsigned>        spawn_tick [2];
+  page_buffer_t <unsigned>        seeds [2];
+  page_buffer_t <particle_type_t> types [2];
+  page_buffer_t <unsigned char>   is_alive; // written by pass 1, read by pass 2
+  page_buffer_t <point_t>         points;   // render staging buffer
+
+  particle_config_t config;
+  worker_pool_t* workers = nullptr;
+  analytic_chunk_t chunks [MAX_THREADS];
+  unsigned front_index = 0u;
+  unsigned count = 0u;
+  unsigned num_emitted = 0u;
+  unsigned emitted_points_offset = 0u;
+
+  unsigned           next_seed = 0u;
+  unsigned long long tick_now = 0u;     // ticks run since initialise
+  double             tick_seconds = 0.0;
+};
@@ -1,7 +1,55 @@
 #pragma once
 
+// The default number of workers, PARTICLE_MAX & PARTICLE_SPAWN_RATE (below) are also only defaults,
+// all three can be changed at startup, see particle_config.h.
 const unsigned NUM_THREADS = 4u;
 
+// When true, the update writes each surviving particle straight into a render-ready staging buffer
+// (float position + colour, as point_renderer.draw consumes it) and render only submits that buffer.
+// When false, render walks the particle pool and converts each particle itself.
+const bool PARTICLE_FUSED_PACK = true;
+
+// How the particles are simulated:
+// PARTICLE_MODE_POOL     - every particle is integrated each frame and the survivors are compacted into a dense pool
+// PARTICLE_MODE_ANALYTIC - a particle only stores its spawn time, seed & type and is evaluated from a closed form (see analytic_particles.h)
+// PARTICLE_MODE_RING     - particles are integrated in per-frame spawn blocks, whole blocks are retired at once (see ring_particles.h)
+enum particle_mode_t
+{
+  PARTICLE_MODE_POOL,
+  PARTICLE_MODE_ANALYTIC,
+  PARTICLE_MODE_RING,
+};
+const particle_mode_t PARTICLE_MODE = PARTICLE_MODE_POOL;
+
+// When true, the next frame is simulated on a background thread while the main thread submits this frame's points for render.
+// The points are held in two snapshots, one being written by the simulation & one being read by render,
+// which swap at the frame boundary, so what is drawn is always one update behind what is being simulated.
+// Off by default, as it adds a frame of latency.
+const bool PARTICLE_PIPELINED = false;
+
+// PARTICLE_MODE_POOL only: every this many frames the live particles are sorted into Morton (Z) order of screen position,
+// so particles that are near each other on screen are also near each other in memory & in the point stream (see morton_order.h).
+// 0 keeps them in emission order. Can be changed at startup, see particle_config.h.
+const unsigned PARTICLE_REORDER_INTERVAL = 0u;
+
+// Force fields that push the particles about on top of their type's acceleration, any combination of the flags below
+// (see force_field.h). PARTICLE_MODE_ANALYTIC evaluates particles from a closed form, which cannot include them.
+// 0 for none. Can be changed at startup, see particle_config.h.
+enum particle_affector_t
+{
+  PARTICLE_AFFECTOR_WIND = 1u << 0,
+  PARTICLE_AFFECTOR_VORTEX = 1u << 1,
+  PARTICLE_AFFECTOR_TURBULENCE = 1u << 2,
+};
+const unsigned PARTICLE_AFFECTORS = 0u;
+
+// A frame time budget, in milliseconds, that the spawn rate & number of workers are adjusted to fit (see frame_governor.h).
+// 0 switches the governor off. Can be changed at startup, see particle_config.h.
+const float PARTICLE_FRAME_BUDGET_MS = 0.f;
+
+// The same seed always produces the same particles.
+const unsigned PARTICLE_SEED = 1u;
+
 ////////////////////////////////////////////////
 //// DO NOT EDIT/DELETE/MOVE CODE BELOW >>> ////
 ////////////////////////////////////////////////
@@ -0,0 +1,206 @@
+// FORCE FIELDS:
+//
+// Besides their type's fixed acceleration, particles can be pushed around by any mix of 3 affectors
+// (particle_config_t::affectors, see PARTICLE_AFFECTORS in constants.h):
+//   PARTICLE_AFFECTOR_WIND       | a sideways push, stronger towards the top of the screen
+//   PARTICLE_AFFECTOR_VORTEX     | a swirl around the centre of the screen, fading out with distance
+//   PARTICLE_AFFECTOR_TURBULENCE | the curl of a smooth noise field, eddies that never bunch particles up (divergence free)
+// Evaluating them per particle would be far more expensive than the integration itself,
+// so they are summed once into a 2D grid of accelerations covering the screen (rebuilt when the screen size changes)
+// and each particle samples the grid with bilinear interpolation.
+//
+// The grid is small (33 x 33 nodes, ~13 KB) so it stays in L1, and is stored in 8 x 8 node tiles, x & y in separate arrays,
+// so the 4 nodes around a particle are nearly always in the same tile & the same few cache lines.
+// Particles are sampled in blocks of FORCE_FIELD_BATCH: positions to node indices & weights (a plain, vectorisable loop),
+// then the 4 nodes' x & y are gathered (AVX2 gather instructions where the build targets AVX2), then blended.
+
+
+#pragma once
+
+#include "cuckoo/maths/maths.h"        // for cuckoo::maths::min, cuckoo::maths::max, cuckoo::maths::sin, cuckoo::maths::cos
+
+#include "constants.h"                 // for PARTICLE_AFFECTOR_WIND, PARTICLE_AFFECTOR_VORTEX, PARTICLE_AFFECTOR_TURBULENCE
+#include "particle.h"                  // for particle
+
+#if defined (__AVX2__)
+#define FORCE_FIELD_USE_AVX2 1
+#include <immintrin.h>                 // for __m256, __m256i, _mm256_*
+#else
+#define FORCE_FIELD_USE_AVX2 0
+#endif
+
+
+/// @brief accelerations sampled on a grid of nodes covering the screen, see 'FORCE FIELDS' above
+struct force_field_t
+{
+  static unsigned const NUM_CELLS = 32u;              // per axis
+  static unsigned const NUM_NODES = NUM_CELLS + 1u;   // per axis
+  static unsigned const TILE_SIZE = 8u;               // nodes per tile, per axis
+  static unsigned const NUM_TILES = (NUM_NODES + TILE_SIZE - 1u) / TILE_SIZE; // per axis
+  static unsigned const NUM_SLOTS = NUM_TILES * NUM_TILES * TILE_SIZE * TILE_SIZE;
+
+  /// @brief where node (column, row) is stored
+  static unsigned slot (unsigned column, unsigned row)
+  {
+    unsigned const tile = (row / TILE_SIZE) * NUM_TILES + column / TILE_SIZE;
+    return tile * TILE_SIZE * TILE_SIZE + (row % TILE_SIZE) * TILE_SIZE + column % TILE_SIZE;
+  }
+
+  alignas (64) float acceleration_x [NUM_SLOTS] = {};
+  alignas (64) float acceleration_y [NUM_SLOTS] = {};
+
+  // screen position to node space
+  float origin_x = 0.f;
+  float origin_y = 0.f;
+  float nodes_per_pixel_x = 0.f;
+  float nodes_per_pixel_y = 0.f;
+
+  unsigned affectors = 0u;                            // what was summed into the grid
+};
+
+
+// BUILDING
+
+/// @brief smooth, repeatable noise: a few octaves of sines with fixed phases, used as a stream function
+static float force_field_stream (float u, float v)
+{
+  float value = 0.f;
+  float frequency = 2.f;
+  float amplitude = 1.f;
+  for (unsigned octave = 0u; octave < 3u; ++octave)
+  {
+    float const phase = 1.7f * (float)octave + .3f;
+    value += amplitude * cuckoo::maths::sin (frequency * u * 6.2831853f + phase) * cuckoo::maths::cos (frequency * v * 6.2831853f - 2.f * phase);
+    frequency *= 2.f;
+    amplitude *= .5f;
+  }
+  return value;
+}
+
+/// @brief sum the selected affectors into the grid
+/// @param affectors PARTICLE_AFFECTOR_* flags
+/// @param screen_width, screen_height the grid covers the screen, the strengths are scaled to its size
+static void force_field_build (force_field_t& field, unsigned affectors, unsigned screen_width, unsigned screen_height)
+{
+  float const width = (float)cuckoo::maths::max (screen_width, 1u);
+  float const height = (float)cuckoo::maths::max (screen_height, 1u);
+  float const cells = (float)force_field_t::NUM_CELLS;
+
+  field.affectors = affectors;
+  field.origin_x = -width * .5f;
+  field.origin_y = -height * .5f;
+  field.nodes_per_pixel_x = cells / width;
+  field.nodes_per_pixel_y = cells / height;
+
+  float const wind_strength = width * .05f;           // pixels per second per second
+  float const vortex_strength = height * .5f;
+  float const vortex_radius = height * .25f;
+  float const turbulence_strength = height * .08f;
+
+  for (unsigned row = 0u; row < force_field_t::NUM_NODES; ++row)
+  {
+    for (unsigned column = 0u; column < force_field_t::NUM_NODES; ++column)
+    {
+      float const u = (float)column / cells;          // [0, 1] across the screen
+      float const v = (float)row / cells;             // [0, 1] bottom to top
+      float const x = field.origin_x + u * width;     // screen position, origin at the centre
+      float const y = field.origin_y + v * height;
+
+      float ax = 0.f;
+      float ay = 0.f;
+      if (affectors & PARTICLE_AFFECTOR_WIND)
+      {
+        ax += wind_strength * (.25f + .75f * v);
+      }
+      if (affectors & PARTICLE_AFFECTOR_VORTEX)
+      {
+        // tangential, anticlockwise, peaking at vortex_radius from the centre
+        float const falloff = vortex_strength * vortex_radius / (x * x + y * y + vortex_radius * vortex_radius);
+        ax += -y * falloff / vortex_radius;
+        ay += x * falloff / vortex_radius;
+      }
+      if (affectors & PARTICLE_AFFECTOR_TURBULENCE)
+      {
+        // curl of the stream function, by central differences
+        float const e = .5f / cells;
+        float const d_du = (force_field_stream (u + e, v) - force_field_stream (u - e, v)) / (2.f * e);
+        float const d_dv = (force_field_stream (u, v + e) - force_field_stream (u, v - e)) / (2.f * e);
+        ax += turbulence_strength * d_dv * .1f;
+        ay -= turbulence_strength * d_du * .1f;
+      }
+
+      unsigned const slot = force_field_t::slot (column, row);
+      field.acceleration_x [slot] = ax;
+      field.acceleration_y [slot] = ay;
+    }
+  }
+}
+
+
+// SAMPLING
+
+static unsigned const FORCE_FIELD_BATCH = 8u;
+
+/// @brief add the field's acceleration, bilinearly sampled at each particle's position, to its velocity
+/// particles off the edge of the grid take the acceleration at the edge
+static void force_field_apply (force_field_t const& field, particle* particles, unsigned count, float elapsed_seconds)
+{
+  float const max_node = (float)force_field_t::NUM_CELLS - .001f; // keeps column + 1 & row + 1 on the grid
+
+  for (unsigned batch = 0u; batch < count; batch += FORCE_FIELD_BATCH)
+  {
+    unsigned const batch_count = cuckoo::maths::min (FORCE_FIELD_BATCH, count - batch);
+    particle* p = particles + batch;
+
+    // 1. node space position -> the 4 surrounding nodes' slots & the blend weights
+    alignas (32) int   slots [4][FORCE_FIELD_BATCH] = {};
+    alignas (32) float weight_x [FORCE_FIELD_BATCH] = {};
+    alignas (32) float weight_y [FORCE_FIELD_BATCH] = {};
+    for (unsigned i = 0u; i < batch_count; ++i)
+    {
+      float const node_x = cuckoo::maths::min (cuckoo::maths::max ((p [i].position_x - field.origin_x) * field.nodes_per_pixel_x, 0.f), max_node);
+      float const node_y = cuckoo::maths::min (cuckoo::maths::max ((p [i].position_y - field.origin_y) * field.nodes_per_pixel_y, 0.f), max_node);
+      unsigned const column = (unsigned)node_x;
+      unsigned const row = (unsigned)node_y;
+      weight_x [i] = node_x - (float)column;
+      weight_y [i] = node_y - (float)row;
+      slots [0][i] = (int)force_field_t::slot (column, row);
+      slots [1][i] = (int)force_field_t::slot (column + 1u, row);
+      slots [2][i] = (int)force_field_t::slot (column, row + 1u);
+      slots [3][i] = (int)force_field_t::slot (column + 1u, row + 1u);
+    }
+
+    // 2. gather
+    alignas (32) float gathered_x [4][FORCE_FIELD_BATCH];
+    alignas (32) float gathered_y [4][FORCE_FIELD_BATCH];
+#if FORCE_FIELD_USE_AVX2
+    static_assert (FORCE_FIELD_BATCH == 8u, "one AVX2 gather per corner");
+    for (unsigned corner = 0u; corner < 4u; ++corner)
+    {
+      __m256i const index = _mm256_load_si256 ((__m256i const*)slots [corner]);
+      _mm256_store_ps (gathered_x [corner], _mm256_i32gather_ps (field.acceleration_x, index, 4));
+      _mm256_store_ps (gathered_y [corner], _mm256_i32gather_ps (field.acceleration_y, index, 4));
+    }
+#else
+    for (unsigned corner = 0u; corner < 4u; ++corner)
+    {
+      for (unsigned i = 0u; i < FORCE_FIELD_BATCH; ++i)
+      {
+        gathered_x [corner][i] = field.acceleration_x [slots [corner][i]];
+        gathered_y [corner][i] = field.acceleration_y [slots [corner][i]];
+      }
+    }
+#endif
+
+    // 3. blend & apply
+    for (unsigned i = 0u; i < batch_count; ++i)
+    {
+      float const bottom_x = cuckoo::maths::lerp (gathered_x [0][i], gathered_x [1][i], weight_x [i]);
+      float const top_x = cuckoo::maths::lerp (gathered_x [2][i], gathered_x [3][i], weight_x [i]);
+      float const bottom_y = cuckoo::maths::lerp (gathered_y [0][i], gathered_y [1][i], weight_x [i]);
+      float const top_y = cuckoo::maths::lerp (gathered_y [2][i], gathered_y [3][i], weight_x [i]);
+      p [i].velocity_x += cuckoo::maths::lerp (bottom_x, top_x, weight_y [i]) * elapsed_seconds;
+      p [i].velocity_y += cuckoo::maths::lerp (bottom_y, top_y, weight_y [i]) * elapsed_seconds;
+    }
+  }
+}
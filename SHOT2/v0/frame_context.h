@@ -0,0 +1,33 @@
+#pragma once
+
+#include "pigeon/gfx/driver.h"         // for pigeon::gfx::driver::get_screen_size
+
+#include "constants.h"                 // for NUM_PARTICLE_TYPES
+#include "particle_types.h"            // for particle_type_info_t, initialise_particle_types
+
+
+/// @brief everything the particles need to know about the screen, captured once per frame
+/// and passed to the update, rather than each particle asking the driver for it
+struct frame_context_t
+{
+  unsigned screen_width = 0u;
+  unsigned screen_height = 0u;
+
+  // derived from the screen size: kill heights, emitter origins & ranges
+  particle_type_info_t particle_types [NUM_PARTICLE_TYPES] = {};
+};
+
+/// @brief capture this frame's screen size
+/// everything derived from it is only worked out again if it has changed
+static void frame_context_capture (frame_context_t& frame)
+{
+  auto const screen_size = pigeon::gfx::driver::get_screen_size ();
+  if (screen_size.x == frame.screen_width && screen_size.y == frame.screen_height)
+  {
+    return;
+  }
+
+  frame.screen_width = screen_size.x;
+  frame.screen_height = screen_size.y;
+  initialise_particle_types (frame.particle_types, (float)frame.screen_width / 2.f, (float)frame.screen_height / 2.f);
+}
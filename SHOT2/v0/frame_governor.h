@@ -0,0 +1,175 @@
+// FRAME GOVERNOR:
+//
+// With a fixed spawn rate, how much work a frame holds depends on the frame rate and on whatever else the machine is doing.
+// The governor steers SHOT2 towards a frame time budget (particle_config_t::frame_budget_ms, 0 switches it off)
+// by watching the measured update & render times and adjusting the particle system's work split:
+//   spawn rate | particles spawned per frame, between 1/64 of & the configured spawn rate
+//   workers    | how many of the configured workers are used, the chunk each worker gets is the live particles / workers
+// Times are averaged over WINDOW_FRAMES frames and at most one change is made per window, so a single slow frame is ignored.
+//   over budget        | add a worker, if one is left & adding the last one helped, otherwise cut the spawn rate in proportion
+//   under 80% of it    | raise the spawn rate back up in steps, once it is back at the configured rate & under 50%, drop a worker
+// A worker that does not speed the update up by at least 5% is taken away again (e.g. when other processes hold the cores)
+// and no worker is added for HOLD_WINDOWS windows after that.
+// Fewer particles spawned only lowers the population as the older ones die off, so the governor is deliberately slow.
+// Every decision is logged, through the telemetry log.
+
+
+#pragma once
+
+#include "cuckoo/core/logger.h"        // for cuckoo::printf
+#include "cuckoo/maths/maths.h"        // for cuckoo::maths::min, cuckoo::maths::max
+
+#include "particle_config.h"           // for particle_config_t
+
+#include "../../common/telemetry_log.h" // for TELEMETRY_LOG
+
+
+/// @brief see 'FRAME GOVERNOR' above
+class frame_governor_t
+{
+public:
+  static unsigned const WINDOW_FRAMES = 30u;
+  static unsigned const HOLD_WINDOWS = 8u;
+
+  /// @param config the budget, and the spawn rate & workers that are the most the governor will use
+  void initialise (particle_config_t const& config)
+  {
+    budget_seconds = (double)config.frame_budget_ms * 1e-3;
+    max_spawn_rate = config.spawn_rate;
+    min_spawn_rate = cuckoo::maths::max (config.spawn_rate / 64u, 1u);
+    max_threads = config.num_threads;
+
+    spawn_rate = max_spawn_rate;
+    num_threads = max_threads;
+
+    window_update_seconds = window_render_seconds = 0.0;
+    window_frames = 0u;
+    trial_update_seconds = 0.0;
+    hold_windows = 0u;
+    num_decisions = 0u;
+
+    if (is_enabled ())
+    {
+      cuckoo::printf ("governor: %.2f ms budget, spawn rate %u - %u, 1 - %u workers\n",
+        budget_seconds * 1e3, min_spawn_rate, max_spawn_rate, max_threads);
+    }
+  }
+
+  bool is_enabled (void) const { return budget_seconds > 0.0; }
+
+  /// @brief account for a frame's measured times, once a window is complete this may change the work split
+  /// @param update_seconds what simulating the frame cost, particle_system_t::get_simulate_seconds: with PARTICLE_PIPELINED
+  /// the main thread's update only waits for the simulation, which would hide what adding workers or spawning less does
+  /// @return true if get_spawn_rate or get_num_threads changed
+  bool end_frame (double update_seconds, double render_seconds)
+  {
+    if (!is_enabled ())
+    {
+      return false;
+    }
+
+    window_update_seconds += update_seconds;
+    window_render_seconds += render_seconds;
+    if (++window_frames < WINDOW_FRAMES)
+    {
+      return false;
+    }
+
+    double const update = window_update_seconds / (double)window_frames;
+    double const frame = update + window_render_seconds / (double)window_frames;
+    window_update_seconds = window_render_seconds = 0.0;
+    window_frames = 0u;
+
+    bool const is_changed = decide (update, frame);
+    num_decisions += is_changed ? 1u : 0u;
+    return is_changed;
+  }
+
+  unsigned get_spawn_rate (void) const { return spawn_rate; }
+  unsigned get_num_threads (void) const { return num_threads; }
+  unsigned get_num_decisions (void) const { return num_decisions; }
+
+
+private:
+  bool decide (double update, double frame)
+  {
+    // a worker added last window has to earn its keep
+    if (trial_update_seconds > 0.0)
+    {
+      double const before = trial_update_seconds;
+      trial_update_seconds = 0.0;
+      if (update > before * .95)
+      {
+        --num_threads;
+        hold_windows = HOLD_WINDOWS;
+        TELEMETRY_LOG (0u, "governor: worker %u did not help (update %.2f -> %.2f ms), back to %u workers\n",
+          num_threads + 1u, before * 1e3, update * 1e3, num_threads);
+        return true;
+      }
+    }
+    if (hold_windows > 0u)
+    {
+      --hold_windows;
+    }
+
+    if (frame > budget_seconds)
+    {
+      if (num_threads < max_threads && hold_windows == 0u)
+      {
+        trial_update_seconds = update;
+        ++num_threads;
+        TELEMETRY_LOG (0u, "governor: %.2f ms/frame over %.2f ms budget, %u -> %u workers\n",
+          frame * 1e3, budget_seconds * 1e3, num_threads - 1u, num_threads);
+        return true;
+      }
+      if (spawn_rate > min_spawn_rate)
+      {
+        unsigned const previous = spawn_rate;
+        double const scale = cuckoo::maths::max (budget_seconds / frame, .5);
+        spawn_rate = cuckoo::maths::max ((unsigned)((double)spawn_rate * scale), min_spawn_rate);
+        TELEMETRY_LOG (0u, "governor: %.2f ms/frame over %.2f ms budget, spawn rate %u -> %u\n",
+          frame * 1e3, budget_seconds * 1e3, previous, spawn_rate);
+        return true;
+      }
+      return false; // nothing left to give up
+    }
+
+    if (frame < budget_seconds * .8)
+    {
+      if (spawn_rate < max_spawn_rate)
+      {
+        unsigned const previous = spawn_rate;
+        spawn_rate = cuckoo::maths::min (spawn_rate + cuckoo::maths::max (max_spawn_rate / 16u, 1u), max_spawn_rate);
+        TELEMETRY_LOG (0u, "governor: %.2f ms/frame under %.2f ms budget, spawn rate %u -> %u\n",
+          frame * 1e3, budget_seconds * 1e3, previous, spawn_rate);
+        return true;
+      }
+      if (num_threads > 1u && frame < budget_seconds * .5)
+      {
+        --num_threads;
+        TELEMETRY_LOG (0u, "governor: %.2f ms/frame well under %.2f ms budget, %u -> %u workers\n",
+          frame * 1e3, budget_seconds * 1e3, num_threads + 1u, num_threads);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  double   budget_seconds = 0.0;
+  unsigned max_spawn_rate = 0u;
+  unsigned min_spawn_rate = 0u;
+  unsigned max_threads = 0u;
+
+  // the work split asked for
+  unsigned spawn_rate = 0u;
+  unsigned num_threads = 0u;
+
+  // this window's times so far
+  double   window_update_seconds = 0.0;
+  double   window_render_seconds = 0.0;
+  unsigned window_frames = 0u;
+
+  double   trial_update_seconds = 0.0; // the update time before the last worker was added, 0 if not on trial
+  unsigned hold_windows = 0u;          // windows left before another worker can be tried
+  unsigned num_decisions = 0u;
+};
@@ -77,10 +77,22 @@
 
 
 #include "constants.h"       // for PARTICLE_MAX
+#include "particle_config.h" // for particle_config_from_environment
 #include "particle_system.h" // for particle_system_t
+#include "frame_context.h"   // for frame_context_t
+#include "frame_governor.h"  // for frame_governor_t
+
+#include "../../common/telemetry_log.h" // for telemetry_log, TELEMETRY_LOG
+#include "../../common/trace.h"         // for trace_start, trace_write, TRACE_ZONE
+#include "../../common/perf_counters.h" // for perf_profile, perf_zone_t
+#include "../../common/fixed_timestep.h" // for fixed_timestep_t, fixed_timestep_from_environment
+#define ALLOC_TRACKER_IMPLEMENTATION    // the counting operators new & delete live here
+#include "../../common/alloc_tracker.h" // for alloc_tracker, ALLOC_ZONE
 
 #include "pigeon/pigeon.h"   // for pigeon window/rendering components
 
+#include <cstdio>            // for std::fopen, std::fclose, FILE
+#include <cstdlib>           // for std::getenv, std::strtoul
 #include <optional>          // for
 #include <string>            // for
 #include "Timer.h"
@@ -119,14 +131,63 @@ ENTRY_POINT
 
   // SETUP
 
+  // the per-frame output is written out by the telemetry log's own thread, to SHOT_LOG_FILE if set, otherwise as before
+  FILE* log_file = std::getenv ("SHOT_LOG_FILE") ? std::fopen (std::getenv ("SHOT_LOG_FILE"), "w") : nullptr;
+  if (log_file)
+  {
+    telemetry_log.start (telemetry_log_t::file_sink, log_file);
+  }
+  else
+  {
+    telemetry_log.start ([] (char const* text, void*) { cuckoo::printf ("%s", text); }, nullptr);
+  }
+
+  // a timeline of every thread's work, written to SHOT_TRACE (if set) on exit, see common/trace.h
+  char const* trace_path = std::getenv ("SHOT_TRACE");
+  if (trace_path)
+  {
+    trace_set_lane (TRACE_LANE_MAIN, "main");
+    trace_start (1u << 22);
+  }
+
+  // hardware counters (cache & branch misses, IPC) per particle, with SHOT_PERF set, see common/perf_counters.h
+  // (opened before the particle system starts any threads, so they are counted too)
+  if (std::getenv ("SHOT_PERF") && !perf_profile.open ())
+  {
+    cuckoo::printf ("perf: no counters could be opened (see /proc/sys/kernel/perf_event_paranoid)\n");
+  }
+
+  // heap allocations per frame & zone with SHOT_ALLOC set, SHOT_ZERO_ALLOC=N asserts on any after N frames, see common/alloc_tracker.h
+  alloc_tracker.set_reporting (std::getenv ("SHOT_ALLOC") != nullptr);
+  if (char const* warmup_frames = std::getenv ("SHOT_ZERO_ALLOC"))
+  {
+    alloc_tracker.enforce_after ((unsigned)std::strtoul (warmup_frames, nullptr, 10));
+  }
+
   particle_system_t particle_system;
-  if (!particle_system.initialise ())
+  if (!particle_system.initialise (particle_config_from_environment ()))
   {
     CUCKOO_ASSERT (!"particle_system.initialise failed");
   }
 
+  // start from a saved world with SHOT_CHECKPOINT_LOAD, save the final one to SHOT_CHECKPOINT_SAVE, see common/world_checkpoint.h
+  if (char const* checkpoint_path = std::getenv ("SHOT_CHECKPOINT_LOAD"))
+  {
+    bool const is_loaded = particle_system.load_checkpoint (checkpoint_path);
+    cuckoo::printf ("checkpoint: %s %s\n", is_loaded ? "loaded from" : "FAILED to load", checkpoint_path);
+  }
+
   long long num_active_particles = 0;
 
+  frame_context_t frame_context;
+
+  // the particles advance in fixed ticks, whatever the frame rate, see common/fixed_timestep.h
+  fixed_timestep_t timestep = fixed_timestep_from_environment ();
+
+  // adapts the spawn rate & workers to SHOT2_FRAME_BUDGET, if set
+  frame_governor_t governor;
+  governor.initialise (particle_system.get_config ());
+
 
   unsigned long long const clock_frequency = cuckoo::get_cpu_frequency ();
   // frame timer
@@ -139,6 +200,8 @@ ENTRY_POINT
   // GAME LOOP
   while (pigeon::gfx::driver::process_os_messages ())
   {
+    TRACE_ZONE ("frame");
+
       timer.end_timer();
       float ElapsedSeconds = timer.get_elapsed_time_secs();
       timer.start_timer();
@@ -146,8 +209,8 @@ ENTRY_POINT
       unsigned long long const ticks_frame_end = cuckoo::get_cpu_time (); // end frame timer
       double const elapsed_seconds = (double)(ticks_frame_end - ticks_frame_start) / (double)clock_frequency;
       ticks_frame_start = cuckoo::get_cpu_time (); // start frame timer
-      cuckoo::printf ("frame : %.5f seconds\n", elapsed_seconds);
-      cuckoo::printf ("FrameTimer : %.5f seconds\n", ElapsedSeconds); // print out the frame times
+      TELEMETRY_LOG (0u, "frame : %.5f seconds\n", elapsed_seconds);
+      TELEMETRY_LOG (0u, "FrameTimer : %.5f seconds\n", ElapsedSeconds); // print out the frame times
       
 
 
@@ -156,14 +219,24 @@ ENTRY_POINT
 
 
     // UPDATE
+    // (with PARTICLE_PIPELINED this only waits for last frame's update & starts the next one,
+    //  the simulation itself overlaps with render, see particle_system_t::update)
     {
-      particle_system.update (elapsed_seconds, num_active_particles);
+      TRACE_ZONE ("update");
+      ALLOC_ZONE ("update");
+      perf_zone_t perf_zone ("update");
+      frame_context_capture (frame_context);
+      timestep.advance (elapsed_seconds);
+      particle_system.update (frame_context, timestep, num_active_particles);
+      perf_zone.set_entities ((unsigned long long)num_active_particles);
     }
 
 
     unsigned long long const ticks_update_end = cuckoo::get_cpu_time (); // end update timer 
     double const elapsed_seconds_update = (double)(ticks_update_end - ticks_update_start) / (double)clock_frequency;
-    cuckoo::printf ("update: %.5f seconds\n", elapsed_seconds_update);
+    TELEMETRY_LOG (0u, "update: %.5f seconds\n", elapsed_seconds_update);
+
+    unsigned long long const ticks_render_start = cuckoo::get_cpu_time (); // start render timer
 
 
 ////////////////////////////////////////////////
@@ -182,6 +255,8 @@ ENTRY_POINT
 ////////////////////////////////////////////////
 
 
+        ALLOC_ZONE ("render");
+        perf_zone_t const perf_zone ("render", (unsigned long long)num_active_particles);
         particle_system.render ();
 
 
@@ -198,18 +273,59 @@ ENTRY_POINT
 //// <<< DO NOT EDIT/DELETE/MOVE CODE ABOVE ////
 ////////////////////////////////////////////////
 
+    unsigned long long const ticks_render_end = cuckoo::get_cpu_time (); // end render timer
+    double const elapsed_seconds_render = (double)(ticks_render_end - ticks_render_start) / (double)clock_frequency;
+
+    // FRAME BUDGET
+    // (the simulation's own time, as with PARTICLE_PIPELINED the update above only waited for it)
+    if (governor.end_frame (particle_system.get_simulate_seconds (), elapsed_seconds_render))
+    {
+      particle_system.set_work_split (governor.get_spawn_rate (), governor.get_num_threads ());
+    }
+    perf_profile.end_frame ();
+    if (!alloc_tracker.end_frame ())
+    {
+      telemetry_log.stop (); // so what allocated is written out first
+      CUCKOO_ASSERT (!"the game loop allocated, see SHOT_ZERO_ALLOC");
+    }
+
 
-    cuckoo::printf ("\nnumber of active particles = %d, All paricles are active: %s, ns/P = %.2f\n",
+    TELEMETRY_LOG (0u, "\nnumber of active particles = %lld, All paricles are active: %s, ns/P = %.2f\n",
       num_active_particles,                                             // number of active particles
-      num_active_particles == PARTICLE_MAX ? "YES" : "NO",              // all particles are active?
+      num_active_particles == particle_system.get_config ().max_particles ? "YES" : "NO", // all particles are active?
       elapsed_seconds * 1'000'000'000.f / (float)num_active_particles); // time (ns) per particle
   }
 
 
   // RELEASE RESOURCES
   {
+    if (char const* checkpoint_path = std::getenv ("SHOT_CHECKPOINT_SAVE"))
+    {
+      bool const is_saved = particle_system.save_checkpoint (checkpoint_path);
+      cuckoo::printf ("checkpoint: %s %s\n", is_saved ? "saved to" : "FAILED to save", checkpoint_path);
+    }
     particle_system.release ();
 
+    if (perf_profile.is_enabled ())
+    {
+      perf_profile.report ([] (char const* text, void*) { cuckoo::printf ("%s", text); }, nullptr);
+      perf_profile.close ();
+    }
+
+    // every traced thread has been joined by now
+    if (trace_path)
+    {
+      trace_stop ();
+      cuckoo::printf ("trace: %s %s\n", trace_write (trace_path, "SHOT2") ? "written to" : "FAILED to write", trace_path);
+    }
+
+    // write out whatever is still queued
+    telemetry_log.stop ();
+    if (log_file)
+    {
+      std::fclose (log_file);
+    }
+
 
 ////////////////////////////////////////////////
 //// DO NOT EDIT/DELETE/MOVE CODE BELOW >>> ////
@@ -0,0 +1,196 @@
+// MORTON ORDER:
+//
+// Particles are stored in emission order, so consecutive particles are scattered all over the screen,
+// and so are the consecutive points submitted for render.
+// Sorting the particles by the Z-order (Morton) key of their screen position puts particles that are close on screen
+// close together in memory, in the point stream & in whatever buffers render writes them to.
+// The particles keep moving, so the order decays and is restored every particle_config_t::reorder_interval frames,
+// which amortises the cost of the sort over the frames in between.
+//
+// The sort is an LSD radix sort of (key, index) pairs, one pass per KEY_DIGIT_BITS of key,
+// each pass is the same count / exclusive prefix sum / scatter as the particle pool's compaction:
+//   1. COUNT   | each worker builds a histogram of the current digit over its chunk (the first pass also makes the keys)
+//   2. SUM     | exclusive prefix sum, digit major then worker, gives each (digit, worker) its output offset
+//   3. SCATTER | each worker moves its chunk's pairs to their offsets, which keeps the sort stable
+// and then the particles themselves are gathered into sorted order in a single parallel pass,
+// so each particle is only moved once, rather than once per pass.
+
+
+#pragma once
+
+#include "cuckoo/core/asserts.h"       // for CUCKOO_ASSERT
+#include "cuckoo/maths/maths.h"        // for cuckoo::maths::min, cuckoo::maths::max
+
+#include "particle_config.h"           // for particle_config_t, MAX_THREADS
+#include "particle.h"                  // for particle
+
+#include "../../common/page_buffer.h"  // for page_buffer_t
+#include "../../common/trace.h"        // for TRACE_ZONE
+#include "../../common/worker_pool.h"  // for worker_pool_t
+
+#include <vector>                      // for std::vector
+
+
+/// @brief spread the low 10 bits of x out to the even bits
+static unsigned morton_part_1_by_1 (unsigned x)
+{
+  x &= 0x3ffu;
+  x = (x | (x << 8u)) & 0x00ff00ffu;
+  x = (x | (x << 4u)) & 0x0f0f0f0fu;
+  x = (x | (x << 2u)) & 0x33333333u;
+  x = (x | (x << 1u)) & 0x55555555u;
+  return x;
+}
+
+/// @brief Z-order key of a 1024 x 1024 grid cell
+static unsigned morton_encode (unsigned column, unsigned row)
+{
+  return morton_part_1_by_1 (column) | (morton_part_1_by_1 (row) << 1u);
+}
+
+/// @brief see 'MORTON ORDER' above
+class morton_sorter_t
+{
+public:
+  static unsigned const GRID_BITS = 10u;                      // per axis
+  static unsigned const KEY_BITS = 2u * GRID_BITS;
+  static unsigned const KEY_DIGIT_BITS = 10u;
+  static unsigned const NUM_DIGITS = 1u << KEY_DIGIT_BITS;
+  static unsigned const NUM_PASSES = (KEY_BITS + KEY_DIGIT_BITS - 1u) / KEY_DIGIT_BITS;
+
+  /// @param workers_ the owner's workers, started with at least config_.num_threads
+  void initialise (particle_config_t const& config_, worker_pool_t& workers_)
+  {
+    config = config_;
+    workers = &workers_;
+    for (unsigned i = 0u; i < 2u; ++i)
+    {
+      keys [i].allocate (config.max_particles, config.page_mode);
+      indices [i].allocate (config.max_particles, config.page_mode);
+    }
+    histograms.assign ((size_t)config.num_threads * NUM_DIGITS, 0u);
+  }
+
+  /// @brief write source [0, count) to destination [0, count) in Morton order of screen position
+  /// @param screen_width, screen_height the keys cover the screen, particles off screen are clamped to its edges
+  void sort (particle const* source, particle* destination, unsigned count, unsigned screen_width, unsigned screen_height)
+  {
+    CUCKOO_ASSERT (count <= config.max_particles);
+    unsigned const num_threads = config.num_threads;
+    unsigned const chunk_size = (count + num_threads - 1u) / num_threads;
+    auto chunk_begin = [=] (unsigned worker) { return cuckoo::maths::min (worker * chunk_size, count); };
+    auto chunk_end = [=] (unsigned worker) { return cuckoo::maths::min ((worker + 1u) * chunk_size, count); };
+
+    // screen position to grid cell, top row first
+    float const grid_size = (float)(1u << GRID_BITS);
+    float const column_scale = grid_size / (float)cuckoo::maths::max (screen_width, 1u);
+    float const row_scale = grid_size / (float)cuckoo::maths::max (screen_height, 1u);
+    float const half_width = (float)screen_width * .5f;
+    float const half_height = (float)screen_height * .5f;
+    float const max_cell = grid_size - 1.f;
+
+    unsigned in = 0u;
+    for (unsigned pass = 0u; pass < NUM_PASSES; ++pass)
+    {
+      unsigned const shift = pass * KEY_DIGIT_BITS;
+
+      // 1. COUNT
+      run_workers ([&] (unsigned worker)
+      {
+        unsigned* histogram = histograms.data () + (size_t)worker * NUM_DIGITS;
+        for (unsigned digit = 0u; digit < NUM_DIGITS; ++digit)
+        {
+          histogram [digit] = 0u;
+        }
+
+        unsigned* worker_keys = keys [in].data ();
+        if (pass == 0u)
+        {
+          unsigned* worker_indices = indices [in].data ();
+          for (unsigned i = chunk_begin (worker); i < chunk_end (worker); ++i)
+          {
+            float const column = cuckoo::maths::min (cuckoo::maths::max ((source [i].position_x + half_width) * column_scale, 0.f), max_cell);
+            float const row = cuckoo::maths::min (cuckoo::maths::max ((half_height - source [i].position_y) * row_scale, 0.f), max_cell);
+            worker_keys [i] = morton_encode ((unsigned)column, (unsigned)row);
+            worker_indices [i] = i;
+          }
+        }
+        for (unsigned i = chunk_begin (worker); i < chunk_end (worker); ++i)
+        {
+          ++histogram [(worker_keys [i] >> shift) & (NUM_DIGITS - 1u)];
+        }
+      });
+
+      // 2. SUM
+      unsigned offset = 0u;
+      for (unsigned digit = 0u; digit < NUM_DIGITS; ++digit)
+      {
+        for (unsigned worker = 0u; worker < num_threads; ++worker)
+        {
+          unsigned& bucket = histograms [(size_t)worker * NUM_DIGITS + digit];
+          unsigned const bucket_count = bucket;
+          bucket = offset;
+          offset += bucket_count;
+        }
+      }
+      CUCKOO_ASSERT (offset == count);
+
+      // 3. SCATTER
+      unsigned const out = in ^ 1u;
+      run_workers ([&] (unsigned worker)
+      {
+        unsigned* offsets = histograms.data () + (size_t)worker * NUM_DIGITS;
+        unsigned const* in_keys = keys [in].data ();
+        unsigned const* in_indices = indices [in].data ();
+        unsigned* out_keys = keys [out].data ();
+        unsigned* out_indices = indices [out].data ();
+        for (unsigned i = chunk_begin (worker); i < chunk_end (worker); ++i)
+        {
+          unsigned const position = offsets [(in_keys [i] >> shift) & (NUM_DIGITS - 1u)]++;
+          out_keys [position] = in_keys [i];
+          out_indices [position] = in_indices [i];
+        }
+      });
+      in = out;
+    }
+
+    // GATHER
+    unsigned const* sorted = indices [in].data ();
+    run_workers ([&] (unsigned worker)
+    {
+      for (unsigned i = chunk_begin (worker); i < chunk_end (worker); ++i)
+      {
+        destination [i] = source [sorted [i]];
+      }
+    });
+  }
+
+  void release (void)
+  {
+    for (unsigned i = 0u; i < 2u; ++i)
+    {
+      keys [i].release ();
+      indices [i].release ();
+    }
+    histograms = {};
+  }
+
+
+private:
+  /// @brief run function (worker) on every worker & wait for them all
+  template <typename function_t>
+  void run_workers (function_t const& function) const
+  {
+    workers->run (config.num_threads, [&function] (unsigned worker)
+    {
+      TRACE_ZONE ("morton sort");
+      function (worker);
+    });
+  }
+
+  particle_config_t          config;
+  worker_pool_t*             workers = nullptr;
+  page_buffer_t <unsigned>   keys [2];
+  page_buffer_t <unsigned>   indices [2];
+  std::vector <unsigned>     histograms; // [worker][digit], counts then offsets
+};
@@ -0,0 +1,162 @@
+// A particle that is integrated every frame, see 'HOW IT WORKS' in particle_system.h.
+// Shared by every PARTICLE_MODE that stores & updates particles individually.
+
+
+#pragma once
+
+#include "cuckoo/core/asserts.h"       // for CUCKOO_ASSERT
+#include "cuckoo/core/logger.h"        // for cuckoo::printf
+#include "cuckoo/maths/maths.h"        // for cuckoo::maths::lerp, ...
+
+#include "constants.h"                 // for NUM_PARTICLE_TYPES, PARTICLE_MAX
+#include "particle_types.h"            // for particle_type_info_t, point_t
+
+#include "../../common/random.h"       // for random_t, random_fill_uniform
+
+
+// PARTICLES
+
+/// @brief a single particle, stored by value (e.g. in a particle_pool_t)
+/// Only the state that differs between particles is kept here (in float32),
+/// everything else is looked up in the particle type table via 'type'.
+/// The colour is not stored at all, it is derived from life_remaining / life_time when the particle is packed for render.
+struct particle
+{
+  float position_x;
+  float position_y;
+  float velocity_x;
+  float velocity_y;
+
+  float life_time;
+  float life_remaining;
+
+  particle_type_t type;
+};
+static_assert (sizeof (particle) < 32u, "particle should fit in under 32 bytes");
+
+/// @brief is the particle expired and in need of removal?
+/// the same test is used by every particle type (the order of the 2 checks never changed the result)
+static bool particle_is_dead (particle const& p, particle_type_info_t const types [NUM_PARTICLE_TYPES])
+{
+  return p.life_remaining <= 0.f || p.position_y < types [p.type].kill_y;
+}
+
+/// @brief update particle's position & lifetime
+/// @param elapsed_seconds elapsed time since last frame
+/// @return true, if particle has expired and needs removing
+static bool particle_process (particle& p, particle_type_info_t const types [NUM_PARTICLE_TYPES], float elapsed_seconds)
+{
+  particle_type_info_t const& type = types [p.type];
+
+  // update linear motion
+  p.position_x += p.velocity_x * elapsed_seconds;
+  p.position_y += p.velocity_y * elapsed_seconds;
+
+  p.velocity_x += type.acceleration_x * elapsed_seconds;
+  p.velocity_y += type.acceleration_y * elapsed_seconds;
+
+  // update life remaining
+  p.life_remaining -= elapsed_seconds;
+
+  // is particle still alive?
+  return particle_is_dead (p, types);
+}
+
+/// @brief get the particle's colour, as it was when it was last processed
+/// The colour is the ratio of life remaining to life time BEFORE that frame's lifetime update,
+/// hence 'elapsed_seconds' (the last frame's time step) is added back on.
+static colourf particle_colour (particle const& p, particle_type_info_t const types [NUM_PARTICLE_TYPES], float elapsed_seconds)
+{
+  particle_type_info_t const& type = types [p.type];
+  float const t = (p.life_remaining + elapsed_seconds) / p.life_time;
+
+  return { cuckoo::maths::lerp (type.end_colour.r, type.start_colour.r, t),
+    cuckoo::maths::lerp (type.end_colour.g, type.start_colour.g, t),
+    cuckoo::maths::lerp (type.end_colour.b, type.start_colour.b, t),
+    cuckoo::maths::lerp (type.end_colour.a, type.start_colour.a, t) };
+}
+
+
+/// @brief convert a processed particle into the renderer's layout
+/// @param lag_seconds how far behind the latest tick to draw it (see common/fixed_timestep.h),
+/// the particle is moved back along its velocity rather than keeping its previous position, 0 draws it where it is
+static point_t particle_pack (particle const& p, particle_type_info_t const types [NUM_PARTICLE_TYPES], float elapsed_seconds, float lag_seconds)
+{
+  colourf const colour = particle_colour (p, types, elapsed_seconds);
+  return { p.position_x - p.velocity_x * lag_seconds, p.position_y - p.velocity_y * lag_seconds,
+    vec4 (colour.r, colour.g, colour.b, colour.a) };
+}
+
+/// @brief convert a newly emitted particle into the renderer's layout
+/// a particle has no colour until it has been processed for the first time
+static point_t particle_pack_new (particle const& p)
+{
+  return { p.position_x, p.position_y, vec4 (0.f, 0.f, 0.f, 0.f) };
+}
+
+// EMISSION
+
+/// @brief emit 'count' particles of a single type into the consecutive slots [offset, offset + count)
+/// The frame's spawn budget has already been worked out, so this costs only as much as the particles it creates.
+/// Each batch of particles is created in 2 passes:
+/// 1. draw all of the batch's random numbers, in bulk
+/// 2. turn them into particles using the type's emitter ranges, with no branches, so the compiler can vectorise it
+/// @param random this worker's random number stream
+/// @param particles particle storage
+/// @param points render staging buffer, if not null each new particle is also packed into it at the same index
+/// @param types particle type table
+static void emit_batch (random_t& random, particle* particles, point_t* points, particle_type_info_t const types [NUM_PARTICLE_TYPES],
+  particle_type_t type, unsigned offset, unsigned count)
+{
+  unsigned const BATCH_SIZE = 256u;
+  particle_type_info_t const& info = types [type];
+
+  for (unsigned batch = 0u; batch < count; batch += BATCH_SIZE)
+  {
+    unsigned const batch_count = cuckoo::maths::min (BATCH_SIZE, count - batch);
+
+    // 1. RANDOM NUMBERS
+    float uniform [5][BATCH_SIZE];
+    for (unsigned r = 0u; r < 5u; ++r)
+    {
+      random_fill_uniform (random, uniform [r], batch_count, 0.f, 1.f);
+    }
+
+    // 2. PARTICLES
+    particle* out = particles + offset + batch;
+    for (unsigned i = 0u; i < batch_count; ++i)
+    {
+      float const life_time = cuckoo::maths::lerp (info.life_time_min, info.life_time_max, uniform [0][i]);
+      out [i].life_time      = life_time;
+      out [i].life_remaining = life_time;
+      out [i].position_x     = cuckoo::maths::lerp (info.position_x_min, info.position_x_max, uniform [1][i]);
+      out [i].position_y     = cuckoo::maths::lerp (info.position_y_min, info.position_y_max, uniform [2][i]);
+      out [i].velocity_x     = cuckoo::maths::lerp (info.velocity_x_min, info.velocity_x_max, uniform [3][i]);
+      out [i].velocity_y     = cuckoo::maths::lerp (info.velocity_y_min, info.velocity_y_max, uniform [4][i]);
+      out [i].type           = type;
+    }
+
+    if (points)
+    {
+      point_t* out_points = points + offset + batch;
+      for (unsigned i = 0u; i < batch_count; ++i)
+      {
+        out_points [i] = particle_pack_new (out [i]);
+      }
+    }
+  }
+}
+
+/// @brief emit a worker's share of the frame's new particles into [offset, offset + count)
+/// particles are split evenly between each type, each type is emitted as one consecutive batch
+static void emit (random_t& random, particle* particles, point_t* points, particle_type_info_t const types [NUM_PARTICLE_TYPES],
+  unsigned offset, unsigned count)
+{
+  for (particle_type_t type = 0u; type < NUM_PARTICLE_TYPES; ++type)
+  {
+    // any remainder goes to the first types, as it did when types were emitted in turn
+    unsigned const type_count = count / NUM_PARTICLE_TYPES + (type < count % NUM_PARTICLE_TYPES ? 1u : 0u);
+    emit_batch (random, particles, points, types, type, offset, type_count);
+    offset += type_count;
+  }
+}
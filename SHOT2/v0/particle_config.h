@@ -0,0 +1,143 @@
+// PARTICLE CONFIG:
+//
+// PARTICLE_MAX, PARTICLE_SPAWN_RATE & NUM_THREADS (constants.h) are only the defaults,
+// the particle system is sized & threaded from a particle_config_t chosen at startup, so much larger populations
+// (8M - 64M particles) and other worker counts can be tried without rebuilding.
+// SHOT2 reads it from the environment:
+//   SHOT2_PARTICLE_MAX  | particle capacity
+//   SHOT2_SPAWN_RATE    | particles spawned per frame
+//   SHOT2_NUM_THREADS   | workers, 1 to MAX_THREADS
+//   SHOT2_PAGES         | small, transparent or explicit, how the particle storage is backed (see common/page_buffer.h)
+//   SHOT2_REORDER       | frames between Morton reorders of the pool, 0 for never (see morton_order.h)
+//   SHOT2_AFFECTORS     | comma separated force fields, any of wind, vortex & turbulence, or none (see force_field.h)
+//   SHOT2_FRAME_BUDGET  | frame time budget in milliseconds, 0 for none (see frame_governor.h)
+
+
+#pragma once
+
+#include "cuckoo/core/logger.h"        // for cuckoo::printf
+#include "cuckoo/maths/maths.h"        // for cuckoo::maths::min, cuckoo::maths::max
+
+#include "constants.h"                 // for PARTICLE_MAX, PARTICLE_SPAWN_RATE, NUM_THREADS & the other defaults
+
+#include "../../common/page_buffer.h"  // for page_mode_t
+
+#include <cstdlib>                     // for std::getenv, std::strtoul, std::strtod
+#include <cstring>                     // for std::strlen, std::strncmp
+
+
+// the most workers a particle system can be configured with, sizes the per-worker arrays
+static unsigned const MAX_THREADS = 64u;
+
+struct particle_config_t
+{
+  unsigned    max_particles = PARTICLE_MAX;
+  unsigned    spawn_rate = PARTICLE_SPAWN_RATE;
+  unsigned    num_threads = NUM_THREADS;
+  page_mode_t page_mode = PAGE_MODE_TRANSPARENT;
+  unsigned    reorder_interval = PARTICLE_REORDER_INTERVAL;
+  unsigned    affectors = PARTICLE_AFFECTORS; // PARTICLE_AFFECTOR_* flags
+  float       frame_budget_ms = PARTICLE_FRAME_BUDGET_MS;
+};
+
+/// @brief clamp a config to what the particle system supports
+/// @return false if anything had to be changed
+inline bool particle_config_validate (particle_config_t& config)
+{
+  particle_config_t const original = config;
+
+  // particle indices & counts are 32 bit, and the ring mode needs slots for twice max_particles + spawn_rate
+  unsigned const max_particles_limit = 1u << 28;
+  config.max_particles = cuckoo::maths::min (cuckoo::maths::max (config.max_particles, 1u), max_particles_limit);
+  config.spawn_rate = cuckoo::maths::min (cuckoo::maths::max (config.spawn_rate, 1u), config.max_particles);
+  config.num_threads = cuckoo::maths::min (cuckoo::maths::max (config.num_threads, 1u), MAX_THREADS);
+  config.affectors &= PARTICLE_AFFECTOR_WIND | PARTICLE_AFFECTOR_VORTEX | PARTICLE_AFFECTOR_TURBULENCE;
+  config.frame_budget_ms = cuckoo::maths::max (config.frame_budget_ms, 0.f);
+
+  return config.max_particles == original.max_particles && config.spawn_rate == original.spawn_rate && config.num_threads == original.num_threads;
+}
+
+/// @brief parse a comma separated list of affector names, e.g. "wind,turbulence", "none" for no affectors
+/// @return false if any name is not an affector, 'affectors' is left unchanged
+inline bool particle_affectors_from_names (char const* names, unsigned& affectors)
+{
+  static struct { char const* name; unsigned flag; } const table [] =
+  {
+    { "none", 0u },
+    { "wind", PARTICLE_AFFECTOR_WIND },
+    { "vortex", PARTICLE_AFFECTOR_VORTEX },
+    { "turbulence", PARTICLE_AFFECTOR_TURBULENCE },
+  };
+
+  unsigned parsed = 0u;
+  while (*names)
+  {
+    size_t length = 0u;
+    while (names [length] && names [length] != ',')
+    {
+      ++length;
+    }
+    bool found = false;
+    for (auto const& entry : table)
+    {
+      if (std::strlen (entry.name) == length && std::strncmp (names, entry.name, length) == 0)
+      {
+        parsed |= entry.flag;
+        found = true;
+      }
+    }
+    if (!found)
+    {
+      return false;
+    }
+    names += names [length] ? length + 1u : length;
+  }
+  affectors = parsed;
+  return true;
+}
+
+/// @brief the default config, overridden by any of the SHOT2_* environment variables (see 'PARTICLE CONFIG' above)
+inline particle_config_t particle_config_from_environment (void)
+{
+  particle_config_t config;
+
+  auto read_unsigned = [] (char const* name, unsigned& value)
+  {
+    if (char const* text = std::getenv (name))
+    {
+      value = (unsigned)std::strtoul (text, nullptr, 0);
+    }
+  };
+  read_unsigned ("SHOT2_PARTICLE_MAX", config.max_particles);
+  read_unsigned ("SHOT2_SPAWN_RATE", config.spawn_rate);
+  read_unsigned ("SHOT2_NUM_THREADS", config.num_threads);
+  read_unsigned ("SHOT2_REORDER", config.reorder_interval);
+
+  if (char const* text = std::getenv ("SHOT2_FRAME_BUDGET"))
+  {
+    config.frame_budget_ms = (float)std::strtod (text, nullptr);
+  }
+
+  if (char const* text = std::getenv ("SHOT2_PAGES"))
+  {
+    if (!page_mode_from_name (text, config.page_mode))
+    {
+      cuckoo::printf ("SHOT2_PAGES: unknown page mode '%s', using '%s'\n", text, page_mode_name (config.page_mode));
+    }
+  }
+
+  if (char const* text = std::getenv ("SHOT2_AFFECTORS"))
+  {
+    if (!particle_affectors_from_names (text, config.affectors))
+    {
+      cuckoo::printf ("SHOT2_AFFECTORS: unknown affector in '%s', expected wind, vortex, turbulence or none\n", text);
+    }
+  }
+
+  if (!particle_config_validate (config))
+  {
+    cuckoo::printf ("particle config clamped to: %u particles, %u spawned per frame, %u threads\n",
+      config.max_particles, config.spawn_rate, config.num_threads);
+  }
+  return config;
+}
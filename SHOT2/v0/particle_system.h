@@ -29,380 +29,313 @@
 #include "pigeon/gfx/point_renderer.h" // for pigeon::gfx::point_renderer
 
 #include "constants.h"
-
-
-#include <list>                        // for std::list
-#include <random>                      // for std::random_device, std::uniform_real_distribution, std::uniform_int_distribution
-
+#include "particle_config.h"           // for particle_config_t, MAX_THREADS
+#include "particle_types.h"            // for particle_type_info_t, point_t
+#include "frame_context.h"             // for frame_context_t
+#include "particle.h"                  // for particle, particle_process, emit
+#include "analytic_particles.h"        // for analytic_particles_t
+#include "ring_particles.h"            // for ring_particles_t
+#include "morton_order.h"              // for morton_sorter_t
+#include "force_field.h"               // for force_field_t, force_field_build, force_field_apply
+
+#include "../../common/page_buffer.h"  // for page_buffer_t
+#include "../../common/telemetry_log.h" // for TELEMETRY_LOG
+#include "../../common/trace.h"        // for TRACE_ZONE, TRACE_LANE_*
+#include "../../common/worker_pool.h"  // for worker_pool_t
+#include "../../common/fixed_timestep.h" // for fixed_timestep_t
+#include "../../common/world_checkpoint.h" // for world_checkpoint_t, world_checkpoint_writer_t, WORLD_CHECKPOINT_ID
+
+#include <chrono>                      // for std::chrono::steady_clock
 #include <vector>                      // for std::vector
-#include <thread>                      // for threads
 
+// checkpoints, see common/world_checkpoint.h & particle_system_t::save_checkpoint
+static uint32_t const PARTICLE_CHECKPOINT_APP = WORLD_CHECKPOINT_ID ('S', 'H', 'T', '2');
+static uint32_t const PARTICLE_CHECKPOINT_LAYOUT = 1u; // bump when particle, point_t, random_t, particle_type_info_t or particle_checkpoint_state_t change
+static uint32_t const PARTICLE_CHECKPOINT_STATE = WORLD_CHECKPOINT_ID ('P', 'S', 'T', 'A');
+static uint32_t const PARTICLE_CHECKPOINT_PARTICLES = WORLD_CHECKPOINT_ID ('P', 'P', 'O', 'L');
+static uint32_t const PARTICLE_CHECKPOINT_POINTS = WORLD_CHECKPOINT_ID ('P', 'P', 'T', 'S');
+static uint32_t const PARTICLE_CHECKPOINT_RANDOM = WORLD_CHECKPOINT_ID ('P', 'R', 'N', 'G');
+static uint32_t const PARTICLE_CHECKPOINT_TYPES = WORLD_CHECKPOINT_ID ('P', 'T', 'Y', 'P');
 
 
-// UTILITY
+// PARTICLE POOL
 
-struct vector4
+/// @brief dense, preallocated particle storage
+/// Live particles always occupy [0, count) of the front buffer.
+/// Each frame the survivors are compacted into the back buffer and the buffers are swapped,
+/// so no particle is ever individually allocated or released.
+struct particle_pool_t
 {
-  double x;
-  double y;
-  double z;
-  double w;
+  particle* front (void) { return buffers [front_index].data (); }
+  particle* back (void) { return buffers [front_index ^ 1u].data (); }
+  void swap (void) { front_index ^= 1u; }
+
+  page_buffer_t <particle> buffers [2];
+  page_buffer_t <point_t>  points;   // render staging buffer, only used when PARTICLE_FUSED_PACK
+  unsigned front_index = 0u;
+  unsigned count = 0u;
+
+  unsigned num_emitted = 0u;         // the last num_emitted particles of [0, count) have not been processed yet
+  float    elapsed_seconds = 0.f;    // time step of the last update, needed to colour the processed particles
+  float    lag_seconds = 0.f;        // how far behind the last update the processed particles are drawn, see particle_pack
 };
 
-struct colourf
+/// @brief one frame's points, packed & ready to submit for render, see PARTICLE_PIPELINED
+struct particle_snapshot_t
 {
-  double r;
-  double g;
-  double b;
-  double a;
+  page_buffer_t <point_t> points;
+  unsigned count = 0u;
 };
 
-
-/// @brief returns a random number between min and max inclusive
-/// @param min minimum random number (inclusive)
-/// @param max maximum random number (inclusive)
-/// @return random number between min & max (inclusive)
-static double random_getd (double min, double max)
+/// @brief the pool's bookkeeping, as written to a checkpoint
+struct particle_checkpoint_state_t
 {
-  CUCKOO_ASSERT (max >= min);
-
-
-  static std::random_device rd;
-  std::uniform_real_distribution <double> distribution (min, max);
-
-  return distribution (rd);
-}
-
-
-
-// PARTICLES
-
-class particle
-{
-public:
-  virtual ~particle () = default;
-
-  /// @brief update particle's position, lifetime & colour
-  /// @param elapsed_seconds elapsed time since last frame
-  /// @return true, if particle has expired and needs deleting
-  virtual bool process (double elapsed_seconds) = 0;
-
-  double  life_time = {};
-  double  life_remaining = {};
-  double  kill_y = {};
-
-  vector4 position = {};
-  vector4 velocity = {};
-  vector4 acceleration = {};
-
-  colourf colour = {};
-  colourf start_colour = {};
-  colourf end_colour = {};
+  unsigned count;
+  unsigned num_emitted;
+  float    elapsed_seconds;
+  float    lag_seconds;
+  unsigned frames_since_reorder;
+  unsigned is_points_packed;           // the staging points were written too, PARTICLE_FUSED_PACK
 };
 
-class particle_a : public particle
+/// @brief what the Morton reorders have cost so far, see morton_order.h
+struct particle_reorder_stats_t
 {
-public:
-  particle_a ()
-  {
-    // left hand side of screen
-
-    life_time = life_remaining = random_getd (7.5, 13.0);
-    kill_y = -(double)pigeon::gfx::driver::get_screen_size ().y / 2.0;
-
-    position = { -(double)pigeon::gfx::driver::get_screen_size ().x / 2.0 + random_getd (0.0, 200.0),
-      -(double)pigeon::gfx::driver::get_screen_size ().y / 2.0 + random_getd (0.0, 100.0),
-      0.0, 0.0 };
-    velocity = { random_getd (cuckoo::maths::cos (cuckoo::maths::radians (89.0)), cuckoo::maths::cos (cuckoo::maths::radians (75.0))) * 200.f,
-      random_getd (cuckoo::maths::sin (cuckoo::maths::radians (75.0)), cuckoo::maths::sin (cuckoo::maths::radians (89.0))) * 200.f,
-      0.0, 0.0 };
-    acceleration = { 2.0, -26.5, 0.0, 0.0 };
-
-    start_colour = { 1.0, 0.2, 0.2, 1.0 }; // red
-    end_colour = { 0.2, 1.0, 1.0, 1.0 }; // inverse red
-  }
-
-  bool process (double elapsed_seconds) override
-  {
-    // update linear motion
-    position.x += velocity.x * elapsed_seconds;
-    position.y += velocity.y * elapsed_seconds;
-    position.z += velocity.z * elapsed_seconds;
-    position.w += velocity.w * elapsed_seconds;
-
-    velocity.x += acceleration.x * elapsed_seconds;
-    velocity.y += acceleration.y * elapsed_seconds;
-    velocity.z += acceleration.z * elapsed_seconds;
-    velocity.w += acceleration.w * elapsed_seconds;
-
-    // update colour
-    colour.r = cuckoo::maths::lerp (end_colour.r, start_colour.r, life_remaining / life_time);
-    colour.g = cuckoo::maths::lerp (end_colour.g, start_colour.g, life_remaining / life_time);
-    colour.b = cuckoo::maths::lerp (end_colour.b, start_colour.b, life_remaining / life_time);
-    colour.a = cuckoo::maths::lerp (end_colour.a, start_colour.a, life_remaining / life_time);
-
-    // update life remaining
-    life_remaining -= elapsed_seconds;
-
-    // is particle still alive?
-    if (life_remaining <= 0.0)
-      return true;
-    else if (position.y < kill_y)
-      return true;
-    else
-      return false;
-  }
+  unsigned           num_reorders = 0u;
+  unsigned long long num_sorted = 0u;   // particles, summed over every reorder
+  double             seconds = 0.0;     // summed over every reorder
 };
 
-class particle_b : public particle
+/// @brief how much work each update is given, see set_work_split
+struct particle_work_split_t
 {
-public:
-  particle_b ()
-  {
-    // middle of screen
-
-    life_time = life_remaining = random_getd (9.0, 10.0);
-    kill_y = -(double)pigeon::gfx::driver::get_screen_size ().y / 2.0 + 50.0;
-
-    position = { random_getd (0.0, (double)pigeon::gfx::driver::get_screen_size ().x / 3.0),
-      (double)pigeon::gfx::driver::get_screen_size ().y / 2.0,
-      0.0, 0.0 };
-    velocity = { -50.0,
-      random_getd (-100.0, -60.0),
-      0.0, 0.0 };
-    acceleration = { 0.0, 0.0, 0.0, 0.0 };
-
-    start_colour = { 0.2, 1.0, 0.2, 1.0 }; // green
-    end_colour = { 1.0, 0.2, 1.0, 1.0 }; // inverse green
-  }
-
-  bool process (double elapsed_seconds) override
-  {
-    // update linear motion
-    position.x += velocity.x * elapsed_seconds;
-    position.y += velocity.y * elapsed_seconds;
-    position.z += velocity.z * elapsed_seconds;
-    position.w += velocity.w * elapsed_seconds;
-
-    velocity.x += acceleration.x * elapsed_seconds;
-    velocity.y += acceleration.y * elapsed_seconds;
-    velocity.z += acceleration.z * elapsed_seconds;
-    velocity.w += acceleration.w * elapsed_seconds;
-
-    // update colour
-    colour.r = cuckoo::maths::lerp (end_colour.r, start_colour.r, life_remaining / life_time);
-    colour.g = cuckoo::maths::lerp (end_colour.g, start_colour.g, life_remaining / life_time);
-    colour.b = cuckoo::maths::lerp (end_colour.b, start_colour.b, life_remaining / life_time);
-    colour.a = cuckoo::maths::lerp (end_colour.a, start_colour.a, life_remaining / life_time);
-
-    // update life remaining
-    life_remaining -= elapsed_seconds;
-
-    // is particle still alive?
-    if (position.y < kill_y)
-      return true;
-    else if (life_remaining <= 0.0)
-      return true;
-    else
-      return false;
-  }
+  unsigned spawn_rate = 0u;
+  unsigned num_threads = 0u;
 };
 
-class particle_c : public particle
+/// @brief the range of the pool a worker is responsible for
+struct particle_chunk_t
 {
-public:
-  particle_c ()
-  {
-    // right hand side of screen
+  unsigned begin = 0u;
+  unsigned end = 0u;
 
-    life_time = life_remaining = random_getd (3.5, 6.0);
-    kill_y = -(double)pigeon::gfx::driver::get_screen_size ().y / 2.0 + 15.0;
+  unsigned num_survivors = 0u; // filled in by process_chunk
+  unsigned output_offset = 0u; // exclusive prefix sum of num_survivors
 
-    position = { (double)pigeon::gfx::driver::get_screen_size ().x / 2.0 - 300.0,
-      -(double)pigeon::gfx::driver::get_screen_size ().y / 2.0 + 400.0,
-      0.0, 0.0 };
-    velocity = { random_getd (-50.0, 50.0),
-      random_getd (-50.0, 50.0),
-      0.0, 0.0 };
-    acceleration = { 0.0, 0.0, 0.0, 0.0 };
-
-    start_colour = { 0.2, 0.2, 1.0, 1.0 }; // blue
-    end_colour = { 1.0, 1.0, 0.2, 1.0 }; // inverse blue
-  }
-
-  bool process (double elapsed_seconds) override
-  {
-    // update linear motion
-    position.x += velocity.x * elapsed_seconds;
-    position.y += velocity.y * elapsed_seconds;
-    position.z += velocity.z * elapsed_seconds;
-    position.w += velocity.w * elapsed_seconds;
-
-    velocity.x += acceleration.x * elapsed_seconds;
-    velocity.y += acceleration.y * elapsed_seconds;
-    velocity.z += acceleration.z * elapsed_seconds;
-    velocity.w += acceleration.w * elapsed_seconds;
-
-    // update colour
-    colour.r = cuckoo::maths::lerp (end_colour.r, start_colour.r, life_remaining / life_time);
-    colour.g = cuckoo::maths::lerp (end_colour.g, start_colour.g, life_remaining / life_time);
-    colour.b = cuckoo::maths::lerp (end_colour.b, start_colour.b, life_remaining / life_time);
-    colour.a = cuckoo::maths::lerp (end_colour.a, start_colour.a, life_remaining / life_time);
-
-    // update life remaining
-    life_remaining -= elapsed_seconds;
-
-    // is particle still alive?
-    if (life_remaining <= 0.0)
-      return true;
-    else if (position.y < kill_y)
-      return true;
-    else
-      return false;
-  }
+  unsigned emit_offset = 0u;   // where this worker's new particles start in the back buffer
+  unsigned emit_count = 0u;    // how many new particles this worker must emit this frame
 };
 
 
 // PARTICLE SYSTEM
 
-/// @brief update all active particles
-/// remove expired particles
-/// @param particles list of particle pointers
+/// @brief COMPACTION PASS 1: update every particle in the chunk and count how many survive
+/// @param particles front buffer of the particle pool
+/// @param types particle type table
+/// @param chunk range to update, num_survivors is written back
+/// @param field if not null, its acceleration is added before each particle is processed
 /// @param elapsed_seconds elapsed frame time
-/// @return updated list of pointers to particles
-static std::list <particle*> process (std::list <particle*> particles, double elapsed_seconds)
+static void process_chunk (particle* particles, particle_type_info_t const* types, particle_chunk_t& chunk,
+  force_field_t const* field, float elapsed_seconds)
 {
-  // iterators provide a generic way to access the data at a particular element of a container
-  // e.g. vectors, lists and maps // https://en.cppreference.com/w/cpp/container
-  // iterators are 'special' in that they can be incremented to go to the next element in the collection
-  // (even if it is not physically next to it in memory // https://en.cppreference.com/w/cpp/iterator)
-  std::list <particle*>::iterator it = particles.begin ();
-  while (it != particles.end ())
+  unsigned num_survivors = 0u;
+  if (field)
   {
-    // get pointer to particle from iterator
-    particle* p = *it;
-    CUCKOO_ASSERT (p);
-
-
-    // update particle, returns true of needs deleting
-    if (p->process (elapsed_seconds))
+    // a block at a time, so the block is still in cache when it is processed after the field is sampled
+    unsigned const block_size = 256u;
+    for (unsigned begin = chunk.begin; begin < chunk.end; begin += block_size)
     {
-      // particle needs deleting
-
-      // release data previously allocated for this particle
-      // no effect if p == nullptr
-      delete p;
-
-      // remove pointer to now released particle from list
-      // std::list::erase () returns next valid element :)
-      it = particles.erase (it);
+      unsigned const end = cuckoo::maths::min (begin + block_size, chunk.end);
+      force_field_apply (*field, particles + begin, end - begin, elapsed_seconds);
+      for (unsigned i = begin; i < end; ++i)
+      {
+        num_survivors += particle_process (particles [i], types, elapsed_seconds) ? 0u : 1u;
+      }
     }
-    else
+  }
+  else
+  {
+    for (unsigned i = chunk.begin; i < chunk.end; ++i)
     {
-      // increment iterator here if this particle was not removed
-      it++;
+      num_survivors += particle_process (particles [i], types, elapsed_seconds) ? 0u : 1u;
     }
   }
-
-  return particles;
+  chunk.num_survivors = num_survivors;
 }
-/// @brief create/add new particles to the list
-/// @param particles list of particle pointers
+
+/// @brief COMPACTION PASS 2: copy the chunk's survivors into the back buffer
+/// starting at chunk.output_offset, preserving their order
+/// @param source front buffer of the particle pool
+/// @param destination back buffer of the particle pool
+/// @param points render staging buffer, if not null each survivor is also packed into it at the same index
+/// @param types particle type table
+/// @param chunk range to scatter
 /// @param elapsed_seconds elapsed frame time
-/// @return updated list of pointers to particles
-static std::list <particle*> emit (std::list <particle*> particles, double elapsed_seconds)
+/// @param lag_seconds how far behind this update to pack the survivors, see particle_pack
+static void scatter_chunk (particle const* source, particle* destination, point_t* points,
+  particle_type_info_t const* types, particle_chunk_t const& chunk, float elapsed_seconds, float lag_seconds)
 {
-  long long num_particles_spawned = 0u;
-  int particle_type = 0;
-  for (float i = 0.f; i < (float)PARTICLE_MAX * 2.f; i += 1.f)
+  particle* out = destination + chunk.output_offset;
+  if (points)
   {
-    // make sure we never exceed maximum particle budget per list(thread)
-    if (particles.size () == PARTICLE_MAX / NUM_THREADS) 
-    {
-      cuckoo::printf ("num particles == PARTICLE_MAX\n");
-      continue;
-    }
-    // make sure we never exceed frame's particle budget
-    if (num_particles_spawned == PARTICLE_SPAWN_RATE / NUM_THREADS)
+    // fused: the survivor is already in cache, so pack it for render here rather than in a second pass over the pool
+    point_t* out_point = points + chunk.output_offset;
+    for (unsigned i = chunk.begin; i < chunk.end; ++i)
     {
-      continue;
-    }
-    // keep track of how many particles have been emitted this frame
-    num_particles_spawned++;
-
-    // add particle
-    // evenly spread particles between each type
-    if (particle_type == 0)
-    {
-      particles.push_back (new particle_a);
-    }
-    else if (particle_type == 1)
-    {
-      particles.push_back (new particle_b);
+      if (!particle_is_dead (source [i], types))
+      {
+        *out++ = source [i];
+        *out_point++ = particle_pack (source [i], types, elapsed_seconds, lag_seconds);
+      }
     }
-    else // particle_type == 2
+  }
+  else
+  {
+    for (unsigned i = chunk.begin; i < chunk.end; ++i)
     {
-      particles.push_back (new particle_c);
+      if (!particle_is_dead (source [i], types))
+      {
+        *out++ = source [i];
+      }
     }
-    // create the next type of particle on the next iteration
-    particle_type++;
-    // 'wrap' particle type so its always valid, 0 <-> { NUM_PARTICLE_TYPES - 1 }
-    particle_type = particle_type % NUM_PARTICLE_TYPES;
   }
+  CUCKOO_ASSERT (out == destination + chunk.output_offset + chunk.num_survivors);
+}
 
-  return particles;
+/// @brief first half of a worker's frame: update its chunk and count the survivors
+void Worker (particle* particles, particle_type_info_t const* types, particle_chunk_t& chunk, force_field_t const* field, float elapsed_seconds)
+{
+  TRACE_ZONE ("process");
+  process_chunk (particles, types, chunk, field, elapsed_seconds);
 }
 
-/// <summary>
-/// For both process and emit, there are 2 threads each. Worker assigns emit and process to these threads. 
-/// </summary>
-/// <param name="particles"></param>
-/// <param name="elapsed_seconds"></param>
-void Worker(std::list <particle*>& particles, double elapsed_seconds )
+/// @brief second half of a worker's frame: compact its survivors, then emit its share of new particles
+void WorkerScatter (particle const* source, particle* destination, point_t* points,
+  particle_type_info_t const* types, particle_chunk_t const& chunk, float elapsed_seconds, float lag_seconds, random_t& random)
 {
-    particles = process(particles, elapsed_seconds);
-    particles = emit(particles, elapsed_seconds); 
+  {
+    TRACE_ZONE ("compact");
+    scatter_chunk (source, destination, points, types, chunk, elapsed_seconds, lag_seconds);
+  }
+  TRACE_ZONE ("emit");
+  emit (random, destination, points, types, chunk.emit_offset, chunk.emit_count);
 }
 
 class particle_system_t
 {
 public:
-  bool initialise (void)
+  /// @param config capacity, spawn rate, workers & page mode, see particle_config_from_environment
+  bool initialise (particle_config_t const& config_ = {})
   {
+    config = config_;
+    particle_config_validate (config);
+    capacity = config;
+    pending_split = { config.spawn_rate, config.num_threads };
+
+    // one random number stream per worker, all derived from the same seed
+    for (unsigned i = 0u; i < config.num_threads; ++i)
+    {
+      random_seed (random_streams [i], PARTICLE_SEED, i);
+    }
+
+    // the workers are started once, each update only hands them work
+    workers.initialise (config.num_threads, TRACE_LANE_WORKER, "worker");
+
+    if (PARTICLE_PIPELINED)
+    {
+      update_worker.initialise (1u, TRACE_LANE_UPDATE, "update");
+      for (particle_snapshot_t& snapshot : snapshots)
+      {
+        snapshot.points.allocate (config.max_particles, config.page_mode);
+        snapshot.count = 0u;
+      }
+      render_index = 0u;
+    }
+
+    if (PARTICLE_MODE == PARTICLE_MODE_ANALYTIC)
+    {
+      analytic.initialise (config, PARTICLE_SEED, workers);
+    }
+    else if (PARTICLE_MODE == PARTICLE_MODE_RING)
+    {
+      ring.initialise (config, workers);
+    }
+    else
+    {
+      initialise_pool ();
+    }
+
     pigeon::gfx::descriptor_point_renderer const desc =
     {
-      .max_points = PARTICLE_MAX,
+      .max_points = config.max_particles,
     };
     return point_renderer.initialise (desc);
   }
 
   /// <summary>
-  /// std::vector<std::threads> threads, creates the array of to the size of NUM_THREADS (4).
-  /// Then the threads are filled via the worker function using a reference to particles.
-  /// Afterwards the threads are joined into the main thread and then there is a limiter for the max amount of particles spawned per thread. 
+  /// Updates the particles with whichever PARTICLE_MODE is selected, by as many fixed ticks as the time step ran this frame.
+  /// With PARTICLE_PIPELINED, this waits for the update started last frame, hands its snapshot to render
+  /// and starts the next update in the background, so num_active_particles is the count of the frame about to be rendered.
   /// </summary>
-  /// <param name="elapsed_seconds"></param>
-  /// <param name="num_active_particles"></param>
-  void update (double elapsed_seconds, long long& num_active_particles)
+  /// <param name="frame">this frame's screen dependent data, see frame_context_capture</param>
+  /// <param name="timestep">advanced for this frame, see common/fixed_timestep.h</param>
+  /// <param name="num_active_particles">unchanged on a frame with no ticks</param>
+  void update (frame_context_t const& frame, fixed_timestep_t const& timestep, long long& num_active_particles)
   {
-      std::vector <std::thread> threads;
-      for (unsigned i = 0u; i < NUM_THREADS; ++i)
-      {
-          threads.emplace_back(Worker, std::ref(particles[i]), elapsed_seconds);
-      }
-      for (std::thread& t : threads)
-      {
-          t.join();
-      }
+    double const tick_seconds = timestep.get_tick_seconds ();
+    unsigned const num_ticks = timestep.get_num_ticks ();
+    float const lag_seconds = (float)timestep.get_render_lag_seconds ();
 
-      num_active_particles = 0;
-      for (unsigned i = 0u; i < NUM_THREADS; ++i)
-      {
-          num_active_particles += (20 * particles[i].size()) / 20;
-      }
+    if (PARTICLE_PIPELINED)
+    {
+      // 1. the snapshot written by last frame's update becomes the one to render
+      // (the update must finish before the type table below is overwritten)
+      wait_for_update ();
+      render_index ^= 1u;
+      num_active_particles = snapshots [render_index].count;
+      finished_simulate_seconds = simulate_seconds;
+    }
+
+    // no update is running now, so the next one can be given a different work split
+    apply_work_split ();
+
+    // keep this frame's type table for render
+    for (unsigned i = 0u; i < NUM_PARTICLE_TYPES; ++i)
+    {
+      types [i] = frame.particle_types [i];
+    }
+    screen_width = frame.screen_width;
+    screen_height = frame.screen_height;
 
+    // the affectors are laid out over the screen, so the field only changes with it
+    if (config.affectors != 0u && (screen_width != field_width || screen_height != field_height))
+    {
+      force_field_build (field, config.affectors, screen_width, screen_height);
+      field_width = screen_width;
+      field_height = screen_height;
+    }
 
+    if (PARTICLE_PIPELINED)
+    {
+      // 2. simulate the next frame into the other snapshot while this frame is rendered
+      update_worker.start (1u, [this, tick_seconds, num_ticks, lag_seconds] (unsigned)
+      {
+        long long num_simulated = 0;
+        {
+          TRACE_ZONE ("simulate");
+          simulate (tick_seconds, num_ticks, lag_seconds, num_simulated);
+        }
+        TRACE_ZONE ("pack snapshot");
+        pack_snapshot (snapshots [render_index ^ 1u]);
+      });
+    }
+    else
+    {
+      simulate (tick_seconds, num_ticks, lag_seconds, num_active_particles);
+      finished_simulate_seconds = simulate_seconds;
+    }
   }
+
   void render (void)
   {
 ////////////////////////////////////////////////
@@ -418,15 +351,50 @@ public:
 ////////////////////////////////////////////////
 
 
-    cuckoo::printf ("rendering particles\n");
-    for (unsigned i = 0u; i < NUM_THREADS; ++i)
+    TRACE_ZONE ("submit points");
+    TELEMETRY_LOG (1000u, "rendering particles\n");
+    if (PARTICLE_PIPELINED)
     {
-        for (particle const* p : particles[i])
-        {
-          point_renderer.draw ((float)p->position.x, (float)p->position.y,
-            vec4 ((float)p->colour.r, (float)p->colour.g, (float)p->colour.b, (float)p->colour.a));
-        }
-
+      // last frame's update packed this snapshot, the next frame is being simulated into the other one meanwhile
+      particle_snapshot_t const& snapshot = snapshots [render_index];
+      point_t const* points = snapshot.points.data ();
+      for (unsigned i = 0u; i < snapshot.count; ++i)
+      {
+        point_renderer.draw (points [i].x, points [i].y, points [i].colour);
+      }
+    }
+    else if (PARTICLE_MODE == PARTICLE_MODE_ANALYTIC)
+    {
+      analytic.for_each_point ([this] (point_t const& point)
+      {
+        point_renderer.draw (point.x, point.y, point.colour);
+      });
+    }
+    else if (PARTICLE_MODE == PARTICLE_MODE_RING)
+    {
+      ring.for_each_point ([this] (point_t const& point)
+      {
+        point_renderer.draw (point.x, point.y, point.colour);
+      });
+    }
+    else if (PARTICLE_FUSED_PACK)
+    {
+      // the update already packed every live particle, just submit them
+      point_t const* points = pool.points.data ();
+      for (unsigned i = 0u; i < pool.count; ++i)
+      {
+        point_renderer.draw (points [i].x, points [i].y, points [i].colour);
+      }
+    }
+    else
+    {
+      particle const* particles = pool.front ();
+      unsigned const num_processed = pool.count - pool.num_emitted;
+      for (unsigned i = 0u; i < pool.count; ++i)
+      {
+        point_t const point = i < num_processed ? particle_pack (particles [i], types, pool.elapsed_seconds, pool.lag_seconds) : particle_pack_new (particles [i]);
+        point_renderer.draw (point.x, point.y, point.colour);
+      }
     }
 
 
@@ -461,30 +429,417 @@ public:
 
 
 
-    // delete all particles
-    for (unsigned i = 0u; i < NUM_THREADS; ++i)
+    // release the particles
+    wait_for_update ();
+    for (particle_snapshot_t& snapshot : snapshots)
     {
-        std::list <particle*>::iterator it = particles[i].begin(); 
-        while (it != particles[i].end()) 
-        {
-          // get pointer to particle from iterator
-          particle* p = *it;
+      snapshot.points.release ();
+      snapshot.count = 0u;
+    }
+    analytic.release ();
+    ring.release ();
+    pool.count = 0u;
+    pool.buffers [0].release ();
+    pool.buffers [1].release ();
+    pool.points.release ();
+    sorter.release ();
+    update_worker.release ();
+    workers.release ();
+  }
+
+  /// @brief ask for a different spawn rate & number of workers from the next update on (see frame_governor.h)
+  /// both are clamped to [1, what the system was initialised with]
+  void set_work_split (unsigned spawn_rate, unsigned num_threads)
+  {
+    pending_split.spawn_rate = cuckoo::maths::min (cuckoo::maths::max (spawn_rate, 1u), capacity.spawn_rate);
+    pending_split.num_threads = cuckoo::maths::min (cuckoo::maths::max (num_threads, 1u), capacity.num_threads);
+  }
 
-          // release data previously allocated for this particle
-          // no effect if p == nullptr
-          delete p;
+  /// @brief the config the system was initialised with, after validation
+  /// spawn_rate & num_threads are those of the current work split, see set_work_split
+  particle_config_t const& get_config (void) const { return config; }
 
-          // remove pointer to now released particle from list
-          // std::list::erase () returns next valid element :)
-          it = particles[i].erase(it); 
-        }
+  /// @brief how long the last finished update spent simulating, in seconds
+  /// with PARTICLE_PIPELINED that is the update this frame renders, timed on the update thread,
+  /// as update itself then costs only the wait for it (see frame_governor.h)
+  double get_simulate_seconds (void) const { return finished_simulate_seconds; }
+
+  /// @brief PARTICLE_MODE_POOL: what the Morton reorders have cost so far
+  particle_reorder_stats_t const& get_reorder_stats (void) const { return reorder_stats; }
+
+  /// @brief PARTICLE_MODE_POOL: write the live particles, the staging points, the type table & the random streams to a checkpoint
+  /// The arrays are written straight from the pool, see common/world_checkpoint.h.
+  /// With PARTICLE_PIPELINED this waits for the running update, and saves the world it leaves.
+  /// @return false if the file could not be written, or PARTICLE_MODE is not PARTICLE_MODE_POOL
+  bool save_checkpoint (char const* path)
+  {
+    if (PARTICLE_MODE != PARTICLE_MODE_POOL)
+    {
+      return false;
     }
+    wait_for_update ();
+
+    particle_checkpoint_state_t const state =
+      { pool.count, pool.num_emitted, pool.elapsed_seconds, pool.lag_seconds, frames_since_reorder, PARTICLE_FUSED_PACK ? 1u : 0u };
+    world_checkpoint_writer_t writer;
+    writer.add (PARTICLE_CHECKPOINT_STATE, &state, 1u);
+    writer.add (PARTICLE_CHECKPOINT_PARTICLES, pool.front (), pool.count);
+    if (PARTICLE_FUSED_PACK)
+    {
+      // PARTICLE_PIPELINED has already traded the staging buffer for the snapshot the next update renders
+      point_t const* points = PARTICLE_PIPELINED ? snapshots [render_index ^ 1u].points.data () : pool.points.data ();
+      writer.add (PARTICLE_CHECKPOINT_POINTS, points, pool.count);
+    }
+    writer.add (PARTICLE_CHECKPOINT_RANDOM, random_streams, MAX_THREADS);
+    writer.add (PARTICLE_CHECKPOINT_TYPES, types, NUM_PARTICLE_TYPES);
+    return writer.write (path, PARTICLE_CHECKPOINT_APP, PARTICLE_CHECKPOINT_LAYOUT);
+  }
 
+  /// @brief PARTICLE_MODE_POOL: carry on from a checkpoint written by save_checkpoint, in place of the current particles
+  /// The particles are mapped from the file as the pool's front buffer rather than read in, so millions load in about
+  /// the time of one mmap call & are paged in as the first update walks them.
+  /// With PARTICLE_PIPELINED the loaded particles are packed as the snapshot the next update hands to render,
+  /// so a run carries on from a checkpoint exactly as the run that saved it did.
+  /// @return false if the checkpoint could not be loaded: the particles are left as they were if it was rejected,
+  /// or the pool starts again empty if memory ran out part way through
+  bool load_checkpoint (char const* path)
+  {
+    if (PARTICLE_MODE != PARTICLE_MODE_POOL)
+    {
+      return false;
+    }
+    wait_for_update ();
+
+    world_checkpoint_t checkpoint;
+    particle_checkpoint_state_t state;
+    if (!checkpoint.open (path, PARTICLE_CHECKPOINT_APP, PARTICLE_CHECKPOINT_LAYOUT)
+      || !checkpoint.copy (PARTICLE_CHECKPOINT_STATE, &state, 1u)
+      || state.count > config.max_particles || state.num_emitted > state.count
+      || state.is_points_packed != (PARTICLE_FUSED_PACK ? 1u : 0u))
+    {
+      return false;
+    }
+    size_t num_particles = 0u;
+    size_t num_points = 0u;
+    size_t num_streams = 0u;
+    if (!checkpoint.find <particle> (PARTICLE_CHECKPOINT_PARTICLES, num_particles) || num_particles != state.count
+      || (PARTICLE_FUSED_PACK && (!checkpoint.find <point_t> (PARTICLE_CHECKPOINT_POINTS, num_points) || num_points != state.count))
+      || !checkpoint.find <random_t> (PARTICLE_CHECKPOINT_RANDOM, num_streams) || num_streams != MAX_THREADS
+      || !checkpoint.copy (PARTICLE_CHECKPOINT_TYPES, types, NUM_PARTICLE_TYPES))
+    {
+      return false;
+    }
+
+    // everything is checked, from here on nothing can fail short of running out of memory
+    TRACE_ZONE ("load checkpoint");
+    bool const is_loaded = checkpoint.map_or_copy (PARTICLE_CHECKPOINT_PARTICLES, pool.buffers [pool.front_index], config.max_particles, config.page_mode)
+      && (!PARTICLE_FUSED_PACK || checkpoint.map_or_copy (PARTICLE_CHECKPOINT_POINTS, pool.points, config.max_particles, config.page_mode));
+    if (!is_loaded)
+    {
+      initialise_pool ();
+      return false;
+    }
+    checkpoint.copy (PARTICLE_CHECKPOINT_RANDOM, random_streams, MAX_THREADS);
+    pool.count = state.count;
+    pool.num_emitted = state.num_emitted;
+    pool.elapsed_seconds = state.elapsed_seconds;
+    pool.lag_seconds = state.lag_seconds;
+    frames_since_reorder = state.frames_since_reorder;
+    if (PARTICLE_PIPELINED)
+    {
+      pack_snapshot (snapshots [render_index ^ 1u]);
+    }
+    return true;
   }
 
 
 private:
+  /// @brief run a frame's ticks of whichever PARTICLE_MODE is selected
+  /// Only the last tick packs its points behind by lag_seconds, the ticks before it are drawn by nobody.
+  /// PARTICLE_MODE_ANALYTIC always draws its latest tick, as does PARTICLE_MODE_RING on a frame with no ticks.
+  void simulate (double tick_seconds, unsigned num_ticks, float lag_seconds, long long& num_active_particles)
+  {
+    std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now ();
+    if (num_ticks == 0u)
+    {
+      // nothing to simulate, only how far behind the latest tick it is drawn has moved on
+      repack_pool (lag_seconds);
+    }
+
+    for (unsigned tick = 0u; tick < num_ticks; ++tick)
+    {
+      TRACE_ZONE ("tick");
+      float const tick_lag_seconds = tick + 1u == num_ticks ? lag_seconds : 0.f;
+
+      if (PARTICLE_MODE == PARTICLE_MODE_ANALYTIC)
+      {
+        num_active_particles = analytic.update (tick_seconds, types);
+      }
+      else if (PARTICLE_MODE == PARTICLE_MODE_RING)
+      {
+        num_active_particles = ring.update (tick_seconds, types, random_streams, active_field (), tick_lag_seconds);
+      }
+      else
+      {
+        update_pool (tick_seconds, tick_lag_seconds, num_active_particles);
+      }
+    }
+
+    // on whichever thread ran the update, handed on by update once it has finished
+    simulate_seconds = std::chrono::duration <double> (std::chrono::steady_clock::now () - start).count ();
+  }
+
+  /// @brief PARTICLE_MODE_POOL: draw the pool as it is further behind its last update, on a frame with no ticks
+  /// with PARTICLE_FUSED_PACK the staging buffer is packed again, as PARTICLE_PIPELINED may have traded it for an old snapshot
+  void repack_pool (float lag_seconds)
+  {
+    pool.lag_seconds = lag_seconds;
+    if (PARTICLE_MODE != PARTICLE_MODE_POOL || !PARTICLE_FUSED_PACK)
+    {
+      return;
+    }
+    TRACE_ZONE ("repack");
+    particle const* particles = pool.front ();
+    point_t* points = pool.points.data ();
+    unsigned const num_processed = pool.count - pool.num_emitted;
+    for (unsigned i = 0u; i < pool.count; ++i)
+    {
+      points [i] = i < num_processed ? particle_pack (particles [i], types, pool.elapsed_seconds, lag_seconds) : particle_pack_new (particles [i]);
+    }
+  }
+
+  /// @brief PARTICLE_PIPELINED: copy the last update's points into a snapshot, runs on the update thread
+  void pack_snapshot (particle_snapshot_t& snapshot)
+  {
+    unsigned count = 0u;
+    point_t* out = snapshot.points.data ();
+    if (PARTICLE_MODE == PARTICLE_MODE_ANALYTIC)
+    {
+      analytic.for_each_point ([&] (point_t const& point) { out [count++] = point; });
+    }
+    else if (PARTICLE_MODE == PARTICLE_MODE_RING)
+    {
+      ring.for_each_point ([&] (point_t const& point) { out [count++] = point; });
+    }
+    else if (PARTICLE_FUSED_PACK)
+    {
+      // the pool's staging buffer is already dense & packed, so trade buffers rather than copying.
+      // the pool gets back the snapshot rendered the frame before last, which nothing reads any more
+      pool.points.swap (snapshot.points);
+      count = pool.count;
+    }
+    else
+    {
+      particle const* particles = pool.front ();
+      unsigned const num_processed = pool.count - pool.num_emitted;
+      for (unsigned i = 0u; i < pool.count; ++i)
+      {
+        out [count++] = i < num_processed ? particle_pack (particles [i], types, pool.elapsed_seconds, pool.lag_seconds) : particle_pack_new (particles [i]);
+      }
+    }
+    CUCKOO_ASSERT (count <= config.max_particles);
+    snapshot.count = count;
+  }
+
+  /// @brief hand the work split asked for by set_work_split to whichever PARTICLE_MODE is selected, between updates only
+  void apply_work_split (void)
+  {
+    if (pending_split.spawn_rate == config.spawn_rate && pending_split.num_threads == config.num_threads)
+    {
+      return;
+    }
+    config.spawn_rate = pending_split.spawn_rate;
+    config.num_threads = pending_split.num_threads;
+    analytic.set_work_split (config.spawn_rate, config.num_threads);
+    ring.set_work_split (config.spawn_rate, config.num_threads);
+  }
+
+  /// @brief the force field to apply, null if no affectors are configured
+  force_field_t const* active_field (void) const { return config.affectors != 0u ? &field : nullptr; }
+
+  /// @brief PARTICLE_PIPELINED: block until the update started last frame has finished
+  void wait_for_update (void)
+  {
+    TRACE_ZONE ("wait for update");
+    update_worker.wait ();
+  }
+
+  /// @brief PARTICLE_MODE_POOL: allocate the pool
+  void initialise_pool (void)
+  {
+    // all particle memory is allocated up front, the game loop never touches the allocator
+    pool.buffers [0].allocate (config.max_particles, config.page_mode);
+    pool.buffers [1].allocate (config.max_particles, config.page_mode);
+    if (PARTICLE_FUSED_PACK)
+    {
+      pool.points.allocate (config.max_particles, config.page_mode);
+    }
+    pool.front_index = 0u;
+    pool.count = 0u;
+
+    if (config.reorder_interval > 0u)
+    {
+      sorter.initialise (config, workers);
+    }
+    frames_since_reorder = 0u;
+    reorder_stats = {};
+
+    report_working_set ();
+  }
+
+  /// <summary>
+  /// Updates the particles as a parallel stream compaction:
+  /// 1. each worker updates its chunk of the pool and counts the survivors
+  /// 2. an exclusive prefix sum of the survivor counts gives each chunk's output offset
+  /// 3. each worker scatters its survivors into the back buffer at that offset, then emits new particles after all survivors
+  ///    (with PARTICLE_FUSED_PACK, each worker also writes its particles into the render staging buffer at the same indices)
+  /// The live particles then sit densely in [0, num_active_particles) for the next frame and for render.
+  /// </summary>
+  /// <param name="elapsed_seconds"></param>
+  /// <param name="lag_seconds">how far behind this update to draw the particles, see particle_pack</param>
+  /// <param name="num_active_particles"></param>
+  void update_pool (double elapsed_seconds, float lag_seconds, long long& num_active_particles)
+  {
+    float const step = (float)elapsed_seconds;
+    unsigned const num_threads = config.num_threads;
+    particle_chunk_t chunks [MAX_THREADS];
+
+    // 0. MORTON ORDER, now & again
+    // the compaction below keeps the particles' order, so the sorted order carries through to the staging buffer & render
+    if (config.reorder_interval > 0u && ++frames_since_reorder >= config.reorder_interval)
+    {
+      frames_since_reorder = 0u;
+      reorder_pool ();
+    }
+
+    // split the live particles evenly between the workers
+    unsigned const chunk_size = (pool.count + num_threads - 1u) / num_threads;
+    for (unsigned i = 0u; i < num_threads; ++i)
+    {
+      chunks [i].begin = cuckoo::maths::min (i * chunk_size, pool.count);
+      chunks [i].end = cuckoo::maths::min (chunks [i].begin + chunk_size, pool.count);
+    }
+
+    // 1. PROCESS & COUNT
+    {
+      particle* particles = pool.front ();
+      force_field_t const* affectors = active_field ();
+      workers.run (num_threads, [&] (unsigned i)
+      {
+        Worker (particles, types, chunks [i], affectors, step);
+      });
+    }
+
+    // 2. EXCLUSIVE PREFIX SUM
+    unsigned num_survivors = 0u;
+    for (unsigned i = 0u; i < num_threads; ++i)
+    {
+      chunks [i].output_offset = num_survivors;
+      num_survivors += chunks [i].num_survivors;
+    }
+
+    // the frame's spawn budget, new particles are appended after the survivors
+    unsigned const num_to_spawn = cuckoo::maths::min (config.spawn_rate, config.max_particles - num_survivors);
+    unsigned emit_offset = num_survivors;
+    for (unsigned i = 0u; i < num_threads; ++i)
+    {
+      chunks [i].emit_offset = emit_offset;
+      chunks [i].emit_count = num_to_spawn / num_threads + (i < num_to_spawn % num_threads ? 1u : 0u);
+      emit_offset += chunks [i].emit_count;
+    }
+
+    // 3. SCATTER & EMIT
+    {
+      point_t* points = PARTICLE_FUSED_PACK ? pool.points.data () : nullptr;
+      particle const* source = pool.front ();
+      particle* destination = pool.back ();
+      workers.run (num_threads, [&] (unsigned i)
+      {
+        WorkerScatter (source, destination, points, types, chunks [i], step, lag_seconds, random_streams [i]);
+      });
+    }
+
+    pool.swap ();
+    pool.count = emit_offset;
+    pool.num_emitted = num_to_spawn;
+    pool.elapsed_seconds = step;
+    pool.lag_seconds = lag_seconds;
+
+    num_active_particles = pool.count;
+  }
+
+  /// @brief PARTICLE_MODE_POOL: sort the live particles into Morton order of screen position, see morton_order.h
+  void reorder_pool (void)
+  {
+    TRACE_ZONE ("reorder");
+    std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now ();
+    sorter.sort (pool.front (), pool.back (), pool.count, screen_width, screen_height);
+    pool.swap ();
+    double const seconds = std::chrono::duration <double> (std::chrono::steady_clock::now () - start).count ();
+
+    ++reorder_stats.num_reorders;
+    reorder_stats.num_sorted += pool.count;
+    reorder_stats.seconds += seconds;
+    TELEMETRY_LOG (0u, "reordered %u particles in %.3f ms\n", pool.count, seconds * 1e3);
+  }
+
+  /// @brief print how much memory the particles need with all max_particles particles alive,
+  /// compared with the original layout (a heap allocated, polymorphic particle of doubles held in a std::list)
+  void report_working_set (void) const
+  {
+    // vtable pointer + life_time, life_remaining, kill_y + position, velocity, acceleration (4 doubles each)
+    // + colour, start_colour, end_colour (4 doubles each)
+    size_t const original_particle_bytes = sizeof (void*) + 3u * sizeof (double) + 6u * 4u * sizeof (double);
+    // std::list node: next, prev & the particle pointer
+    size_t const original_node_bytes = 3u * sizeof (void*);
+    size_t const original_bytes = (original_particle_bytes + original_node_bytes) * config.max_particles;
+
+    // only one buffer and the staging points are touched per particle, per frame
+    size_t const particle_bytes = sizeof (particle);
+    size_t const point_bytes = PARTICLE_FUSED_PACK ? sizeof (point_t) : 0u;
+    size_t const current_bytes = (2u * particle_bytes + point_bytes) * config.max_particles + sizeof (types);
+
+    cuckoo::printf ("particle working set @ %u particles, %u threads:\n", config.max_particles, config.num_threads);
+    cuckoo::printf ("  original: %zu bytes/particle (+%zu list node), %.2f MB\n",
+      original_particle_bytes, original_node_bytes, (double)original_bytes / (1024.0 * 1024.0));
+    cuckoo::printf ("  current : %zu bytes/particle x2 buffers (+%zu staged point), %.2f MB\n",
+      particle_bytes, point_bytes, (double)current_bytes / (1024.0 * 1024.0));
+    cuckoo::printf ("  pages   : %s asked for, %s obtained\n",
+      page_mode_name (config.page_mode), page_mode_name (pool.buffers [0].get_page_mode ()));
+  }
+
   pigeon::gfx::point_renderer point_renderer;
-  std::list <particle*> particles[NUM_THREADS];
+  particle_pool_t pool;
+  analytic_particles_t analytic;
+  ring_particles_t ring;
+  particle_type_info_t types [NUM_PARTICLE_TYPES];
+  random_t random_streams [MAX_THREADS];
+  particle_config_t config;
+  particle_config_t capacity;           // as initialised, the most set_work_split can ask for
+  particle_work_split_t pending_split;  // applied by the next update
+
+  // PARTICLE_MODE_POOL, Morton reorder
+  morton_sorter_t sorter;
+  unsigned frames_since_reorder = 0u;
+  particle_reorder_stats_t reorder_stats;
+  unsigned screen_width = 0u;           // of the last update's frame, the sort keys cover the screen
+  unsigned screen_height = 0u;
+
+  // started once by initialise, see common/worker_pool.h
+  worker_pool_t workers;
+
+  // affectors, see force_field.h
+  force_field_t field;
+  unsigned field_width = 0u;            // the screen size the field was built for
+  unsigned field_height = 0u;
+
+  // what the simulation costs, see get_simulate_seconds
+  double simulate_seconds = 0.0;          // written by simulate, on whichever thread runs the update
+  double finished_simulate_seconds = 0.0; // of the last update to finish
+
+  // PARTICLE_PIPELINED
+  worker_pool_t update_worker;       // runs the update for the next frame, started by update & waited for by the following update
+  particle_snapshot_t snapshots [2]; // render reads snapshots [render_index], the update thread writes the other
+  unsigned render_index = 0u;
 
 };
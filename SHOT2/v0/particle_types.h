@@ -0,0 +1,119 @@
+// Data shared by every way of simulating the particles:
+// the per-type constants (how each type moves, dies, is coloured and is emitted)
+// and the render-ready point layout.
+
+
+#pragma once
+
+#include "cuckoo/core/asserts.h"       // for CUCKOO_ASSERT
+#include "cuckoo/maths/maths.h"        // for cuckoo::maths::lerp, vec4, ...
+
+#include "constants.h"                 // for NUM_PARTICLE_TYPES
+
+
+// UTILITY
+
+struct colourf
+{
+  float r;
+  float g;
+  float b;
+  float a;
+};
+
+
+// PARTICLE TYPES
+
+// identifies which emitter a particle came from, index into the particle type table
+using particle_type_t = unsigned char;
+particle_type_t const PARTICLE_TYPE_A = 0u;
+particle_type_t const PARTICLE_TYPE_B = 1u;
+particle_type_t const PARTICLE_TYPE_C = 2u;
+
+/// @brief everything that is fixed for a type of particle
+/// stored once per type, rather than duplicated in every particle
+struct particle_type_info_t
+{
+  float   acceleration_x;
+  float   acceleration_y;
+  float   kill_y;
+
+  colourf start_colour;
+  colourf end_colour;
+
+  // emitter: each value is picked uniformly from [min, max] when a particle is spawned
+  float   life_time_min,  life_time_max;
+  float   position_x_min, position_x_max;
+  float   position_y_min, position_y_max;
+  float   velocity_x_min, velocity_x_max;
+  float   velocity_y_min, velocity_y_max;
+};
+
+// type A's velocity bounds, the trig is only ever worked out once
+static float const PARTICLE_A_VELOCITY_X_MIN = cuckoo::maths::cos (cuckoo::maths::radians (89.f)) * 200.f;
+static float const PARTICLE_A_VELOCITY_X_MAX = cuckoo::maths::cos (cuckoo::maths::radians (75.f)) * 200.f;
+static float const PARTICLE_A_VELOCITY_Y_MIN = cuckoo::maths::sin (cuckoo::maths::radians (75.f)) * 200.f;
+static float const PARTICLE_A_VELOCITY_Y_MAX = cuckoo::maths::sin (cuckoo::maths::radians (89.f)) * 200.f;
+
+/// @brief fill in the per-type table
+/// the kill heights and emitter origins depend on the screen size, see frame_context_capture
+static void initialise_particle_types (particle_type_info_t types [NUM_PARTICLE_TYPES], float screen_half_width, float screen_half_height)
+{
+
+  // left hand side of screen
+  types [PARTICLE_TYPE_A] =
+  {
+    .acceleration_x = 2.f,
+    .acceleration_y = -26.5f,
+    .kill_y         = -screen_half_height,
+    .start_colour   = { 1.f, .2f, .2f, 1.f }, // red
+    .end_colour     = { .2f, 1.f, 1.f, 1.f }, // inverse red
+    .life_time_min  = 7.5f, .life_time_max = 13.f,
+    .position_x_min = -screen_half_width, .position_x_max = -screen_half_width + 200.f,
+    .position_y_min = -screen_half_height, .position_y_max = -screen_half_height + 100.f,
+    .velocity_x_min = PARTICLE_A_VELOCITY_X_MIN, .velocity_x_max = PARTICLE_A_VELOCITY_X_MAX,
+    .velocity_y_min = PARTICLE_A_VELOCITY_Y_MIN, .velocity_y_max = PARTICLE_A_VELOCITY_Y_MAX,
+  };
+
+  // middle of screen
+  types [PARTICLE_TYPE_B] =
+  {
+    .acceleration_x = 0.f,
+    .acceleration_y = 0.f,
+    .kill_y         = -screen_half_height + 50.f,
+    .start_colour   = { .2f, 1.f, .2f, 1.f }, // green
+    .end_colour     = { 1.f, .2f, 1.f, 1.f }, // inverse green
+    .life_time_min  = 9.f, .life_time_max = 10.f,
+    .position_x_min = 0.f, .position_x_max = screen_half_width * 2.f / 3.f,
+    .position_y_min = screen_half_height, .position_y_max = screen_half_height,
+    .velocity_x_min = -50.f, .velocity_x_max = -50.f,
+    .velocity_y_min = -100.f, .velocity_y_max = -60.f,
+  };
+
+  // right hand side of screen
+  types [PARTICLE_TYPE_C] =
+  {
+    .acceleration_x = 0.f,
+    .acceleration_y = 0.f,
+    .kill_y         = -screen_half_height + 15.f,
+    .start_colour   = { .2f, .2f, 1.f, 1.f }, // blue
+    .end_colour     = { 1.f, 1.f, .2f, 1.f }, // inverse blue
+    .life_time_min  = 3.5f, .life_time_max = 6.f,
+    .position_x_min = screen_half_width - 300.f, .position_x_max = screen_half_width - 300.f,
+    .position_y_min = -screen_half_height + 400.f, .position_y_max = -screen_half_height + 400.f,
+    .velocity_x_min = -50.f, .velocity_x_max = 50.f,
+    .velocity_y_min = -50.f, .velocity_y_max = 50.f,
+  };
+}
+
+
+
+// RENDER POINTS
+
+/// @brief a single point, laid out exactly as point_renderer.draw consumes it
+struct point_t
+{
+  float x;
+  float y;
+  vec4  colour;
+};
@@ -0,0 +1,363 @@
+// RING PARTICLES:
+//
+// Particles are emitted in order and their lifetimes come from a few fixed ranges,
+// so particles spawned at around the same time also expire at around the same time.
+// Rather than compacting the whole population every frame, particles are kept in
+// fixed size spawn blocks, used in order, as a ring:
+//
+//   tail                                               head
+//   | block | block | block | ... | block | block | block |  <- new particles fill the head block
+//   oldest                                             newest
+//
+// - a block younger than its types' earliest possible death cannot contain a dead particle,
+//   so its particles are integrated without any kill test
+// - a block in its expiry window has every particle kill tested, dead particles are left where they are
+//   (flagged, not compacted) and the block's alive count is reduced
+// - once a block has no particles alive, or its newest particle is older than any particle can live,
+//   the whole block is retired at once by moving the tail on
+// Force fields (force_field.h) can push particles down faster than their type allows for,
+// so with a field every block is kill tested.
+// Block ages are counted in whole fixed ticks, not read off a float clock: a float clock drifts & rounds ever more coarsely
+// as it grows, which would let the young block fast path & retirement misjudge a block's age the longer the game runs.
+
+
+#pragma once
+
+#include "cuckoo/core/asserts.h"       // for CUCKOO_ASSERT
+#include "cuckoo/maths/maths.h"        // for cuckoo::maths::min, cuckoo::maths::max, cuckoo::maths::sqrt
+
+#include "constants.h"                 // for NUM_PARTICLE_TYPES
+#include "particle_config.h"           // for particle_config_t, MAX_THREADS
+#include "particle_types.h"            // for particle_type_info_t, point_t
+#include "particle.h"                  // for particle, particle_process, emit
+#include "force_field.h"               // for force_field_t, force_field_apply
+
+#include "../../common/page_buffer.h"  // for page_buffer_t
+#include "../../common/trace.h"        // for TRACE_ZONE
+#include "../../common/worker_pool.h"  // for worker_pool_t
+
+#include <vector>                      // for std::vector
+
+
+/// @brief the earliest time, after being spawned, that a particle of this type could possibly be killed
+/// by either its lifetime or by falling below kill_y.
+/// The fall is solved for the fastest possible descent (lowest start position & most downward velocity).
+/// The particles are integrated with explicit Euler, which with acceleration_y <= 0 never falls sooner
+/// than the closed form, for any other acceleration the block is always kill tested.
+static float ring_earliest_death (particle_type_info_t const& type)
+{
+  float const never = 1e30f;
+
+  float const height = type.position_y_min - type.kill_y;
+  float const velocity = type.velocity_y_min;
+  float const acceleration = type.acceleration_y;
+
+  float time_to_kill_y = never;
+  if (height <= 0.f || acceleration > 0.f)
+  {
+    time_to_kill_y = 0.f;
+  }
+  else if (acceleration == 0.f)
+  {
+    time_to_kill_y = velocity < 0.f ? height / -velocity : never;
+  }
+  else
+  {
+    // first positive root of 0.5*a*t^2 + v*t + height = 0
+    time_to_kill_y = (velocity + cuckoo::maths::sqrt (velocity * velocity - 2.f * acceleration * height)) / -acceleration;
+  }
+
+  return cuckoo::maths::min (type.life_time_min, time_to_kill_y);
+}
+
+
+/// @brief a run of consecutive particles, all spawned between first_spawn_tick & last_spawn_tick
+struct ring_block_t
+{
+  unsigned count = 0u;            // slots used, [0, count) of the block
+  unsigned num_alive = 0u;
+
+  unsigned long long first_spawn_tick = 0u;
+  unsigned long long last_spawn_tick = 0u;
+
+  unsigned num_points = 0u;       // live points packed at the start of the block's staging range by the last update
+  unsigned emitted_begin = 0u;    // slots [emitted_begin, count) were emitted by the last update
+};
+
+/// @brief see 'RING PARTICLES' above
+class ring_particles_t
+{
+public:
+  /// @param config capacity, spawn rate, workers & page mode
+  /// @param workers_ the owner's workers, started with at least config_.num_threads
+  void initialise (particle_config_t const& config_, worker_pool_t& workers_)
+  {
+    config = config_;
+    workers = &workers_;
+    // spawn blocks are filled up to one frame's worth of particles
+    block_capacity = config.spawn_rate;
+    // dead particles hold on to their slots until their block is retired, so the ring needs slack above max_particles
+    num_blocks = 2u * ((config.max_particles + block_capacity - 1u) / block_capacity);
+
+    particles.allocate ((size_t)num_blocks * block_capacity, config.page_mode);
+    points.allocate ((size_t)num_blocks * block_capacity, config.page_mode);
+    blocks.assign (num_blocks, {});
+
+    tail = head = num_blocks_used = 0u;
+    num_alive = 0u;
+    tick_now = 0u;
+    tick_seconds = 0.0;
+  }
+
+  /// @brief change how many particles are spawned per frame & how many workers are used, both at most what was initialised
+  /// (the blocks stay sized for the initial spawn rate, so spawning fewer leaves each block open for longer)
+  void set_work_split (unsigned spawn_rate, unsigned num_threads)
+  {
+    config.spawn_rate = spawn_rate;
+    config.num_threads = num_threads;
+  }
+
+  /// @brief advance time by a tick, retire expired blocks, update the remaining particles & emit new ones
+  /// @return number of active particles
+  /// @param tick_seconds_ the fixed tick, the same every update (see common/fixed_timestep.h)
+  /// @param random_streams one random number stream per worker
+  /// @param field_ if not null, its acceleration is added to every particle before it is processed
+  /// @param lag_seconds how far behind this update to pack the particles for render, see particle_pack
+  unsigned update (double tick_seconds_, particle_type_info_t const type_info [NUM_PARTICLE_TYPES], random_t random_streams [MAX_THREADS],
+    force_field_t const* field_ = nullptr, float lag_seconds = 0.f)
+  {
+    unsigned const num_threads = config.num_threads;
+    float const elapsed_seconds = (float)tick_seconds_;
+    ++tick_now;
+    tick_seconds = tick_seconds_;
+
+    // the kill heights come from the screen size, so these are worked out from this frame's types
+    earliest_death = 1e30f;
+    latest_death = 0.f;
+    for (unsigned i = 0u; i < NUM_PARTICLE_TYPES; ++i)
+    {
+      earliest_death = cuckoo::maths::min (earliest_death, ring_earliest_death (type_info [i]));
+      latest_death = cuckoo::maths::max (latest_death, type_info [i].life_time_max);
+    }
+    field = field_;
+    if (field)
+    {
+      earliest_death = 0.f;
+    }
+
+    // 1. RETIRE
+    // whole blocks at once, O(1) each
+    while (num_blocks_used > 0u)
+    {
+      ring_block_t& block = blocks [tail];
+      if (block.num_alive > 0u && age (block.last_spawn_tick) < latest_death)
+      {
+        break;
+      }
+      num_alive -= block.num_alive;
+      block = {};
+      tail = (tail + 1u) % num_blocks;
+      --num_blocks_used;
+    }
+
+    // 2. UPDATE
+    // give each worker a run of whole blocks, with roughly the same number of particles in each run
+    {
+      unsigned first_block [MAX_THREADS + 1u];
+      unsigned num_slots = 0u;
+      for (unsigned i = 0u; i < num_blocks_used; ++i)
+      {
+        num_slots += blocks [(tail + i) % num_blocks].count;
+      }
+      unsigned worker = 0u;
+      unsigned slots_so_far = 0u;
+      first_block [0] = 0u;
+      for (unsigned i = 0u; i < num_blocks_used && worker + 1u < num_threads; ++i)
+      {
+        slots_so_far += blocks [(tail + i) % num_blocks].count;
+        if ((unsigned long long)slots_so_far * num_threads >= (unsigned long long)num_slots * (worker + 1u))
+        {
+          first_block [++worker] = i + 1u;
+        }
+      }
+      while (worker < num_threads)
+      {
+        first_block [++worker] = num_blocks_used;
+      }
+
+      unsigned killed [MAX_THREADS] = {};
+      workers->run (num_threads, [&] (unsigned i)
+      {
+        update_blocks (first_block [i], first_block [i + 1u], type_info, elapsed_seconds, lag_seconds, killed [i]);
+      });
+      for (unsigned i = 0u; i < num_threads; ++i)
+      {
+        num_alive -= killed [i];
+      }
+    }
+
+    // 3. EMIT
+    // fill what is left of the head block, then open new blocks
+    unsigned num_to_spawn = cuckoo::maths::min (config.spawn_rate, config.max_particles - num_alive);
+    unsigned segment_offset [2] = {};
+    unsigned segment_count [2] = {};
+    unsigned num_segments = 0u;
+    while (num_to_spawn > 0u && num_segments < 2u)
+    {
+      bool const head_is_full = num_blocks_used == 0u || blocks [newest ()].count == block_capacity;
+      if (head_is_full)
+      {
+        if (num_blocks_used == num_blocks)
+        {
+          break; // every block is still in use, try again next frame
+        }
+        head = num_blocks_used == 0u ? tail : (head + 1u) % num_blocks;
+        ++num_blocks_used;
+        blocks [head] = {};
+        blocks [head].first_spawn_tick = tick_now;
+      }
+
+      ring_block_t& block = blocks [head];
+      unsigned const count = cuckoo::maths::min (num_to_spawn, block_capacity - block.count);
+      segment_offset [num_segments] = head * block_capacity + block.count;
+      segment_count [num_segments] = count;
+      ++num_segments;
+
+      block.count += count;
+      block.num_alive += count;
+      block.last_spawn_tick = tick_now;
+      num_alive += count;
+      num_to_spawn -= count;
+    }
+
+    {
+      // each worker emits its share of every segment with its own random number stream
+      auto emit_share = [&] (unsigned worker)
+      {
+        TRACE_ZONE ("emit");
+        for (unsigned s = 0u; s < num_segments; ++s)
+        {
+          unsigned const count = segment_count [s] / num_threads + (worker < segment_count [s] % num_threads ? 1u : 0u);
+          unsigned const offset = segment_offset [s] + worker * (segment_count [s] / num_threads) + cuckoo::maths::min (worker, segment_count [s] % num_threads);
+          emit (random_streams [worker], particles.data (), points.data (), type_info, offset, count);
+        }
+      };
+      workers->run (num_threads, emit_share);
+    }
+
+    return num_alive;
+  }
+
+  /// @brief visit every point packed by the last update
+  template <typename function_t>
+  void for_each_point (function_t function) const
+  {
+    for (unsigned i = 0u; i < num_blocks_used; ++i)
+    {
+      unsigned const index = (tail + i) % num_blocks;
+      ring_block_t const& block = blocks [index];
+      point_t const* block_points = points.data () + (size_t)index * block_capacity;
+
+      for (unsigned j = 0u; j < block.num_points; ++j)
+      {
+        function (block_points [j]);
+      }
+      for (unsigned j = block.emitted_begin; j < block.count; ++j)
+      {
+        function (block_points [j]);
+      }
+    }
+  }
+
+  void release (void)
+  {
+    particles.release ();
+    points.release ();
+    blocks = {};
+    num_blocks_used = 0u;
+    num_alive = 0u;
+  }
+
+
+private:
+  unsigned newest (void) const { return head; }
+
+  /// @brief seconds since spawn_tick, exact however many ticks have run
+  double age (unsigned long long spawn_tick) const { return (double)(tick_now - spawn_tick) * tick_seconds; }
+
+  /// @brief update blocks [tail + first, tail + last), packing each block's live particles into its staging range
+  void update_blocks (unsigned first, unsigned last, particle_type_info_t const* type_info, float elapsed_seconds, float lag_seconds,
+    unsigned& killed)
+  {
+    TRACE_ZONE ("process");
+
+    unsigned num_killed = 0u;
+    for (unsigned b = first; b < last; ++b)
+    {
+      unsigned const index = (tail + b) % num_blocks;
+      ring_block_t& block = blocks [index];
+      particle* block_particles = particles.data () + (size_t)index * block_capacity;
+      point_t* block_points = points.data () + (size_t)index * block_capacity;
+
+      if (field)
+      {
+        // dead particles are sampled too, they are never packed so it does no harm
+        force_field_apply (*field, block_particles, block.count, elapsed_seconds);
+      }
+
+      unsigned num_points = 0u;
+      if (age (block.first_spawn_tick) < earliest_death)
+      {
+        // too young for anything in this block to have died, no kill tests needed
+        for (unsigned i = 0u; i < block.count; ++i)
+        {
+          particle_process (block_particles [i], type_info, elapsed_seconds);
+          block_points [num_points++] = particle_pack (block_particles [i], type_info, elapsed_seconds, lag_seconds);
+        }
+      }
+      else
+      {
+        // in its expiry window, test every particle that is still alive
+        for (unsigned i = 0u; i < block.count; ++i)
+        {
+          particle& p = block_particles [i];
+          if (p.life_remaining <= 0.f)
+          {
+            continue; // killed on an earlier frame
+          }
+          if (particle_process (p, type_info, elapsed_seconds))
+          {
+            p.life_remaining = 0.f; // flag as dead, whatever killed it
+            ++num_killed;
+            --block.num_alive;
+            continue;
+          }
+          block_points [num_points++] = particle_pack (p, type_info, elapsed_seconds, lag_seconds);
+        }
+      }
+      block.num_points = num_points;
+      block.emitted_begin = block.count;
+    }
+    killed = num_killed;
+  }
+
+  page_buffer_t <particle>   particles; // num_blocks * block_capacity slots
+  page_buffer_t <point_t>    points;    // render staging buffer, same layout as particles
+  std::vector <ring_block_t> blocks;
+
+  particle_config_t config;
+  worker_pool_t* workers = nullptr;
+  unsigned block_capacity = 0u;
+  unsigned num_blocks = 0u;
+
+  unsigned tail = 0u;                   // oldest block
+  unsigned head = 0u;                   // newest block
+  unsigned num_blocks_used = 0u;
+  unsigned num_alive = 0u;
+
+  unsigned long long tick_now = 0u;     // ticks run since initialise
+  double   tick_seconds = 0.0;
+  float    earliest_death = 0.f;        // no particle can die younger than this
+  float    latest_death = 0.f;          // every particle is dead by this age
+  force_field_t const* field = nullptr; // this update's affectors, if any
+};
@@ -0,0 +1,314 @@
+// ALLOCATION TRACKER:
+//
+// Shared by SHOT1 & SHOT2.
+// Heap allocations in the game loop cost time (and a lock, in most allocators) and scatter what the frame touches,
+// so they should all be gone once the game is running. The tracker counts every allocation made through the global
+// operator new & delete, so how many a frame makes can be measured and new ones caught:
+//   - counts & bytes allocated per frame (alloc_tracker_t::end_frame) and per named zone (ALLOC_ZONE)
+//   - a zero allocation mode (alloc_tracker_t::enforce_after): once its warm-up frames are over,
+//     end_frame returns false for any frame that allocated, for the app to assert on
+// Counting is a relaxed atomic add per allocation, so it is always on. Like the perf counters, a zone counts the allocations
+// of every thread while it is open, not just its own thread's. Zones should all be on the main thread.
+// To find where a frame allocates, break on alloc_tracker_on_violation, every allocation made while enforcing goes through it.
+//
+// The counting operators new & delete replace the global ones, so they must be defined in exactly one source file
+// of each program: #define ALLOC_TRACKER_IMPLEMENTATION before including this header there (both apps do it in main.cpp).
+// Allocations that bypass operator new (malloc, mmap'd page buffers) are not counted.
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include "telemetry_log.h"             // for TELEMETRY_LOG
+
+#include <atomic>                      // for std::atomic
+#include <cstddef>                     // for size_t
+#include <cstdlib>                     // for std::malloc, std::free
+#include <cstring>                     // for std::strcmp
+#include <new>                         // for std::align_val_t, std::nothrow_t, std::bad_alloc
+
+
+/// @brief allocations made between 2 moments
+struct alloc_counts_t
+{
+  unsigned long long num_allocations = 0u;
+  unsigned long long num_bytes = 0u;
+  unsigned long long num_frees = 0u;
+};
+
+/// @brief updated by every operator new & delete, see 'ALLOCATION TRACKER' above
+struct alloc_counters_t
+{
+  std::atomic <unsigned long long> num_allocations { 0u };
+  std::atomic <unsigned long long> num_bytes { 0u };
+  std::atomic <unsigned long long> num_frees { 0u };
+  std::atomic <bool>               is_enforcing { false };
+  std::atomic <size_t>             last_violation_bytes { 0u };
+};
+
+inline alloc_counters_t alloc_counters;
+
+#if defined (_MSC_VER)
+#define ALLOC_TRACKER_NOINLINE __declspec (noinline)
+#else
+#define ALLOC_TRACKER_NOINLINE __attribute__ ((noinline))
+#endif
+
+/// @brief every allocation made while enforcing the zero allocation mode goes through here, put a breakpoint on it
+ALLOC_TRACKER_NOINLINE inline void alloc_tracker_on_violation (size_t num_bytes)
+{
+  alloc_counters.last_violation_bytes.store (num_bytes, std::memory_order_relaxed);
+}
+
+inline void alloc_tracker_count_allocation (size_t num_bytes)
+{
+  alloc_counters.num_allocations.fetch_add (1u, std::memory_order_relaxed);
+  alloc_counters.num_bytes.fetch_add (num_bytes, std::memory_order_relaxed);
+  if (alloc_counters.is_enforcing.load (std::memory_order_relaxed))
+  {
+    alloc_tracker_on_violation (num_bytes);
+  }
+}
+
+inline void alloc_tracker_count_free (void const* pointer)
+{
+  if (pointer)
+  {
+    alloc_counters.num_frees.fetch_add (1u, std::memory_order_relaxed);
+  }
+}
+
+/// @brief the totals so far, subtract 2 of these for what was allocated in between
+inline alloc_counts_t alloc_counts_now (void)
+{
+  return
+  {
+    alloc_counters.num_allocations.load (std::memory_order_relaxed),
+    alloc_counters.num_bytes.load (std::memory_order_relaxed),
+    alloc_counters.num_frees.load (std::memory_order_relaxed),
+  };
+}
+
+inline alloc_counts_t operator- (alloc_counts_t const& end, alloc_counts_t const& begin)
+{
+  return { end.num_allocations - begin.num_allocations, end.num_bytes - begin.num_bytes, end.num_frees - begin.num_frees };
+}
+
+inline alloc_counts_t operator+ (alloc_counts_t const& lhs, alloc_counts_t const& rhs)
+{
+  return { lhs.num_allocations + rhs.num_allocations, lhs.num_bytes + rhs.num_bytes, lhs.num_frees + rhs.num_frees };
+}
+
+
+/// @brief per frame & per zone counts, see 'ALLOCATION TRACKER' above
+class alloc_tracker_t
+{
+public:
+  static unsigned const MAX_ZONES = 16u;
+
+  /// @brief log each frame's allocations (any that allocated) & its zones', through the telemetry log
+  void set_reporting (bool is_reporting_)
+  {
+    is_reporting = is_reporting_;
+    frame_start = alloc_counts_now (); // the start up's allocations are not the first frame's
+  }
+
+  /// @brief from 'num_warmup_frames' frames from now, any frame that allocates is a violation, see end_frame
+  void enforce_after (unsigned num_warmup_frames)
+  {
+    is_enforcing = true;
+    frame_start = alloc_counts_now ();
+    warmup_frames_left = num_warmup_frames;
+    alloc_counters.is_enforcing.store (num_warmup_frames == 0u, std::memory_order_relaxed);
+  }
+
+  bool is_enabled (void) const { return is_reporting || is_enforcing; }
+
+  /// @brief add a zone's allocations to this frame's, see alloc_zone_t
+  void add (char const* name, alloc_counts_t const& counts)
+  {
+    for (unsigned i = 0u; i < num_zones; ++i)
+    {
+      if (zones [i].name == name || std::strcmp (zones [i].name, name) == 0)
+      {
+        zones [i].frame = zones [i].frame + counts;
+        return;
+      }
+    }
+    if (num_zones < MAX_ZONES)
+    {
+      zones [num_zones++] = { name, counts };
+    }
+  }
+
+  /// @brief close the frame: log its allocations & check the zero allocation mode
+  /// @return false if the frame allocated while enforcing the zero allocation mode
+  bool end_frame (void)
+  {
+    alloc_counts_t const now = alloc_counts_now ();
+    last_frame = now - frame_start;
+    frame_start = now;
+    ++num_frames;
+
+    bool const is_violation = alloc_counters.is_enforcing.load (std::memory_order_relaxed) && last_frame.num_allocations > 0u;
+    num_violations += is_violation ? 1u : 0u;
+    if (is_violation || (is_reporting && last_frame.num_allocations > 0u))
+    {
+      if (is_violation)
+      {
+        TELEMETRY_LOG (0u, "alloc: frame %llu made %llu allocations, %llu bytes, in ZERO ALLOCATION mode (the last was %zu bytes)\n",
+          num_frames, last_frame.num_allocations, last_frame.num_bytes, alloc_counters.last_violation_bytes.load (std::memory_order_relaxed));
+      }
+      else
+      {
+        TELEMETRY_LOG (0u, "alloc: frame %llu made %llu allocations, %llu bytes, %llu frees\n",
+          num_frames, last_frame.num_allocations, last_frame.num_bytes, last_frame.num_frees);
+      }
+      for (unsigned i = 0u; i < num_zones; ++i)
+      {
+        if (zones [i].frame.num_allocations > 0u)
+        {
+          TELEMETRY_LOG (0u, "alloc:   %s: %llu allocations, %llu bytes\n", zones [i].name, zones [i].frame.num_allocations, zones [i].frame.num_bytes);
+        }
+      }
+    }
+    for (unsigned i = 0u; i < num_zones; ++i)
+    {
+      zones [i].frame = {};
+    }
+
+    if (is_enforcing && warmup_frames_left > 0u && --warmup_frames_left == 0u)
+    {
+      alloc_counters.is_enforcing.store (true, std::memory_order_relaxed);
+    }
+    return !is_violation;
+  }
+
+  /// @brief the last frame end_frame closed
+  alloc_counts_t get_last_frame (void) const { return last_frame; }
+
+  /// @brief frames that allocated while enforcing the zero allocation mode
+  unsigned long long get_num_violations (void) const { return num_violations; }
+
+
+private:
+  struct zone_t
+  {
+    char const*    name = nullptr;
+    alloc_counts_t frame;            // this frame's so far
+  };
+
+  bool               is_reporting = false;
+  bool               is_enforcing = false;
+  unsigned           warmup_frames_left = 0u;
+  unsigned long long num_frames = 0u;
+  unsigned long long num_violations = 0u;
+  alloc_counts_t     frame_start;
+  alloc_counts_t     last_frame;
+  zone_t             zones [MAX_ZONES];
+  unsigned           num_zones = 0u;
+};
+
+/// @brief the process' tracker
+inline alloc_tracker_t alloc_tracker;
+
+
+/// @brief counts the allocations made in its scope into alloc_tracker, see ALLOC_ZONE
+class alloc_zone_t
+{
+public:
+  explicit alloc_zone_t (char const* name_)
+    : name (name_)
+    , begin (alloc_counts_now ())
+  {
+  }
+
+  ~alloc_zone_t (void)
+  {
+    alloc_tracker.add (name, alloc_counts_now () - begin);
+  }
+
+  alloc_zone_t (alloc_zone_t const&) = delete;
+  alloc_zone_t& operator= (alloc_zone_t const&) = delete;
+
+private:
+  char const*    name;
+  alloc_counts_t begin;
+};
+
+#define ALLOC_CONCATENATE_(a, b) a##b
+#define ALLOC_CONCATENATE(a, b) ALLOC_CONCATENATE_ (a, b)
+
+/// @brief count the allocations made in the rest of the enclosing scope under 'name' (a string literal)
+#define ALLOC_ZONE(name) alloc_zone_t const ALLOC_CONCATENATE (alloc_zone_, __LINE__) (name)
+
+
+// COUNTING OPERATORS NEW & DELETE
+
+#if defined (ALLOC_TRACKER_IMPLEMENTATION)
+
+// not inlined into its callers, where GCC's object size checks take the vector growth code around it for overflows
+ALLOC_TRACKER_NOINLINE inline void* alloc_tracker_allocate (size_t num_bytes, size_t alignment)
+{
+  alloc_tracker_count_allocation (num_bytes);
+  num_bytes = num_bytes ? num_bytes : 1u;
+  if (alignment <= alignof (std::max_align_t))
+  {
+    return std::malloc (num_bytes);
+  }
+#if defined (_WIN32)
+  return _aligned_malloc (num_bytes, alignment);
+#else
+  void* pointer = nullptr;
+  return posix_memalign (&pointer, alignment, num_bytes) == 0 ? pointer : nullptr;
+#endif
+}
+
+inline void alloc_tracker_free (void* pointer, size_t alignment)
+{
+  alloc_tracker_count_free (pointer);
+#if defined (_WIN32)
+  if (alignment > alignof (std::max_align_t))
+  {
+    _aligned_free (pointer);
+    return;
+  }
+#endif
+  (void)alignment;
+  std::free (pointer);
+}
+
+inline void* alloc_tracker_allocate_or_throw (size_t num_bytes, size_t alignment)
+{
+  void* const pointer = alloc_tracker_allocate (num_bytes, alignment);
+  if (!pointer)
+  {
+    throw std::bad_alloc ();
+  }
+  return pointer;
+}
+
+void* operator new (size_t num_bytes) { return alloc_tracker_allocate_or_throw (num_bytes, 0u); }
+void* operator new [] (size_t num_bytes) { return alloc_tracker_allocate_or_throw (num_bytes, 0u); }
+void* operator new (size_t num_bytes, std::nothrow_t const&) noexcept { return alloc_tracker_allocate (num_bytes, 0u); }
+void* operator new [] (size_t num_bytes, std::nothrow_t const&) noexcept { return alloc_tracker_allocate (num_bytes, 0u); }
+void* operator new (size_t num_bytes, std::align_val_t alignment) { return alloc_tracker_allocate_or_throw (num_bytes, (size_t)alignment); }
+void* operator new [] (size_t num_bytes, std::align_val_t alignment) { return alloc_tracker_allocate_or_throw (num_bytes, (size_t)alignment); }
+void* operator new (size_t num_bytes, std::align_val_t alignment, std::nothrow_t const&) noexcept { return alloc_tracker_allocate (num_bytes, (size_t)alignment); }
+void* operator new [] (size_t num_bytes, std::align_val_t alignment, std::nothrow_t const&) noexcept { return alloc_tracker_allocate (num_bytes, (size_t)alignment); }
+
+void operator delete (void* pointer) noexcept { alloc_tracker_free (pointer, 0u); }
+void operator delete [] (void* pointer) noexcept { alloc_tracker_free (pointer, 0u); }
+void operator delete (void* pointer, size_t) noexcept { alloc_tracker_free (pointer, 0u); }
+void operator delete [] (void* pointer, size_t) noexcept { alloc_tracker_free (pointer, 0u); }
+void operator delete (void* pointer, std::nothrow_t const&) noexcept { alloc_tracker_free (pointer, 0u); }
+void operator delete [] (void* pointer, std::nothrow_t const&) noexcept { alloc_tracker_free (pointer, 0u); }
+void operator delete (void* pointer, std::align_val_t alignment) noexcept { alloc_tracker_free (pointer, (size_t)alignment); }
+void operator delete [] (void* pointer, std::align_val_t alignment) noexcept { alloc_tracker_free (pointer, (size_t)alignment); }
+void operator delete (void* pointer, size_t, std::align_val_t alignment) noexcept { alloc_tracker_free (pointer, (size_t)alignment); }
+void operator delete [] (void* pointer, size_t, std::align_val_t alignment) noexcept { alloc_tracker_free (pointer, (size_t)alignment); }
+void operator delete (void* pointer, std::align_val_t alignment, std::nothrow_t const&) noexcept { alloc_tracker_free (pointer, (size_t)alignment); }
+void operator delete [] (void* pointer, std::align_val_t alignment, std::nothrow_t const&) noexcept { alloc_tracker_free (pointer, (size_t)alignment); }
+
+#endif
@@ -0,0 +1,123 @@
+// FIXED TIME STEP:
+//
+// Shared by SHOT1 & SHOT2.
+// Integrating each frame with its raw elapsed time ties the simulation to the frame rate: the first frame & any hitch
+// make one huge step (tiles tunnel through walls, particles jump), and runs differ from machine to machine.
+// Instead the simulation advances in ticks of a fixed length (an accumulator loop):
+//   - each frame's elapsed time is added to an accumulator, and as many whole ticks as it holds are run that frame
+//   - at most max_ticks_per_frame are run in one frame, so a long hitch cannot snowball into ever longer frames,
+//     the time due beyond that is dropped (and counted): the game slows down for a moment rather than stalls
+//   - the remainder, less than a tick, is carried over to the next frame, and says how far the display is between
+//     the last 2 ticks: render draws the state interpolated between the previous tick & the latest by get_alpha
+// The tick rate is set independently of the display rate, so a tick costs the same whatever the frame rate.
+// SHOT_TICK_RATE (ticks per second), SHOT_MAX_TICKS (per frame) & SHOT_INTERPOLATE (0 to draw the latest tick as it is)
+// override the defaults, see fixed_timestep_from_environment.
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include "telemetry_log.h"             // for TELEMETRY_LOG
+
+#include <cstdlib>                     // for std::getenv, std::strtod, std::strtoul
+
+
+static double const FIXED_TIMESTEP_TICK_RATE = 60.0;  // ticks per second
+static unsigned const FIXED_TIMESTEP_MAX_TICKS = 4u;  // per frame, a frame below 15 FPS drops time
+
+
+/// @brief see 'FIXED TIME STEP' above
+class fixed_timestep_t
+{
+public:
+  /// @param tick_rate ticks per second
+  /// @param max_ticks_per_frame_ the catch-up cap, at least 1
+  /// @param is_interpolated_ false to always draw the latest tick (get_alpha is then always 1)
+  void initialise (double tick_rate, unsigned max_ticks_per_frame_, bool is_interpolated_)
+  {
+    tick_seconds = 1.0 / (tick_rate > 0.0 ? tick_rate : FIXED_TIMESTEP_TICK_RATE);
+    max_ticks_per_frame = max_ticks_per_frame_ > 0u ? max_ticks_per_frame_ : 1u;
+    is_interpolated = is_interpolated_;
+    accumulator = 0.0;
+    num_ticks = 0u;
+  }
+
+  /// @brief add a frame's elapsed time
+  /// @return how many ticks to run this frame, 0 to max_ticks_per_frame
+  unsigned advance (double elapsed_seconds)
+  {
+    accumulator += elapsed_seconds > 0.0 ? elapsed_seconds : 0.0;
+    // a frame exactly a tick long runs that tick, whatever the rounding of tick_seconds
+    double const due = accumulator / tick_seconds + 1e-9;
+    unsigned const num_due = due < 1e6 ? (unsigned)due : 1000000u;
+    num_ticks = num_due < max_ticks_per_frame ? num_due : max_ticks_per_frame;
+    accumulator -= num_ticks * tick_seconds;
+
+    // over the cap, keep only the remainder of a tick
+    if (num_due > num_ticks)
+    {
+      double const dropped = (double)(num_due - num_ticks) * tick_seconds;
+      accumulator -= dropped;
+      dropped_seconds += dropped;
+      ++num_capped_frames;
+      TELEMETRY_LOG (1000u, "fixed timestep: %u ticks due, ran %u, dropped %.3f seconds\n", num_due, num_ticks, dropped);
+    }
+    accumulator = accumulator > 0.0 ? accumulator : 0.0; // rounding
+    total_ticks += num_ticks;
+    return num_ticks;
+  }
+
+  double get_tick_seconds (void) const { return tick_seconds; }
+
+  /// @brief ticks run this frame, as returned by the last advance
+  unsigned get_num_ticks (void) const { return num_ticks; }
+
+  /// @brief where the display is between the previous tick (0) & the latest (1)
+  double get_alpha (void) const { return is_interpolated ? (accumulator < tick_seconds ? accumulator / tick_seconds : 1.0) : 1.0; }
+
+  /// @brief how far behind the latest tick to draw, for state that is drawn by moving back along its velocity
+  double get_render_lag_seconds (void) const { return (1.0 - get_alpha ()) * tick_seconds; }
+
+  unsigned long long get_total_ticks (void) const { return total_ticks; }
+
+  /// @brief frames that hit the catch-up cap, and the time they dropped
+  unsigned long long get_num_capped_frames (void) const { return num_capped_frames; }
+  double get_dropped_seconds (void) const { return dropped_seconds; }
+
+
+private:
+  double             tick_seconds = 1.0 / FIXED_TIMESTEP_TICK_RATE;
+  unsigned           max_ticks_per_frame = FIXED_TIMESTEP_MAX_TICKS;
+  bool               is_interpolated = true;
+  double             accumulator = 0.0;   // elapsed time not yet simulated, [0, tick_seconds) after advance
+  unsigned           num_ticks = 0u;
+  unsigned long long total_ticks = 0u;
+  unsigned long long num_capped_frames = 0u;
+  double             dropped_seconds = 0.0;
+};
+
+
+/// @brief the default time step, overridden by any of SHOT_TICK_RATE, SHOT_MAX_TICKS & SHOT_INTERPOLATE
+inline fixed_timestep_t fixed_timestep_from_environment (void)
+{
+  double tick_rate = FIXED_TIMESTEP_TICK_RATE;
+  unsigned max_ticks = FIXED_TIMESTEP_MAX_TICKS;
+  bool is_interpolated = true;
+  if (char const* text = std::getenv ("SHOT_TICK_RATE"))
+  {
+    tick_rate = std::strtod (text, nullptr);
+  }
+  if (char const* text = std::getenv ("SHOT_MAX_TICKS"))
+  {
+    max_ticks = (unsigned)std::strtoul (text, nullptr, 10);
+  }
+  if (char const* text = std::getenv ("SHOT_INTERPOLATE"))
+  {
+    is_interpolated = std::strtoul (text, nullptr, 10) != 0u;
+  }
+
+  fixed_timestep_t timestep;
+  timestep.initialise (tick_rate, max_ticks, is_interpolated);
+  return timestep;
+}
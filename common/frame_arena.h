@@ -0,0 +1,189 @@
+// FRAME ARENA:
+//
+// Used by SHOT1.
+// Containers rebuilt every frame (collision pairs) cost a trip to the general heap each,
+// every frame, and land wherever the heap puts them. A frame arena hands out memory by bumping a pointer through one
+// preallocated block and takes it all back at once when reset at the top of the next frame, so per frame scratch costs
+// no allocator calls and reuses the same, cache warm, memory every frame:
+//   - the block is split into sub-arenas, one per thread (frame_arena_t::get), each on its own cache lines,
+//     so every thread bumps its own pointer with no synchronisation
+//   - frame_allocator_t adapts a sub-arena for STL containers, e.g. frame_vector_t <collision_pair_t> pairs (arena.get (0));
+//   - deallocation does nothing, except that the latest allocation is given back, so a vector growing in place reuses its space
+//   - a full sub-arena falls back to the heap & counts the overflow, size the arena from get_high_water
+// Nothing allocated from a sub-arena may outlive the frame, or be in use by another thread when it is reset.
+// The block is a page_buffer_t (mmap'd on Linux), so the arena never goes through operator new itself.
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include "page_buffer.h"               // for page_buffer_t, PAGE_MODE_SMALL
+
+#include <cstddef>                     // for size_t, std::max_align_t
+#include <cstdint>                     // for uintptr_t
+#include <new>                         // for operator new, std::align_val_t
+#include <vector>                      // for std::vector
+
+
+/// @brief one thread's share of a frame_arena_t, see 'FRAME ARENA' above
+class alignas (64) frame_sub_arena_t
+{
+public:
+  /// @brief 'num_bytes' aligned to 'alignment' (a power of 2), from the sub-arena if it fits, otherwise from the heap
+  void* allocate (size_t num_bytes, size_t alignment)
+  {
+    uintptr_t const aligned = ((uintptr_t)next + (alignment - 1u)) & ~(uintptr_t)(alignment - 1u);
+    if (begin && aligned + num_bytes <= (uintptr_t)end)
+    {
+      next = (unsigned char*)(aligned + num_bytes);
+      return (void*)aligned;
+    }
+    ++num_overflows;
+    return alignment > alignof (std::max_align_t) ? ::operator new (num_bytes, std::align_val_t (alignment)) : ::operator new (num_bytes);
+  }
+
+  /// @brief give back an allocation: only the latest one is actually reused, see 'FRAME ARENA' above
+  void deallocate (void* pointer, size_t num_bytes, size_t alignment)
+  {
+    unsigned char* const bytes = (unsigned char*)pointer;
+    if (bytes >= begin && bytes < end)
+    {
+      if (bytes + num_bytes == next)
+      {
+        next = bytes;
+      }
+      return;
+    }
+    if (alignment > alignof (std::max_align_t))
+    {
+      ::operator delete (pointer, std::align_val_t (alignment));
+    }
+    else
+    {
+      ::operator delete (pointer);
+    }
+  }
+
+  /// @brief take back everything allocated since the last reset
+  void reset (void)
+  {
+    size_t const used = (size_t)(next - begin);
+    high_water = used > high_water ? used : high_water;
+    next = begin;
+  }
+
+  /// @brief the most used between 2 resets
+  size_t get_high_water (void) const { return high_water; }
+
+  /// @brief allocations that did not fit & went to the heap
+  unsigned long long get_num_overflows (void) const { return num_overflows; }
+
+
+private:
+  friend class frame_arena_t;
+
+  unsigned char*     begin = nullptr;
+  unsigned char*     end = nullptr;
+  unsigned char*     next = nullptr;
+  size_t             high_water = 0u;
+  unsigned long long num_overflows = 0u;
+};
+
+
+/// @brief a block of per frame scratch memory split into per thread sub-arenas, see 'FRAME ARENA' above
+class frame_arena_t
+{
+public:
+  /// @param bytes_per_thread rounded up to a whole number of cache lines
+  /// @param num_threads sub-arenas, get (0) to get (num_threads - 1)
+  /// @return false if the block could not be allocated, every allocation then goes to the heap
+  bool initialise (size_t bytes_per_thread, unsigned num_threads)
+  {
+    release ();
+    bytes_per_thread = (bytes_per_thread + 63u) & ~(size_t)63u;
+    sub_arenas.resize (num_threads);
+    // small pages, the arena is small & the same few pages are reused every frame
+    if (!block.allocate (bytes_per_thread * num_threads, PAGE_MODE_SMALL))
+    {
+      return false;
+    }
+    for (unsigned i = 0u; i < num_threads; ++i)
+    {
+      frame_sub_arena_t& sub_arena = sub_arenas [i];
+      sub_arena.begin = sub_arena.next = block.data () + bytes_per_thread * i;
+      sub_arena.end = sub_arena.begin + bytes_per_thread;
+    }
+    return true;
+  }
+
+  void release (void)
+  {
+    block.release ();
+    sub_arenas = {};
+  }
+
+  /// @brief take back everything allocated from every sub-arena, at the top of the frame
+  void reset (void)
+  {
+    for (frame_sub_arena_t& sub_arena : sub_arenas)
+    {
+      sub_arena.reset ();
+    }
+  }
+
+  frame_sub_arena_t& get (unsigned thread) { return sub_arenas [thread]; }
+
+  /// @brief the most any sub-arena has used between 2 resets
+  size_t get_high_water (void) const
+  {
+    size_t high_water = 0u;
+    for (frame_sub_arena_t const& sub_arena : sub_arenas)
+    {
+      high_water = sub_arena.get_high_water () > high_water ? sub_arena.get_high_water () : high_water;
+    }
+    return high_water;
+  }
+
+  /// @brief allocations, over every sub-arena, that did not fit & went to the heap
+  unsigned long long get_num_overflows (void) const
+  {
+    unsigned long long num_overflows = 0u;
+    for (frame_sub_arena_t const& sub_arena : sub_arenas)
+    {
+      num_overflows += sub_arena.get_num_overflows ();
+    }
+    return num_overflows;
+  }
+
+
+private:
+  page_buffer_t <unsigned char>   block;
+  std::vector <frame_sub_arena_t> sub_arenas;
+};
+
+
+/// @brief an STL allocator that allocates from a frame_sub_arena_t
+template <typename value_t>
+struct frame_allocator_t
+{
+  using value_type = value_t;
+
+  frame_allocator_t (frame_sub_arena_t& arena_) noexcept : arena (&arena_) {}
+  template <typename other_t>
+  frame_allocator_t (frame_allocator_t <other_t> const& other) noexcept : arena (other.arena) {}
+
+  value_t* allocate (size_t count) { return (value_t*)arena->allocate (count * sizeof (value_t), alignof (value_t)); }
+  void deallocate (value_t* pointer, size_t count) noexcept { arena->deallocate (pointer, count * sizeof (value_t), alignof (value_t)); }
+
+  template <typename other_t>
+  bool operator== (frame_allocator_t <other_t> const& other) const { return arena == other.arena; }
+  template <typename other_t>
+  bool operator!= (frame_allocator_t <other_t> const& other) const { return arena != other.arena; }
+
+  frame_sub_arena_t* arena;
+};
+
+/// @brief a std::vector of per frame scratch
+template <typename value_t>
+using frame_vector_t = std::vector <value_t, frame_allocator_t <value_t>>;
@@ -0,0 +1,181 @@
+// GOLDEN TRACE:
+//
+// Shared by SHOT1 & SHOT2.
+// Optimised variants of the simulation (SIMD, threaded, blocked or reordered loops) must still do what the plain
+// scalar code does. A determinism check runs a scalar reference & the optimised variant side by side, from the same seed
+// & the same inputs, and compares their world state after every frame:
+//   - golden_checker_t::compare checks one field of one entity within a tolerance, relative to the larger of the 2 values
+//     (with an absolute floor of 1), as a compiler fusing multiply-adds or a reordered sum is allowed to change the last bits
+//   - the first divergence (frame, entity, field & both values) is kept, later ones are only counted,
+//     as once 2 worlds diverge everything downstream of it diverges too
+//   - each world's exact bits are also hashed every frame (golden_hash_t, FNV-1a), equal hashes mean bit identical frames
+//   - the variant's per frame hashes can be written out as a golden trace (golden_trace_write) & checked by a later run
+//     (golden_trace_read), to compare builds with different compile time options, e.g. against a known good build
+// See headless/shot1_golden.cpp & headless/shot2_golden.cpp.
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include <cmath>                       // for std::fabs, std::isnan
+#include <cstdint>                     // for uint64_t
+#include <cstdio>                      // for std::fopen, std::fprintf, std::snprintf, std::fgets, std::fscanf, std::fclose
+#include <cstring>                     // for std::memcpy, std::strcmp
+#include <type_traits>                 // for std::is_trivially_copyable_v
+#include <vector>                      // for std::vector
+
+
+/// @brief FNV-1a over the bytes of every value added, see 'GOLDEN TRACE' above
+struct golden_hash_t
+{
+  uint64_t value = 14695981039346656037ull;
+
+  template <typename value_t>
+  void add (value_t const& v)
+  {
+    static_assert (std::is_trivially_copyable_v <value_t>, "only plain values can be hashed");
+    unsigned char bytes [sizeof (value_t)];
+    std::memcpy (bytes, &v, sizeof (value_t));
+    for (unsigned char byte : bytes)
+    {
+      value = (value ^ byte) * 1099511628211ull;
+    }
+  }
+};
+
+/// @brief where the reference & the variant first disagreed
+struct golden_divergence_t
+{
+  unsigned    frame = 0u;
+  char const* kind = nullptr;          // what the entity is, e.g. "particle", a string literal
+  unsigned    entity = 0u;
+  char const* field = nullptr;         // a string literal
+  double      reference = 0.0;
+  double      variant = 0.0;
+};
+
+/// @brief compares a reference & a variant world, field by field & frame by frame, see 'GOLDEN TRACE' above
+class golden_checker_t
+{
+public:
+  /// @param tolerance_ the largest difference allowed, relative to the larger value (at least 1), 0 for exact
+  explicit golden_checker_t (double tolerance_) : tolerance (tolerance_) {}
+
+  void begin_frame (unsigned frame_) { frame = frame_; }
+
+  /// @param kind what the entity is, e.g. "particle", a string literal like 'field'
+  /// @return true if 'variant' is within the tolerance of 'reference'
+  bool compare (char const* kind, unsigned entity, char const* field, double reference, double variant)
+  {
+    double const scale = std::fabs (reference) > std::fabs (variant) ? std::fabs (reference) : std::fabs (variant);
+    double const limit = tolerance * (scale > 1.0 ? scale : 1.0);
+    bool const is_match = std::isnan (reference) ? std::isnan (variant) : std::fabs (reference - variant) <= limit;
+    if (!is_match)
+    {
+      if (num_divergences == 0u)
+      {
+        first = { frame, kind, entity, field, reference, variant };
+      }
+      ++num_divergences;
+    }
+    return is_match;
+  }
+
+  /// @brief the frame's world hashes, after all its fields have been compared
+  void end_frame (uint64_t reference_hash, uint64_t variant_hash)
+  {
+    num_bit_identical_frames += reference_hash == variant_hash ? 1u : 0u;
+    variant_hashes.push_back (variant_hash);
+  }
+
+  bool has_diverged (void) const { return num_divergences > 0u; }
+  golden_divergence_t const& get_first_divergence (void) const { return first; }
+  unsigned long long get_num_divergences (void) const { return num_divergences; }
+  unsigned get_num_frames (void) const { return (unsigned)variant_hashes.size (); }
+  unsigned get_num_bit_identical_frames (void) const { return num_bit_identical_frames; }
+  std::vector <uint64_t> const& get_variant_hashes (void) const { return variant_hashes; }
+
+  /// @brief print the outcome, a line at a time
+  void report (void (*print) (char const* text, void* user_data), void* user_data) const
+  {
+    char text [256];
+    std::snprintf (text, sizeof (text), "frames      : %u compared, %u bit identical, tolerance %g\n",
+      get_num_frames (), num_bit_identical_frames, tolerance);
+    print (text, user_data);
+    if (!has_diverged ())
+    {
+      print ("result      : MATCH, the variant stayed within tolerance of the reference\n", user_data);
+      return;
+    }
+    std::snprintf (text, sizeof (text), "result      : DIVERGED, %llu fields out of tolerance\n", num_divergences);
+    print (text, user_data);
+    std::snprintf (text, sizeof (text), "first       : frame %u, %s %u, %s: reference %.9g, variant %.9g (difference %.3g)\n",
+      first.frame, first.kind, first.entity, first.field, first.reference, first.variant, first.variant - first.reference);
+    print (text, user_data);
+  }
+
+private:
+  double                 tolerance;
+  unsigned               frame = 0u;
+  golden_divergence_t    first;
+  unsigned long long     num_divergences = 0u;
+  unsigned               num_bit_identical_frames = 0u;
+  std::vector <uint64_t> variant_hashes;
+};
+
+
+// TRACE FILES
+// plain text, so 2 traces can be diffed: a header line naming the run, then one hash per frame in hex
+
+/// @param name what was run, e.g. its options, checked again by golden_trace_read
+/// @return false if the file could not be written
+inline bool golden_trace_write (char const* path, char const* name, std::vector <uint64_t> const& hashes)
+{
+  FILE* file = std::fopen (path, "w");
+  if (!file)
+  {
+    return false;
+  }
+  std::fprintf (file, "golden trace 1 %s\n", name);
+  for (uint64_t hash : hashes)
+  {
+    std::fprintf (file, "%016llx\n", (unsigned long long)hash);
+  }
+  return std::fclose (file) == 0;
+}
+
+/// @param name must match the name the trace was written with
+/// @return false if the file could not be read, or was written by a different run
+inline bool golden_trace_read (char const* path, char const* name, std::vector <uint64_t>& hashes)
+{
+  FILE* file = std::fopen (path, "r");
+  if (!file)
+  {
+    return false;
+  }
+  char header [512] = {};
+  char expected [512] = {};
+  std::snprintf (expected, sizeof (expected), "golden trace 1 %s\n", name);
+  bool const is_match = std::fgets (header, sizeof (header), file) && std::strcmp (header, expected) == 0;
+
+  hashes.clear ();
+  unsigned long long hash = 0u;
+  while (is_match && std::fscanf (file, "%llx", &hash) == 1)
+  {
+    hashes.push_back ((uint64_t)hash);
+  }
+  std::fclose (file);
+  return is_match;
+}
+
+/// @return the first frame whose hash differs between 2 traces, or the shorter trace's length if one is a prefix of the other
+inline unsigned golden_trace_first_difference (std::vector <uint64_t> const& expected, std::vector <uint64_t> const& actual)
+{
+  unsigned frame = 0u;
+  while (frame < expected.size () && frame < actual.size () && expected [frame] == actual [frame])
+  {
+    ++frame;
+  }
+  return frame;
+}
@@ -0,0 +1,235 @@
+// PAGE BUFFERS:
+//
+// Shared by SHOT1 & SHOT2.
+// A fixed size array of trivially copyable elements, allocated straight from the OS with mmap rather than from the heap,
+// so how it is backed by pages can be chosen:
+//   PAGE_MODE_SMALL       | 4 KB pages only (transparent huge pages are switched off for the range), the baseline
+//   PAGE_MODE_TRANSPARENT | 2 MB aligned & advised as a transparent huge page candidate (madvise MADV_HUGEPAGE)
+//   PAGE_MODE_EXPLICIT    | explicit huge pages from the hugetlbfs pool (MAP_HUGETLB), these must be reserved beforehand
+//                         | e.g. 'echo 512 > /proc/sys/vm/nr_hugepages', falls back to PAGE_MODE_TRANSPARENT if none are free
+// With millions of particles the buffers are hundreds of MB, 2 MB pages cut the number of TLB entries needed to walk them by 512x.
+//
+// A buffer can also be mapped from a file (map_file), see common/world_checkpoint.h.
+// Linux only, elsewhere every mode is an ordinary aligned heap allocation (get_page_mode reports PAGE_MODE_SMALL).
+// Like a std::vector after resize, the elements start zeroed.
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include <cstddef>                     // for size_t
+#include <cstring>                     // for std::memset, std::strcmp
+#include <new>                         // for std::align_val_t
+#include <type_traits>                 // for std::is_trivially_copyable_v
+#include <utility>                     // for std::swap
+
+#if defined (__linux__)
+#define PAGE_BUFFER_USE_MMAP 1
+#include <sys/mman.h>                  // for mmap, munmap, madvise
+#else
+#define PAGE_BUFFER_USE_MMAP 0
+#endif
+
+
+enum page_mode_t
+{
+  PAGE_MODE_SMALL,
+  PAGE_MODE_TRANSPARENT,
+  PAGE_MODE_EXPLICIT,
+};
+
+/// @brief "small", "transparent" or "explicit"
+inline char const* page_mode_name (page_mode_t mode)
+{
+  switch (mode)
+  {
+  case PAGE_MODE_SMALL:       return "small";
+  case PAGE_MODE_TRANSPARENT: return "transparent";
+  case PAGE_MODE_EXPLICIT:    return "explicit";
+  }
+  return "?";
+}
+
+/// @brief parse a page_mode_name
+/// @return false if 'name' is not a page mode, 'mode' is left unchanged
+inline bool page_mode_from_name (char const* name, page_mode_t& mode)
+{
+  for (page_mode_t candidate : { PAGE_MODE_SMALL, PAGE_MODE_TRANSPARENT, PAGE_MODE_EXPLICIT })
+  {
+    if (std::strcmp (name, page_mode_name (candidate)) == 0)
+    {
+      mode = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/// @brief see 'PAGE BUFFERS' above
+template <typename element_t>
+class page_buffer_t
+{
+  static_assert (std::is_trivially_copyable_v <element_t>, "page_buffer_t elements are zero filled & never constructed");
+
+public:
+  static size_t const HUGE_PAGE_BYTES = 2u * 1024u * 1024u;
+  static size_t const SMALL_PAGE_BYTES = 4u * 1024u;
+
+  page_buffer_t (void) = default;
+  page_buffer_t (page_buffer_t const&) = delete;
+  page_buffer_t& operator= (page_buffer_t const&) = delete;
+  ~page_buffer_t (void) { release (); }
+
+  /// @brief release any previous allocation & allocate 'count' zeroed elements
+  /// @param mode the page mode asked for, see get_page_mode for the one obtained
+  /// @return false if the memory could not be allocated
+  bool allocate (size_t count_, page_mode_t mode)
+  {
+    release ();
+    if (count_ == 0u)
+    {
+      return true;
+    }
+
+    size_t const bytes_needed = count_ * sizeof (element_t);
+#if PAGE_BUFFER_USE_MMAP
+    if (mode == PAGE_MODE_EXPLICIT)
+    {
+      size_t const bytes = round_up (bytes_needed, HUGE_PAGE_BYTES);
+      void* memory = mmap (nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (memory != MAP_FAILED)
+      {
+        return adopt (memory, memory, bytes, count_, PAGE_MODE_EXPLICIT);
+      }
+      mode = PAGE_MODE_TRANSPARENT; // the huge page pool is empty or too small
+    }
+
+    // over allocate, so the range can be trimmed to whole, aligned huge pages
+    size_t const bytes = round_up (bytes_needed, HUGE_PAGE_BYTES);
+    size_t const mapped_bytes = bytes + HUGE_PAGE_BYTES;
+    char* mapped = (char*)mmap (nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == (char*)MAP_FAILED)
+    {
+      return false;
+    }
+    char* aligned = (char*)round_up ((size_t)mapped, HUGE_PAGE_BYTES);
+    if (aligned != mapped)
+    {
+      munmap (mapped, (size_t)(aligned - mapped));
+    }
+    if (aligned + bytes != mapped + mapped_bytes)
+    {
+      munmap (aligned + bytes, (size_t)(mapped + mapped_bytes - (aligned + bytes)));
+    }
+    madvise (aligned, bytes, mode == PAGE_MODE_TRANSPARENT ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+    return adopt (aligned, aligned, bytes, count_, mode);
+#else
+    (void)mode;
+    void* memory = ::operator new (bytes_needed, std::align_val_t (64u), std::nothrow);
+    if (!memory)
+    {
+      return false;
+    }
+    std::memset (memory, 0, bytes_needed);
+    return adopt (memory, memory, bytes_needed, count_, PAGE_MODE_SMALL);
+#endif
+  }
+
+  /// @brief release any previous allocation & map 'count_' elements, the first 'file_count' of them straight from a file
+  /// The file's pages are mapped privately: read in as they are first touched & copied on their first write,
+  /// so the file itself never changes. The elements past 'file_count' start zeroed, as with allocate.
+  /// @param fd an open file, which can be closed once mapped
+  /// @param offset where the elements start in the file, a multiple of the page size
+  /// @return false if the file could not be mapped (always, when not on Linux), the buffer is then empty
+  bool map_file (int fd, size_t offset, size_t file_count, size_t count_)
+  {
+    release ();
+#if PAGE_BUFFER_USE_MMAP
+    if (count_ == 0u || file_count > count_)
+    {
+      return count_ == 0u;
+    }
+    // reserve the whole range, then lay the file's pages over the start of it
+    size_t const bytes = round_up (count_ * sizeof (element_t), SMALL_PAGE_BYTES);
+    char* mapped = (char*)mmap (nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == (char*)MAP_FAILED)
+    {
+      return false;
+    }
+    if (file_count > 0u
+      && mmap (mapped, file_count * sizeof (element_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, (off_t)offset) == MAP_FAILED)
+    {
+      munmap (mapped, bytes);
+      return false;
+    }
+    return adopt (mapped, mapped, bytes, count_, PAGE_MODE_SMALL);
+#else
+    (void)fd; (void)offset; (void)file_count; (void)count_;
+    return false;
+#endif
+  }
+
+  void release (void)
+  {
+    if (mapping)
+    {
+#if PAGE_BUFFER_USE_MMAP
+      munmap (mapping, mapping_bytes);
+#else
+      ::operator delete (mapping, std::align_val_t (64u));
+#endif
+    }
+    elements = nullptr;
+    mapping = nullptr;
+    mapping_bytes = 0u;
+    count = 0u;
+    page_mode = PAGE_MODE_SMALL;
+  }
+
+  /// @brief trade allocations with another buffer, O(1)
+  void swap (page_buffer_t& other)
+  {
+    std::swap (elements, other.elements);
+    std::swap (mapping, other.mapping);
+    std::swap (mapping_bytes, other.mapping_bytes);
+    std::swap (count, other.count);
+    std::swap (page_mode, other.page_mode);
+  }
+
+  element_t* data (void) { return elements; }
+  element_t const* data (void) const { return elements; }
+  size_t size (void) const { return count; }
+
+  element_t& operator[] (size_t index) { return elements [index]; }
+  element_t const& operator[] (size_t index) const { return elements [index]; }
+
+  /// @brief the page mode actually obtained, which may not be the one asked for
+  page_mode_t get_page_mode (void) const { return page_mode; }
+
+  /// @brief bytes reserved from the OS, including rounding up to whole huge pages
+  size_t get_reserved_bytes (void) const { return mapping_bytes; }
+
+private:
+  static size_t round_up (size_t value, size_t alignment)
+  {
+    return (value + alignment - 1u) / alignment * alignment;
+  }
+
+  bool adopt (void* mapping_, void* elements_, size_t mapping_bytes_, size_t count_, page_mode_t page_mode_)
+  {
+    mapping = mapping_;
+    elements = (element_t*)elements_;
+    mapping_bytes = mapping_bytes_;
+    count = count_;
+    page_mode = page_mode_;
+    return true;
+  }
+
+  element_t*  elements = nullptr;
+  void*       mapping = nullptr;
+  size_t      mapping_bytes = 0u;
+  size_t      count = 0u;
+  page_mode_t page_mode = PAGE_MODE_SMALL;
+};
@@ -0,0 +1,334 @@
+// PERF COUNTERS:
+//
+// Shared by SHOT1 & SHOT2.
+// Frame time says how long something took, not why. The CPU's own performance counters say whether it was
+// waiting on memory (cache misses) or on mispredicted branches, or just had a lot of instructions to get through.
+// These are read with Linux's perf_event_open, around named zones of the frame:
+//   task clock    | CPU time, in nanoseconds (a software counter, so it is there even when the hardware ones are not)
+//   cycles        | core clock cycles
+//   instructions  | instructions retired, instructions / cycles is the IPC
+//   L1D misses    | level 1 data cache read misses
+//   LLC misses    | last level cache misses, i.e. trips to DRAM
+//   branch misses | mispredicted branches
+// Each counter is opened on its own, so any the CPU, VM or kernel (see /proc/sys/kernel/perf_event_paranoid) won't give are
+// just reported as n/a. Only user space is counted.
+//
+// The counters are opened by the thread that calls perf_profile_t::open and inherited by every thread it, or its threads, start
+// from then on, and a read sums them all. So a zone counts the work of every thread while it is open, not just its own thread's:
+// SHOT2's workers are all inside its "update" zone, but with PARTICLE_PIPELINED the simulation overlaps render
+// and is split between the "update" & "render" zones. Zones must all be on the thread that opened the counters.
+//
+// Each zone is given an entity count (particles, tiles) so its counts can also be reported per entity,
+// e.g. LLC misses per particle. perf_profile_t::end_frame logs the last REPORT_FRAMES frames' rates through the telemetry log,
+// and perf_profile_t::report gives the rates over the whole run.
+//
+// Linux only, elsewhere nothing can be opened and every zone is a no-op.
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include "telemetry_log.h"             // for TELEMETRY_LOG
+
+#include <cstdint>                     // for uint64_t
+#include <cstdio>                      // for std::snprintf
+#include <cstring>                     // for std::memset, std::strcmp, std::strcat
+
+#if defined (__linux__)
+#define PERF_COUNTERS_USE_PERF_EVENT 1
+#include <linux/perf_event.h>          // for perf_event_attr, PERF_*
+#include <sys/syscall.h>               // for SYS_perf_event_open
+#include <unistd.h>                    // for syscall, read, close
+#else
+#define PERF_COUNTERS_USE_PERF_EVENT 0
+#endif
+
+
+enum perf_counter_t
+{
+  PERF_COUNTER_TASK_CLOCK,
+  PERF_COUNTER_CYCLES,
+  PERF_COUNTER_INSTRUCTIONS,
+  PERF_COUNTER_L1D_MISSES,
+  PERF_COUNTER_LLC_MISSES,
+  PERF_COUNTER_BRANCH_MISSES,
+  NUM_PERF_COUNTERS,
+};
+
+inline char const* perf_counter_name (perf_counter_t counter)
+{
+  switch (counter)
+  {
+  case PERF_COUNTER_TASK_CLOCK:    return "task ns";
+  case PERF_COUNTER_CYCLES:        return "cycles";
+  case PERF_COUNTER_INSTRUCTIONS:  return "instructions";
+  case PERF_COUNTER_L1D_MISSES:    return "L1D misses";
+  case PERF_COUNTER_LLC_MISSES:    return "LLC misses";
+  case PERF_COUNTER_BRANCH_MISSES: return "branch misses";
+  case NUM_PERF_COUNTERS:          break;
+  }
+  return "?";
+}
+
+/// @brief every counter's value at one moment, scaled up if the kernel had to share the hardware counters between events
+struct perf_sample_t
+{
+  double values [NUM_PERF_COUNTERS] = {};
+};
+
+/// @brief a named zone's totals, see 'PERF COUNTERS' above
+struct perf_zone_stats_t
+{
+  char const*        name = nullptr;
+  unsigned long long num_calls = 0u;
+  unsigned long long num_entities = 0u;
+  double             totals [NUM_PERF_COUNTERS] = {};
+};
+
+/// @brief the counters & every zone's totals
+class perf_profile_t
+{
+public:
+  static unsigned const MAX_ZONES = 16u;
+  static unsigned const REPORT_FRAMES = 120u;
+
+  ~perf_profile_t (void) { close (); }
+
+  /// @brief open every counter that is available, counting this thread and every thread started from now on
+  /// @return false if none could be opened
+  bool open (void)
+  {
+    close ();
+#if PERF_COUNTERS_USE_PERF_EVENT
+    struct { uint32_t type; uint64_t config; } const events [NUM_PERF_COUNTERS] =
+    {
+      { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8u) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16u) },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    };
+    for (unsigned i = 0u; i < NUM_PERF_COUNTERS; ++i)
+    {
+      perf_event_attr attributes;
+      std::memset (&attributes, 0, sizeof (attributes));
+      attributes.size = sizeof (attributes);
+      attributes.type = events [i].type;
+      attributes.config = events [i].config;
+      attributes.exclude_kernel = 1u;
+      attributes.exclude_hv = 1u;
+      attributes.inherit = 1u;
+      attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds [i] = (int)syscall (SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+      is_open |= fds [i] >= 0;
+    }
+#endif
+    return is_open;
+  }
+
+  void close (void)
+  {
+#if PERF_COUNTERS_USE_PERF_EVENT
+    for (int& fd : fds)
+    {
+      if (fd >= 0)
+      {
+        ::close (fd);
+      }
+      fd = -1;
+    }
+#endif
+    is_open = false;
+  }
+
+  /// @brief forget every zone's counts so far, e.g. a warm-up's, the counters stay open
+  void clear (void)
+  {
+    for (unsigned i = 0u; i < num_zones; ++i)
+    {
+      zones [i] = { zones [i].name };
+      window_zones [i] = { zones [i].name };
+    }
+    num_frames = 0u;
+    num_window_frames = 0u;
+  }
+
+  bool is_enabled (void) const { return is_open; }
+  bool is_available (perf_counter_t counter) const { return fds [counter] >= 0; }
+
+  /// @brief read every counter
+  perf_sample_t read (void) const
+  {
+    perf_sample_t sample;
+#if PERF_COUNTERS_USE_PERF_EVENT
+    for (unsigned i = 0u; i < NUM_PERF_COUNTERS; ++i)
+    {
+      uint64_t value [3] = {}; // value, time enabled, time running
+      if (fds [i] >= 0 && ::read (fds [i], value, sizeof (value)) == (ssize_t)sizeof (value) && value [2] > 0u)
+      {
+        sample.values [i] = (double)value [0] * ((double)value [1] / (double)value [2]);
+      }
+    }
+#endif
+    return sample;
+  }
+
+  /// @brief add a zone's counts, see perf_zone_t
+  void add (char const* name, perf_sample_t const& begin, perf_sample_t const& end, unsigned long long num_entities)
+  {
+    perf_zone_stats_t* zone = find (name);
+    if (!zone)
+    {
+      return;
+    }
+    for (perf_zone_stats_t* stats : { zone, &window_zones [zone - zones] })
+    {
+      ++stats->num_calls;
+      stats->num_entities += num_entities;
+      for (unsigned i = 0u; i < NUM_PERF_COUNTERS; ++i)
+      {
+        stats->totals [i] += end.values [i] - begin.values [i];
+      }
+    }
+  }
+
+  /// @brief count a frame, every REPORT_FRAMES frames log each zone's rates over those frames
+  void end_frame (void)
+  {
+    if (!is_open)
+    {
+      return;
+    }
+    ++num_frames;
+    if (++num_window_frames < REPORT_FRAMES)
+    {
+      return;
+    }
+    char text [512];
+    for (unsigned i = 0u; i < num_zones; ++i)
+    {
+      format_zone (text, sizeof (text), window_zones [i], num_window_frames);
+      TELEMETRY_LOG (0u, "perf: %s\n", text_copy (i, text));
+      window_zones [i] = { zones [i].name };
+    }
+    num_window_frames = 0u;
+  }
+
+  /// @brief every zone's rates over the whole run, one line each, to 'print'
+  void report (void (*print) (char const* text, void* user_data), void* user_data) const
+  {
+    char text [512];
+    std::snprintf (text, sizeof (text), "perf counters over %llu frames:%s\n", num_frames, is_open ? "" : " unavailable");
+    print (text, user_data);
+    for (unsigned i = 0u; i < num_zones; ++i)
+    {
+      format_zone (text, sizeof (text) - 1u, zones [i], num_frames);
+      std::strcat (text, "\n");
+      print (text, user_data);
+    }
+  }
+
+
+private:
+  perf_zone_stats_t* find (char const* name)
+  {
+    for (unsigned i = 0u; i < num_zones; ++i)
+    {
+      if (zones [i].name == name || std::strcmp (zones [i].name, name) == 0)
+      {
+        return &zones [i];
+      }
+    }
+    if (num_zones == MAX_ZONES)
+    {
+      return nullptr;
+    }
+    zones [num_zones] = { name };
+    window_zones [num_zones] = { name };
+    return &zones [num_zones++];
+  }
+
+  /// @brief "name: per frame ..., per entity ..., IPC"
+  void format_zone (char* text, size_t size, perf_zone_stats_t const& zone, unsigned long long frames) const
+  {
+    double const per_frame = frames ? 1.0 / (double)frames : 0.0;
+    double const per_entity = zone.num_entities ? 1.0 / (double)zone.num_entities : 0.0;
+    int length = std::snprintf (text, size, "%-12s %.0f entities/frame |", zone.name, (double)zone.num_entities * per_frame);
+    for (unsigned i = 0u; i < NUM_PERF_COUNTERS && length > 0 && (size_t)length < size; ++i)
+    {
+      if (is_available ((perf_counter_t)i))
+      {
+        length += std::snprintf (text + length, size - (size_t)length, " %s %.4g/frame %.4g/entity |",
+          perf_counter_name ((perf_counter_t)i), zone.totals [i] * per_frame, zone.totals [i] * per_entity);
+      }
+      else
+      {
+        length += std::snprintf (text + length, size - (size_t)length, " %s n/a |", perf_counter_name ((perf_counter_t)i));
+      }
+    }
+    if (length > 0 && (size_t)length < size && is_available (PERF_COUNTER_CYCLES) && is_available (PERF_COUNTER_INSTRUCTIONS)
+      && zone.totals [PERF_COUNTER_CYCLES] > 0.0)
+    {
+      std::snprintf (text + length, size - (size_t)length, " IPC %.2f", zone.totals [PERF_COUNTER_INSTRUCTIONS] / zone.totals [PERF_COUNTER_CYCLES]);
+    }
+  }
+
+  /// @brief the telemetry log only records pointers for %s, so each zone's window line is kept here until it is written out
+  /// (a window is REPORT_FRAMES frames long, far longer than the drain thread takes to catch up)
+  char const* text_copy (unsigned zone, char const* text)
+  {
+    std::snprintf (window_text [zone], sizeof (window_text [zone]), "%s", text);
+    return window_text [zone];
+  }
+
+  int fds [NUM_PERF_COUNTERS] = { -1, -1, -1, -1, -1, -1 };
+  bool is_open = false;
+
+  perf_zone_stats_t zones [MAX_ZONES];
+  perf_zone_stats_t window_zones [MAX_ZONES];   // since the last end_frame report
+  char window_text [MAX_ZONES][512] = {};
+  unsigned num_zones = 0u;
+  unsigned long long num_frames = 0u;
+  unsigned num_window_frames = 0u;
+};
+
+/// @brief the process' counters
+inline perf_profile_t perf_profile;
+
+
+/// @brief counts its scope into perf_profile under 'name' (a string literal)
+class perf_zone_t
+{
+public:
+  /// @param num_entities_ see set_entities
+  explicit perf_zone_t (char const* name_, unsigned long long num_entities_ = 0u)
+    : name (name_)
+    , num_entities (num_entities_)
+  {
+    if (perf_profile.is_enabled ())
+    {
+      begin = perf_profile.read ();
+    }
+  }
+
+  ~perf_zone_t (void)
+  {
+    if (perf_profile.is_enabled ())
+    {
+      perf_profile.add (name, begin, perf_profile.read (), num_entities);
+    }
+  }
+
+  /// @brief how many entities (particles, tiles) the zone worked on, for the per entity rates
+  void set_entities (unsigned long long num_entities_) { num_entities = num_entities_; }
+
+  perf_zone_t (perf_zone_t const&) = delete;
+  perf_zone_t& operator= (perf_zone_t const&) = delete;
+
+private:
+  char const*        name;
+  perf_sample_t      begin;
+  unsigned long long num_entities = 0u;
+};
@@ -0,0 +1,158 @@
+// RANDOM NUMBERS:
+//
+// Shared by SHOT1 & SHOT2.
+// A small, fast & explicitly seeded random number generator (xoshiro128+ by D. Blackman & S. Vigna)
+// run as 4 independent lanes side by side, so 4 numbers are made per step with SSE2 where it is available.
+//
+// Each thread should own its own random_t stream (there is no locking and no shared state),
+// and the same seed always gives the same sequence of numbers, so runs are reproducible.
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include <cstddef>                     // for size_t
+#include <cstdint>                     // for uint32_t, uint64_t
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RANDOM_USE_SSE2 1
+#include <emmintrin.h>                 // for __m128i, _mm_*
+#else
+#define RANDOM_USE_SSE2 0
+#endif
+
+
+/// @brief one random number stream, 4 xoshiro128+ lanes
+struct random_t
+{
+  alignas (16) uint32_t state [4][4] = {}; // [state word][lane]
+
+  alignas (16) uint32_t buffer [4] = {};   // numbers made by the last step, handed out one at a time
+  unsigned num_buffered = 0u;
+};
+
+
+/// @brief splitmix64, used to spread a single seed over all of the xoshiro state
+inline uint64_t random_splitmix64 (uint64_t& x)
+{
+  uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27u)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31u);
+}
+
+/// @brief (re)start a stream
+/// @param seed the same seed always gives the same sequence
+/// @param stream_index use a different index for each thread sharing a seed, to give each one its own sequence
+inline void random_seed (random_t& random, uint64_t seed, uint64_t stream_index = 0u)
+{
+  uint64_t x = seed ^ (stream_index * 0xd1b54a32d192ed03ull);
+  for (unsigned lane = 0u; lane < 4u; ++lane)
+  {
+    uint64_t const a = random_splitmix64 (x);
+    uint64_t const b = random_splitmix64 (x);
+    random.state [0][lane] = (uint32_t)a;
+    random.state [1][lane] = (uint32_t)(a >> 32u);
+    random.state [2][lane] = (uint32_t)b;
+    random.state [3][lane] = (uint32_t)(b >> 32u) | 1u; // the state must never be all zero
+  }
+  random.num_buffered = 0u;
+}
+
+/// @brief advance all 4 lanes, writing one number per lane to 'out'
+inline void random_step (random_t& random, uint32_t out [4])
+{
+#if RANDOM_USE_SSE2
+  __m128i s0 = _mm_load_si128 ((__m128i const*)random.state [0]);
+  __m128i s1 = _mm_load_si128 ((__m128i const*)random.state [1]);
+  __m128i s2 = _mm_load_si128 ((__m128i const*)random.state [2]);
+  __m128i s3 = _mm_load_si128 ((__m128i const*)random.state [3]);
+
+  _mm_storeu_si128 ((__m128i*)out, _mm_add_epi32 (s0, s3));
+
+  __m128i const t = _mm_slli_epi32 (s1, 9);
+  s2 = _mm_xor_si128 (s2, s0);
+  s3 = _mm_xor_si128 (s3, s1);
+  s1 = _mm_xor_si128 (s1, s2);
+  s0 = _mm_xor_si128 (s0, s3);
+  s2 = _mm_xor_si128 (s2, t);
+  s3 = _mm_or_si128 (_mm_slli_epi32 (s3, 11), _mm_srli_epi32 (s3, 21)); // rotl (s3, 11)
+
+  _mm_store_si128 ((__m128i*)random.state [0], s0);
+  _mm_store_si128 ((__m128i*)random.state [1], s1);
+  _mm_store_si128 ((__m128i*)random.state [2], s2);
+  _mm_store_si128 ((__m128i*)random.state [3], s3);
+#else
+  for (unsigned lane = 0u; lane < 4u; ++lane)
+  {
+    uint32_t& s0 = random.state [0][lane];
+    uint32_t& s1 = random.state [1][lane];
+    uint32_t& s2 = random.state [2][lane];
+    uint32_t& s3 = random.state [3][lane];
+
+    out [lane] = s0 + s3;
+
+    uint32_t const t = s1 << 9u;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = (s3 << 11u) | (s3 >> 21u);
+  }
+#endif
+}
+
+/// @brief next 32 random bits from the stream
+inline uint32_t random_next (random_t& random)
+{
+  if (random.num_buffered == 0u)
+  {
+    random_step (random, random.buffer);
+    random.num_buffered = 4u;
+  }
+  return random.buffer [--random.num_buffered];
+}
+
+/// @brief random number between min and max, [min, max)
+/// (only the top 24 bits are used, that is all a float can hold)
+inline float random_getf (random_t& random, float min, float max)
+{
+  float const unit = (float)(random_next (random) >> 8u) * (1.f / 16777216.f);
+  return min + (max - min) * unit;
+}
+
+/// @brief random number between min and max, [min, max)
+inline double random_getd (random_t& random, double min, double max)
+{
+  uint64_t const bits = ((uint64_t)random_next (random) << 32u) | random_next (random);
+  double const unit = (double)(bits >> 11u) * (1.0 / 9007199254740992.0);
+  return min + (max - min) * unit;
+}
+
+/// @brief fill out [0, count) with random numbers between min and max, [min, max)
+/// the bulk path: 4 numbers per step, converted to floats 4 at a time
+inline void random_fill_uniform (random_t& random, float* out, size_t count, float min, float max)
+{
+  float const range = max - min;
+  size_t i = 0u;
+
+#if RANDOM_USE_SSE2
+  __m128 const min4 = _mm_set1_ps (min);
+  __m128 const scale4 = _mm_set1_ps (range * (1.f / 16777216.f));
+  for (; i + 4u <= count; i += 4u)
+  {
+    alignas (16) uint32_t bits [4];
+    random_step (random, bits);
+    __m128i const top = _mm_srli_epi32 (_mm_load_si128 ((__m128i const*)bits), 8);
+    __m128 const value = _mm_add_ps (min4, _mm_mul_ps (_mm_cvtepi32_ps (top), scale4));
+    _mm_storeu_ps (out + i, value);
+  }
+#endif
+
+  for (; i < count; ++i)
+  {
+    out [i] = min + range * ((float)(random_next (random) >> 8u) * (1.f / 16777216.f));
+  }
+}
@@ -0,0 +1,305 @@
+// TELEMETRY LOG:
+//
+// Shared by SHOT1 & SHOT2.
+// Printing to the console every frame puts console I/O (and its locks) on the game loop's, and the workers', hot path.
+// Instead, TELEMETRY_LOG only copies its format string & arguments into a fixed size binary record in a lock-free ring,
+// and a background thread formats the records & writes them out (to a sink chosen by telemetry_log_t::start),
+// so logging never waits on I/O, a lock or another thread:
+//   - any number of threads can log at once, each record slot is claimed with a single compare & swap
+//     and handed to the drain thread by its sequence number (a bounded multi producer, single consumer queue)
+//   - when the ring is full the record is dropped & counted, rather than waiting for room
+//   - each call site can be rate limited, the records it skips are counted & reported with its next record
+// The format string must be a string literal, and so must any %s argument, only their addresses are recorded.
+// Records logged before start or after stop are dropped.
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include <atomic>                      // for std::atomic
+#include <chrono>                      // for std::chrono::steady_clock
+#include <cstddef>                     // for size_t
+#include <cstdint>                     // for uint64_t, int64_t
+#include <cstdio>                      // for std::snprintf, std::fputs, FILE
+#include <cstring>                     // for std::memcpy
+#include <memory>                      // for std::unique_ptr
+#include <thread>                      // for std::thread, std::this_thread::sleep_for
+#include <type_traits>                 // for std::is_floating_point_v, std::is_signed_v, ...
+#include <utility>                     // for std::index_sequence
+
+
+/// @brief one logged argument, widened to 8 bytes
+union telemetry_arg_t
+{
+  long long          i;
+  unsigned long long u;
+  double             d;
+  void const*        p;
+};
+
+/// @brief widen an argument for the record
+template <typename arg_t>
+telemetry_arg_t telemetry_arg_pack (arg_t arg)
+{
+  static_assert (std::is_arithmetic_v <arg_t> || std::is_pointer_v <arg_t> || std::is_enum_v <arg_t>,
+    "only numbers, enums & pointers (to string literals, for %s) can be logged");
+  telemetry_arg_t packed = {};
+  if constexpr (std::is_floating_point_v <arg_t>)
+  {
+    packed.d = (double)arg;
+  }
+  else if constexpr (std::is_pointer_v <arg_t>)
+  {
+    packed.p = (void const*)arg;
+  }
+  else if constexpr (std::is_signed_v <arg_t>)
+  {
+    packed.i = (long long)arg;
+  }
+  else
+  {
+    packed.u = (unsigned long long)arg;
+  }
+  return packed;
+}
+
+/// @brief narrow an argument back to the type it was logged as
+template <typename arg_t>
+arg_t telemetry_arg_unpack (telemetry_arg_t packed)
+{
+  if constexpr (std::is_floating_point_v <arg_t>)
+  {
+    return (arg_t)packed.d;
+  }
+  else if constexpr (std::is_pointer_v <arg_t>)
+  {
+    return (arg_t)packed.p;
+  }
+  else if constexpr (std::is_signed_v <arg_t>)
+  {
+    return (arg_t)packed.i;
+  }
+  else
+  {
+    return (arg_t)packed.u;
+  }
+}
+
+/// @brief a TELEMETRY_LOG call site, see 'TELEMETRY LOG' above
+struct telemetry_site_t
+{
+  unsigned long long            interval_ns = 0u;  // the least time between 2 records, 0 for every call
+  std::atomic <unsigned long long> next_ns { 0u }; // when the next record may be logged
+  std::atomic <unsigned>        num_suppressed { 0u };
+};
+
+/// @brief see 'TELEMETRY LOG' above
+class telemetry_log_t
+{
+public:
+  static unsigned const NUM_RECORDS = 4096u; // a power of 2
+  static unsigned const MAX_ARGS = 11u;
+  static size_t const MAX_LINE = 512u;
+
+  /// @brief where formatted lines go, called from the drain thread only
+  using sink_t = void (*) (char const* text, void* user_data);
+
+  /// @brief a sink that writes to a FILE*, passed as the user data
+  static void file_sink (char const* text, void* user_data)
+  {
+    std::fputs (text, (FILE*)user_data);
+  }
+
+  ~telemetry_log_t (void) { stop (); }
+
+  /// @brief start the drain thread, records are accepted from now on
+  void start (sink_t sink_, void* sink_user_data_)
+  {
+    stop ();
+    if (!records)
+    {
+      records.reset (new record_t [NUM_RECORDS]);
+    }
+    for (unsigned i = 0u; i < NUM_RECORDS; ++i)
+    {
+      records [i].sequence.store (i, std::memory_order_relaxed);
+    }
+    tail.store (0u, std::memory_order_relaxed);
+    head = 0u;
+    sink = sink_;
+    sink_user_data = sink_user_data_;
+    is_draining.store (true, std::memory_order_relaxed);
+    is_accepting.store (true, std::memory_order_release);
+    drain_thread = std::thread (&telemetry_log_t::drain, this);
+  }
+
+  /// @brief stop accepting records, write out every record already logged & stop the drain thread
+  void stop (void)
+  {
+    is_accepting.store (false, std::memory_order_release);
+    if (drain_thread.joinable ())
+    {
+      is_draining.store (false, std::memory_order_release);
+      drain_thread.join ();
+    }
+  }
+
+  /// @brief copy a record into the ring, never blocks, see TELEMETRY_LOG
+  /// @return false if the record was rate limited, dropped or the log is not running
+  template <typename... args_t>
+  bool push (telemetry_site_t& site, char const* format, args_t... args)
+  {
+    static_assert (sizeof... (args_t) <= MAX_ARGS, "too many arguments for a telemetry record");
+    if (!is_accepting.load (std::memory_order_acquire))
+    {
+      return false;
+    }
+
+    if (site.interval_ns > 0u)
+    {
+      unsigned long long const time_ns = now_ns ();
+      unsigned long long next = site.next_ns.load (std::memory_order_relaxed);
+      if (time_ns < next || !site.next_ns.compare_exchange_strong (next, time_ns + site.interval_ns, std::memory_order_relaxed))
+      {
+        site.num_suppressed.fetch_add (1u, std::memory_order_relaxed);
+        return false;
+      }
+    }
+
+    // claim the slot at the tail
+    uint64_t position = tail.load (std::memory_order_relaxed);
+    record_t* record = nullptr;
+    for (;;)
+    {
+      record = &records [position & (NUM_RECORDS - 1u)];
+      int64_t const lag = (int64_t)(record->sequence.load (std::memory_order_acquire) - position);
+      if (lag == 0)
+      {
+        if (tail.compare_exchange_weak (position, position + 1u, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (lag < 0)
+      {
+        num_dropped.fetch_add (1u, std::memory_order_relaxed); // full, the drain thread is a whole ring behind
+        return false;
+      }
+      else
+      {
+        position = tail.load (std::memory_order_relaxed); // another thread claimed it first
+      }
+    }
+
+    record->format = &format_record <args_t...>;
+    record->format_string = format;
+    record->num_suppressed = site.num_suppressed.exchange (0u, std::memory_order_relaxed);
+    telemetry_arg_t const packed [sizeof... (args_t) + 1u] = { telemetry_arg_pack (args)..., {} };
+    std::memcpy (record->args, packed, sizeof... (args_t) * sizeof (telemetry_arg_t));
+
+    // publish it to the drain thread
+    record->sequence.store (position + 1u, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief records lost because the ring was full
+  unsigned long long get_num_dropped (void) const { return num_dropped.load (std::memory_order_relaxed); }
+
+  /// @brief records written out so far
+  unsigned long long get_num_written (void) const { return num_written.load (std::memory_order_relaxed); }
+
+
+private:
+  struct alignas (64) record_t
+  {
+    std::atomic <uint64_t> sequence { 0u };      // == position + 1 once written, == position + NUM_RECORDS once drained
+    void (*format) (char* text, size_t size, char const* format, telemetry_arg_t const* args) = nullptr;
+    char const*            format_string = nullptr;
+    unsigned               num_suppressed = 0u;
+    telemetry_arg_t        args [MAX_ARGS];
+  };
+
+  template <typename... args_t, size_t... indices>
+  static void format_args (char* text, size_t size, char const* format, telemetry_arg_t const* args, std::index_sequence <indices...>)
+  {
+    (void)args;
+    std::snprintf (text, size, format, telemetry_arg_unpack <args_t> (args [indices])...);
+  }
+
+  template <typename... args_t>
+  static void format_record (char* text, size_t size, char const* format, telemetry_arg_t const* args)
+  {
+    format_args <args_t...> (text, size, format, args, std::index_sequence_for <args_t...> {});
+  }
+
+  static unsigned long long now_ns (void)
+  {
+    return (unsigned long long)std::chrono::duration_cast <std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+  }
+
+  /// @brief the drain thread: format & write out records in the order they were claimed, until stopped & empty
+  void drain (void)
+  {
+    char text [MAX_LINE];
+    for (;;)
+    {
+      bool const is_last_pass = !is_draining.load (std::memory_order_acquire);
+      unsigned num_drained = 0u;
+      for (;;)
+      {
+        record_t& record = records [head & (NUM_RECORDS - 1u)];
+        if (record.sequence.load (std::memory_order_acquire) != head + 1u)
+        {
+          break;
+        }
+        if (record.num_suppressed > 0u)
+        {
+          std::snprintf (text, sizeof (text), "(%u similar suppressed) ", record.num_suppressed);
+          sink (text, sink_user_data);
+        }
+        record.format (text, sizeof (text), record.format_string, record.args);
+        sink (text, sink_user_data);
+
+        record.sequence.store (head + NUM_RECORDS, std::memory_order_release);
+        ++head;
+        ++num_drained;
+      }
+      num_written.fetch_add (num_drained, std::memory_order_relaxed);
+
+      if (is_last_pass)
+      {
+        break;
+      }
+      if (num_drained == 0u)
+      {
+        std::this_thread::sleep_for (std::chrono::milliseconds (1));
+      }
+    }
+  }
+
+  std::unique_ptr <record_t []> records;
+  alignas (64) std::atomic <uint64_t> tail { 0u };   // next position to claim, shared by the producers
+  alignas (64) uint64_t head = 0u;                    // next position to drain, drain thread only
+
+  std::atomic <bool> is_accepting { false };
+  std::atomic <bool> is_draining { false };
+  std::thread        drain_thread;
+  sink_t             sink = nullptr;
+  void*              sink_user_data = nullptr;
+
+  std::atomic <unsigned long long> num_dropped { 0u };
+  std::atomic <unsigned long long> num_written { 0u };
+};
+
+/// @brief the process' telemetry log
+inline telemetry_log_t telemetry_log;
+
+/// @brief log a line through the telemetry log, at most once every interval_ms milliseconds from this call site
+/// e.g. TELEMETRY_LOG (0u, "frame : %.5f seconds\n", elapsed_seconds);
+#define TELEMETRY_LOG(interval_ms, ...)                                                                      \
+  do                                                                                                         \
+  {                                                                                                          \
+    static telemetry_site_t telemetry_site_ { (unsigned long long)(interval_ms) * 1000000ull };              \
+    telemetry_log.push (telemetry_site_, __VA_ARGS__);                                                       \
+  } while (false)
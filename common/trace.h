@@ -0,0 +1,220 @@
+// TRACE:
+//
+// Shared by SHOT1 & SHOT2.
+// A timeline of what every thread was doing, for spotting stragglers, serialisation & idle gaps between threads,
+// written out as Chrome trace-event JSON that chrome://tracing & https://ui.perfetto.dev can load.
+//
+// TRACE_ZONE ("name") records a begin & end time for the rest of its scope, as one event:
+//   - recording is off until trace_start, when off a zone costs a single relaxed atomic load
+//   - events go to per-thread buffers: each thread claims a run of TRACE_CHUNK_EVENTS slots from one preallocated pool
+//     with a single atomic add, and fills it with no further synchronisation, so threads never contend per event
+//   - the pool is fixed in size, once it is used up further events are counted as dropped
+//   - the zone name must be a string literal, only its address is recorded
+// Threads are shown on lanes rather than by OS thread, so each of SHOT2's workers stays on the same, named, row:
+// trace_set_lane names the calling thread's lane (TRACE_LANE_*, plus a worker index), threads that never set one go on the main lane.
+// trace_write must only be called once every traced thread has finished (joined, or idle in a worker pool, see common/worker_pool.h).
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include "page_buffer.h"               // for page_buffer_t, PAGE_MODE_SMALL
+
+#include <atomic>                      // for std::atomic
+#include <chrono>                      // for std::chrono::steady_clock
+#include <cstdio>                      // for std::fopen, std::fprintf, std::fclose
+#include <cstdint>                     // for uint64_t
+
+
+// the lanes each kind of thread is drawn on
+static unsigned const TRACE_LANE_MAIN = 0u;
+static unsigned const TRACE_LANE_UPDATE = 1u;    // SHOT2's pipelined update thread
+static unsigned const TRACE_LANE_WORKER = 16u;   // + worker index
+static unsigned const TRACE_LANE_RASTER = 80u;   // + worker index, the headless software rasteriser's workers
+static unsigned const TRACE_MAX_LANES = 128u;
+
+static unsigned const TRACE_CHUNK_EVENTS = 16u;  // slots a thread claims from the pool at a time
+
+
+/// @brief a complete event: name, lane & start / duration in nanoseconds since trace_start
+struct trace_event_t
+{
+  char const* name;
+  uint64_t    begin_ns;
+  uint64_t    duration_ns;
+  unsigned    lane;
+};
+
+/// @brief shared state of the trace, see 'TRACE' above
+struct trace_state_t
+{
+  std::atomic <bool>     is_recording { false };
+  std::atomic <unsigned> generation { 0u };          // bumped by every trace_start, so threads drop chunks from an old trace
+  std::atomic <uint64_t> next_event { 0u };          // next unclaimed slot of the pool
+  std::atomic <uint64_t> num_dropped { 0u };
+  page_buffer_t <trace_event_t> events;              // the pool, slots never written stay zeroed (null name)
+  std::chrono::steady_clock::time_point start_time;
+  std::atomic <char const*> lane_names [TRACE_MAX_LANES] = {};
+};
+
+/// @brief a thread's current chunk of the pool
+struct trace_thread_t
+{
+  uint64_t next = 0u;
+  uint64_t end = 0u;
+  unsigned generation = ~0u;
+  unsigned lane = TRACE_LANE_MAIN;
+};
+
+inline trace_state_t trace_state;
+inline thread_local trace_thread_t trace_thread;
+
+
+inline bool trace_is_recording (void)
+{
+  return trace_state.is_recording.load (std::memory_order_relaxed);
+}
+
+inline uint64_t trace_now_ns (void)
+{
+  return (uint64_t)std::chrono::duration_cast <std::chrono::nanoseconds> (std::chrono::steady_clock::now () - trace_state.start_time).count ();
+}
+
+/// @brief start recording, into a pool of 'capacity' events (32 bytes each), any earlier trace is discarded
+/// @return false if the pool could not be allocated
+inline bool trace_start (size_t capacity)
+{
+  trace_state.is_recording.store (false, std::memory_order_relaxed);
+  // small pages, as only the pages actually written are ever touched
+  if (!trace_state.events.allocate (capacity, PAGE_MODE_SMALL))
+  {
+    return false;
+  }
+  trace_state.next_event.store (0u, std::memory_order_relaxed);
+  trace_state.num_dropped.store (0u, std::memory_order_relaxed);
+  trace_state.start_time = std::chrono::steady_clock::now ();
+  trace_state.generation.fetch_add (1u, std::memory_order_relaxed);
+  trace_state.is_recording.store (true, std::memory_order_release);
+  return true;
+}
+
+/// @brief stop recording, events already recorded are kept for trace_write
+inline void trace_stop (void)
+{
+  trace_state.is_recording.store (false, std::memory_order_relaxed);
+}
+
+/// @brief put the calling thread on a lane, e.g. trace_set_lane (TRACE_LANE_WORKER + i, "worker")
+/// @param name a string literal, shown with the lane number, the first name given to a lane is kept
+inline void trace_set_lane (unsigned lane, char const* name)
+{
+  lane = lane < TRACE_MAX_LANES ? lane : TRACE_MAX_LANES - 1u;
+  trace_thread.lane = lane;
+  char const* expected = nullptr;
+  trace_state.lane_names [lane].compare_exchange_strong (expected, name, std::memory_order_relaxed);
+}
+
+/// @brief record a complete event on the calling thread's lane
+inline void trace_record (char const* name, uint64_t begin_ns, uint64_t end_ns)
+{
+  trace_thread_t& thread = trace_thread;
+  unsigned const generation = trace_state.generation.load (std::memory_order_relaxed);
+  if (thread.next == thread.end || thread.generation != generation)
+  {
+    uint64_t const first = trace_state.next_event.fetch_add (TRACE_CHUNK_EVENTS, std::memory_order_relaxed);
+    if (first + TRACE_CHUNK_EVENTS > trace_state.events.size ())
+    {
+      trace_state.num_dropped.fetch_add (1u, std::memory_order_relaxed);
+      thread.next = thread.end = 0u;
+      return;
+    }
+    thread.next = first;
+    thread.end = first + TRACE_CHUNK_EVENTS;
+    thread.generation = generation;
+  }
+  trace_state.events [thread.next++] = { name, begin_ns, end_ns - begin_ns, thread.lane };
+}
+
+/// @brief the number of events recorded & dropped so far
+inline uint64_t trace_num_recorded (void)
+{
+  uint64_t num_recorded = 0u;
+  uint64_t const claimed = trace_state.next_event.load (std::memory_order_relaxed);
+  for (uint64_t i = 0u; i < claimed && i < trace_state.events.size (); ++i)
+  {
+    num_recorded += trace_state.events [i].name ? 1u : 0u;
+  }
+  return num_recorded;
+}
+inline uint64_t trace_num_dropped (void) { return trace_state.num_dropped.load (std::memory_order_relaxed); }
+
+/// @brief write every recorded event to 'path' as trace-event JSON
+/// @param process_name shown as the process' name
+/// @return false if the file could not be written
+inline bool trace_write (char const* path, char const* process_name)
+{
+  FILE* file = std::fopen (path, "w");
+  if (!file)
+  {
+    return false;
+  }
+
+  std::fprintf (file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  std::fprintf (file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"%s\"}}", process_name);
+  for (unsigned lane = 0u; lane < TRACE_MAX_LANES; ++lane)
+  {
+    if (char const* name = trace_state.lane_names [lane].load (std::memory_order_relaxed))
+    {
+      std::fprintf (file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s (lane %u)\"}}", lane, name, lane);
+      std::fprintf (file, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"sort_index\":%u}}", lane, lane);
+    }
+  }
+
+  // timestamps are in microseconds
+  uint64_t const claimed = trace_state.next_event.load (std::memory_order_relaxed);
+  for (uint64_t i = 0u; i < claimed && i < trace_state.events.size (); ++i)
+  {
+    trace_event_t const& event = trace_state.events [i];
+    if (event.name)
+    {
+      std::fprintf (file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+        event.name, event.lane, (double)event.begin_ns * 1e-3, (double)event.duration_ns * 1e-3);
+    }
+  }
+  std::fprintf (file, "\n]}\n");
+  return std::fclose (file) == 0;
+}
+
+
+/// @brief records its scope as an event, see TRACE_ZONE
+class trace_zone_t
+{
+public:
+  explicit trace_zone_t (char const* name_)
+    : name (trace_is_recording () ? name_ : nullptr)
+    , begin_ns (name ? trace_now_ns () : 0u)
+  {
+  }
+
+  ~trace_zone_t (void)
+  {
+    if (name && trace_is_recording ())
+    {
+      trace_record (name, begin_ns, trace_now_ns ());
+    }
+  }
+
+  trace_zone_t (trace_zone_t const&) = delete;
+  trace_zone_t& operator= (trace_zone_t const&) = delete;
+
+private:
+  char const* name;
+  uint64_t    begin_ns;
+};
+
+#define TRACE_CONCATENATE_(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_ (a, b)
+
+/// @brief record the rest of the enclosing scope as an event called 'name' (a string literal)
+#define TRACE_ZONE(name) trace_zone_t const TRACE_CONCATENATE (trace_zone_, __LINE__) (name)
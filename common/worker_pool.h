@@ -0,0 +1,154 @@
+// WORKER POOL:
+//
+// Shared by SHOT2 & the headless tools.
+// Starting a std::thread per worker, per phase, every frame costs a heap allocation & a thread creation each time,
+// so the workers are started once instead, and each phase only hands them a task & waits for it:
+//   - run (num_tasks, task) wakes workers 0 .. num_tasks-1, each calls task (worker index), and returns when all have
+//   - start & wait do the same in 2 halves, so the caller can get on with something else in between
+//   - worker i always runs task i, on the same thread, so per worker state (random streams, trace lanes) stays put
+//   - the task is copied into the pool's own storage, it must be small & trivially copyable (e.g. a lambda capturing
+//     a few references), so handing out work never allocates
+// The workers sleep on a condition variable between tasks, rather than spinning, as there may be fewer cores than workers.
+// Tasks must not start work on the pool that is running them.
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include "trace.h"                     // for trace_set_lane
+
+#include <condition_variable>          // for std::condition_variable
+#include <cstddef>                     // for size_t, std::max_align_t
+#include <mutex>                       // for std::mutex, std::unique_lock
+#include <new>                         // for placement new
+#include <thread>                      // for std::thread
+#include <type_traits>                 // for std::is_trivially_copyable_v, std::is_trivially_destructible_v
+#include <vector>                      // for std::vector
+
+
+/// @brief see 'WORKER POOL' above
+class worker_pool_t
+{
+public:
+  static size_t const MAX_TASK_BYTES = 64u;
+
+  ~worker_pool_t (void) { release (); }
+
+  /// @brief start the workers, any already started are stopped first
+  /// @param first_lane, lane_name the trace lane of worker 0, worker i is on first_lane + i (see common/trace.h)
+  void initialise (unsigned num_workers, unsigned first_lane, char const* lane_name)
+  {
+    release ();
+    threads.reserve (num_workers);
+    for (unsigned i = 0u; i < num_workers; ++i)
+    {
+      threads.emplace_back (&worker_pool_t::work, this, i, first_lane + i, lane_name);
+    }
+  }
+
+  /// @brief wait for the current task, then stop & join the workers
+  void release (void)
+  {
+    wait ();
+    {
+      std::unique_lock <std::mutex> lock (mutex);
+      is_stopping = true;
+    }
+    wake.notify_all ();
+    for (std::thread& t : threads)
+    {
+      t.join ();
+    }
+    threads.clear ();
+    threads.shrink_to_fit ();
+    is_stopping = false;
+  }
+
+  unsigned get_num_workers (void) const { return (unsigned)threads.size (); }
+
+  /// @brief have workers 0 .. num_tasks-1 each call task (worker index), and wait for them all to return
+  template <typename task_t>
+  void run (unsigned num_tasks, task_t const& task)
+  {
+    start (num_tasks, task);
+    wait ();
+  }
+
+  /// @brief as run, but returns as soon as the workers have been woken, see wait
+  /// waits for the previous task first, if it is still running
+  template <typename task_t>
+  void start (unsigned num_tasks, task_t const& task)
+  {
+    static_assert (sizeof (task_t) <= MAX_TASK_BYTES && alignof (task_t) <= alignof (std::max_align_t), "the task is too big for the pool");
+    static_assert (std::is_trivially_copyable_v <task_t> && std::is_trivially_destructible_v <task_t>, "the task must be trivially copyable");
+
+    wait ();
+    num_tasks = num_tasks < get_num_workers () ? num_tasks : get_num_workers ();
+    if (num_tasks == 0u)
+    {
+      return;
+    }
+    {
+      std::unique_lock <std::mutex> lock (mutex);
+      new (task_storage) task_t (task);
+      invoke = [] (void const* storage, unsigned worker) { (*(task_t const*)storage) (worker); };
+      num_active = num_tasks;
+      num_pending = num_tasks;
+      ++generation;
+    }
+    wake.notify_all ();
+  }
+
+  /// @brief wait for the task given to start (or run) to finish on every worker it was given to
+  void wait (void)
+  {
+    std::unique_lock <std::mutex> lock (mutex);
+    done.wait (lock, [this] () { return num_pending == 0u; });
+  }
+
+
+private:
+  void work (unsigned worker, unsigned lane, char const* lane_name)
+  {
+    trace_set_lane (lane, lane_name);
+
+    unsigned long long seen = 0u;
+    std::unique_lock <std::mutex> lock (mutex);
+    for (;;)
+    {
+      wake.wait (lock, [this, seen] () { return is_stopping || generation != seen; });
+      if (is_stopping)
+      {
+        return;
+      }
+      seen = generation;
+      if (worker >= num_active)
+      {
+        continue;
+      }
+
+      lock.unlock ();
+      invoke (task_storage, worker);
+      lock.lock ();
+
+      if (--num_pending == 0u)
+      {
+        done.notify_all ();
+      }
+    }
+  }
+
+  std::vector <std::thread> threads;
+
+  std::mutex              mutex;             // guards everything below
+  std::condition_variable wake;              // a new task, or stop
+  std::condition_variable done;              // the last worker given the task has finished it
+  unsigned long long      generation = 0u;   // bumped for every task
+  unsigned                num_active = 0u;   // workers given the current task
+  unsigned                num_pending = 0u;  // of those, how many are still running it
+  bool                    is_stopping = false;
+
+  void (*invoke) (void const* storage, unsigned worker) = nullptr;
+  alignas (std::max_align_t) unsigned char task_storage [MAX_TASK_BYTES];
+};
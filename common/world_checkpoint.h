@@ -0,0 +1,362 @@
+// WORLD CHECKPOINT:
+//
+// Shared by SHOT1 & SHOT2.
+// A binary snapshot of a world, laid out so its arrays can be used straight from the file with no parsing:
+//   offset 0       | world_checkpoint_header_t: magic, format version, byte order, which app & its layout version
+//   offset 64      | world_checkpoint_section_t [num_sections]: id, element size, count, offset & bytes of each array
+//   4 KB boundaries | each array's bytes exactly as they are in memory, zero padded to a whole page
+// - saving is one fwrite per array, straight from the SoA arrays (world_checkpoint_writer_t holds pointers, not copies)
+// - loading maps the whole file (mmap, MAP_PRIVATE) & checks only the header & the section table,
+//   then an array is either copied out with one memcpy (world_checkpoint_t::copy, for fixed size arrays)
+//   or mapped on its own as a page_buffer_t (world_checkpoint_t::map), so a pool of millions of particles
+//   is restored by a single mmap call & its pages are only read in as they are first touched
+// - nothing is constructed per entity & nothing is converted, so a checkpoint only loads into a build with the same
+//   element layouts: every section's element size is checked, and an app bumps its layout version when a layout changes
+// The byte order is checked rather than converted, checkpoints are for restarting & benchmarking, not for archiving.
+// Linux maps the file, elsewhere it is read into memory in one go & map always fails, so callers fall back to copy.
+//
+// Header only, this folder is not a project in its own right.
+
+
+#pragma once
+
+#include <cstddef>                     // for size_t
+#include <cstdint>                     // for uint32_t, uint64_t
+#include <cstdio>                      // for std::fopen, std::fwrite, std::fclose
+#include <cstring>                     // for std::memcpy, std::memcmp
+#include <new>                         // for std::align_val_t, std::nothrow
+#include <type_traits>                 // for std::is_trivially_copyable_v
+#include <vector>                      // for std::vector
+
+#include "page_buffer.h"               // for page_buffer_t
+
+#if defined (__linux__)
+#define WORLD_CHECKPOINT_USE_MMAP 1
+#include <fcntl.h>                     // for open, O_RDONLY
+#include <sys/mman.h>                  // for mmap, munmap
+#include <sys/stat.h>                  // for fstat
+#include <unistd.h>                    // for close
+#else
+#define WORLD_CHECKPOINT_USE_MMAP 0
+#endif
+
+
+static uint32_t const WORLD_CHECKPOINT_VERSION = 1u;
+static uint32_t const WORLD_CHECKPOINT_BYTE_ORDER = 0x01020304u;
+static size_t const WORLD_CHECKPOINT_ALIGNMENT = 4u * 1024u; // every array starts on a page, so it can be mapped on its own
+
+/// @brief a 4 character id, for apps & sections, e.g. WORLD_CHECKPOINT_ID ('T', 'P', 'O', 'S')
+constexpr uint32_t WORLD_CHECKPOINT_ID (char a, char b, char c, char d)
+{
+  return (uint32_t)(unsigned char)a | (uint32_t)(unsigned char)b << 8u | (uint32_t)(unsigned char)c << 16u | (uint32_t)(unsigned char)d << 24u;
+}
+
+
+/// @brief the first 64 bytes of a checkpoint, see 'WORLD CHECKPOINT' above
+struct world_checkpoint_header_t
+{
+  char     magic [8];                  // "SHOTCKPT"
+  uint32_t format_version;             // WORLD_CHECKPOINT_VERSION
+  uint32_t byte_order;                 // WORLD_CHECKPOINT_BYTE_ORDER as written
+  uint32_t app;                        // WORLD_CHECKPOINT_ID of the app that wrote it
+  uint32_t layout_version;             // the app's own, bumped when any of its element layouts change
+  uint32_t num_sections;
+  uint32_t reserved_0;
+  uint64_t file_bytes;
+  uint8_t  reserved [24];
+};
+static_assert (sizeof (world_checkpoint_header_t) == 64u, "the header is 64 bytes, the section table follows it");
+
+/// @brief where one array is in the file
+struct world_checkpoint_section_t
+{
+  uint32_t id;                         // WORLD_CHECKPOINT_ID
+  uint32_t element_bytes;              // sizeof the element as written
+  uint64_t count;
+  uint64_t offset;                     // a multiple of WORLD_CHECKPOINT_ALIGNMENT
+  uint64_t bytes;                      // count * element_bytes, without the padding
+};
+static_assert (sizeof (world_checkpoint_section_t) == 32u, "sections are packed back to back after the header");
+
+
+// WRITE
+
+/// @brief gathers a world's arrays & writes them out as a checkpoint, see 'WORLD CHECKPOINT' above
+/// Only pointers are kept, the arrays must not change until write returns.
+class world_checkpoint_writer_t
+{
+public:
+  template <typename element_t>
+  void add (uint32_t id, element_t const* elements, size_t count)
+  {
+    static_assert (std::is_trivially_copyable_v <element_t>, "only plain data is written, it is read back without construction");
+    sections.push_back ({ { id, (uint32_t)sizeof (element_t), (uint64_t)count, 0u, (uint64_t)(count * sizeof (element_t)) }, elements });
+  }
+
+  /// @return false if the file could not be written
+  bool write (char const* path, uint32_t app, uint32_t layout_version)
+  {
+    world_checkpoint_header_t header = {};
+    std::memcpy (header.magic, "SHOTCKPT", sizeof (header.magic));
+    header.format_version = WORLD_CHECKPOINT_VERSION;
+    header.byte_order = WORLD_CHECKPOINT_BYTE_ORDER;
+    header.app = app;
+    header.layout_version = layout_version;
+    header.num_sections = (uint32_t)sections.size ();
+
+    uint64_t offset = round_up (sizeof (header) + sections.size () * sizeof (world_checkpoint_section_t));
+    for (pending_t& pending : sections)
+    {
+      pending.section.offset = offset;
+      offset += round_up (pending.section.bytes);
+    }
+    header.file_bytes = offset;
+
+    FILE* file = std::fopen (path, "wb");
+    if (!file)
+    {
+      return false;
+    }
+    bool is_written = std::fwrite (&header, sizeof (header), 1u, file) == 1u;
+    uint64_t written = sizeof (header);
+    for (pending_t const& pending : sections)
+    {
+      is_written = is_written && std::fwrite (&pending.section, sizeof (pending.section), 1u, file) == 1u;
+      written += sizeof (pending.section);
+    }
+    for (pending_t const& pending : sections)
+    {
+      is_written = is_written && pad (file, written, pending.section.offset);
+      is_written = is_written && (pending.section.bytes == 0u || std::fwrite (pending.elements, (size_t)pending.section.bytes, 1u, file) == 1u);
+      written += pending.section.bytes;
+    }
+    is_written = is_written && pad (file, written, header.file_bytes);
+    return std::fclose (file) == 0 && is_written;
+  }
+
+
+private:
+  struct pending_t
+  {
+    world_checkpoint_section_t section;
+    void const*                elements;
+  };
+
+  static uint64_t round_up (uint64_t value)
+  {
+    return (value + WORLD_CHECKPOINT_ALIGNMENT - 1u) / WORLD_CHECKPOINT_ALIGNMENT * WORLD_CHECKPOINT_ALIGNMENT;
+  }
+
+  /// @brief write zeroes up to 'offset'
+  static bool pad (FILE* file, uint64_t& written, uint64_t offset)
+  {
+    static unsigned char const zeroes [WORLD_CHECKPOINT_ALIGNMENT] = {};
+    while (written < offset)
+    {
+      size_t const bytes = offset - written < sizeof (zeroes) ? (size_t)(offset - written) : sizeof (zeroes);
+      if (std::fwrite (zeroes, bytes, 1u, file) != 1u)
+      {
+        return false;
+      }
+      written += bytes;
+    }
+    return true;
+  }
+
+  std::vector <pending_t> sections;
+};
+
+
+// READ
+
+/// @brief a checkpoint opened for loading, see 'WORLD CHECKPOINT' above
+class world_checkpoint_t
+{
+public:
+  world_checkpoint_t (void) = default;
+  world_checkpoint_t (world_checkpoint_t const&) = delete;
+  world_checkpoint_t& operator= (world_checkpoint_t const&) = delete;
+  ~world_checkpoint_t (void) { close (); }
+
+  /// @return false if the file could not be read, is not a checkpoint, or was written by another app or layout version
+  bool open (char const* path, uint32_t app, uint32_t layout_version)
+  {
+    close ();
+#if WORLD_CHECKPOINT_USE_MMAP
+    fd = ::open (path, O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat (fd, &status) != 0 || (size_t)status.st_size < sizeof (world_checkpoint_header_t))
+    {
+      close ();
+      return false;
+    }
+    file_bytes = (size_t)status.st_size;
+    void* mapped = mmap (nullptr, file_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+      close ();
+      return false;
+    }
+    bytes = (unsigned char const*)mapped;
+#else
+    FILE* file = std::fopen (path, "rb");
+    long size = -1;
+    if (file && std::fseek (file, 0, SEEK_END) == 0)
+    {
+      size = std::ftell (file);
+      std::rewind (file);
+    }
+    unsigned char* memory = size >= (long)sizeof (world_checkpoint_header_t)
+      ? (unsigned char*)::operator new ((size_t)size, std::align_val_t (WORLD_CHECKPOINT_ALIGNMENT), std::nothrow) : nullptr;
+    file_bytes = memory ? (size_t)size : 0u;
+    bytes = memory;
+    bool const is_read = memory && std::fread (memory, file_bytes, 1u, file) == 1u;
+    if (file)
+    {
+      std::fclose (file);
+    }
+    if (!is_read)
+    {
+      close ();
+      return false;
+    }
+#endif
+    if (!validate (app, layout_version))
+    {
+      close ();
+      return false;
+    }
+    return true;
+  }
+
+  void close (void)
+  {
+#if WORLD_CHECKPOINT_USE_MMAP
+    if (bytes)
+    {
+      munmap ((void*)bytes, file_bytes);
+    }
+    if (fd >= 0)
+    {
+      ::close (fd);
+    }
+    fd = -1;
+#else
+    if (bytes)
+    {
+      ::operator delete ((void*)bytes, std::align_val_t (WORLD_CHECKPOINT_ALIGNMENT));
+    }
+#endif
+    bytes = nullptr;
+    file_bytes = 0u;
+    header = nullptr;
+    sections = nullptr;
+  }
+
+  bool is_open (void) const { return bytes != nullptr; }
+
+  /// @brief a section's elements, read only & straight from the file
+  /// @return null if there is no such section or its elements are not the size of 'element_t', 'count' is then 0
+  template <typename element_t>
+  element_t const* find (uint32_t id, size_t& count) const
+  {
+    world_checkpoint_section_t const* section = find_section (id, sizeof (element_t));
+    count = section ? (size_t)section->count : 0u;
+    return section ? (element_t const*)(bytes + section->offset) : nullptr;
+  }
+
+  /// @brief copy a section into an array of exactly 'count' elements, one memcpy
+  /// @return false if there is no such section, or it does not hold exactly 'count' elements of 'element_t'
+  template <typename element_t>
+  bool copy (uint32_t id, element_t* elements, size_t count) const
+  {
+    static_assert (std::is_trivially_copyable_v <element_t>, "checkpoints hold plain data only");
+    size_t found = 0u;
+    element_t const* source = find <element_t> (id, found);
+    if (!source || found != count)
+    {
+      return false;
+    }
+    std::memcpy ((void*)elements, source, count * sizeof (element_t));
+    return true;
+  }
+
+  /// @brief map a section as a buffer of 'capacity' elements, the ones past the section's count start zeroed
+  /// The file's pages are mapped copy on write, see page_buffer_t::map_file, so nothing is read until it is touched.
+  /// @return false if there is no such section, it holds more than 'capacity' elements, or it could not be mapped
+  template <typename element_t>
+  bool map (uint32_t id, page_buffer_t <element_t>& buffer, size_t capacity) const
+  {
+    world_checkpoint_section_t const* section = find_section (id, sizeof (element_t));
+#if WORLD_CHECKPOINT_USE_MMAP
+    return section && section->count <= capacity && buffer.map_file (fd, (size_t)section->offset, (size_t)section->count, capacity);
+#else
+    (void)section; (void)buffer; (void)capacity;
+    return false;
+#endif
+  }
+
+  /// @brief map a section if possible, otherwise allocate 'capacity' elements & copy it in
+  /// @return false if there is no such section or it holds more than 'capacity' elements
+  template <typename element_t>
+  bool map_or_copy (uint32_t id, page_buffer_t <element_t>& buffer, size_t capacity, page_mode_t mode) const
+  {
+    if (map (id, buffer, capacity))
+    {
+      return true;
+    }
+    size_t count = 0u;
+    element_t const* source = find <element_t> (id, count);
+    if (!source || count > capacity || !buffer.allocate (capacity, mode))
+    {
+      return false;
+    }
+    std::memcpy ((void*)buffer.data (), source, count * sizeof (element_t));
+    return true;
+  }
+
+
+private:
+  bool validate (uint32_t app, uint32_t layout_version)
+  {
+    header = (world_checkpoint_header_t const*)bytes;
+    if (std::memcmp (header->magic, "SHOTCKPT", sizeof (header->magic)) != 0
+      || header->format_version != WORLD_CHECKPOINT_VERSION || header->byte_order != WORLD_CHECKPOINT_BYTE_ORDER
+      || header->app != app || header->layout_version != layout_version || header->file_bytes != file_bytes
+      || sizeof (world_checkpoint_header_t) + (uint64_t)header->num_sections * sizeof (world_checkpoint_section_t) > file_bytes)
+    {
+      return false;
+    }
+    sections = (world_checkpoint_section_t const*)(bytes + sizeof (world_checkpoint_header_t));
+    for (uint32_t i = 0u; i < header->num_sections; ++i)
+    {
+      world_checkpoint_section_t const& section = sections [i];
+      if (section.offset % WORLD_CHECKPOINT_ALIGNMENT != 0u || section.element_bytes == 0u
+        || section.bytes != section.count * section.element_bytes || section.offset + section.bytes > file_bytes)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  world_checkpoint_section_t const* find_section (uint32_t id, size_t element_bytes) const
+  {
+    for (uint32_t i = 0u; header && i < header->num_sections; ++i)
+    {
+      if (sections [i].id == id)
+      {
+        return sections [i].element_bytes == element_bytes ? &sections [i] : nullptr;
+      }
+    }
+    return nullptr;
+  }
+
+  unsigned char const*              bytes = nullptr;
+  size_t                            file_bytes = 0u;
+  world_checkpoint_header_t const*  header = nullptr;
+  world_checkpoint_section_t const* sections = nullptr;
+#if WORLD_CHECKPOINT_USE_MMAP
+  int                               fd = -1;
+#endif
+};
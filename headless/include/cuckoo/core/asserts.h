@@ -0,0 +1,12 @@
+// HEADLESS STAND-IN:
+//
+// The subset of cuckoo/core/asserts.h used by SHOT1 & SHOT2, so their simulations can be built without pigeon.
+// See headless/CMakeLists.txt.
+
+
+#pragma once
+
+#include <cassert>                     // for assert
+
+
+#define CUCKOO_ASSERT(expression) assert (expression)
@@ -0,0 +1,33 @@
+// HEADLESS STAND-IN:
+//
+// The subset of cuckoo/core/logger.h used by SHOT2, so its simulation can be built without pigeon.
+// See headless/CMakeLists.txt.
+
+
+#pragma once
+
+#include <atomic>                      // for std::atomic
+#include <cstdio>                      // for std::printf
+
+
+namespace cuckoo
+{
+  namespace headless
+  {
+    /// @brief when true, cuckoo::printf prints nothing
+    /// the benchmarks mute the per-frame output so it is not part of what they measure
+    /// (atomic, as the telemetry log's drain thread prints through cuckoo::printf)
+    inline std::atomic <bool> mute_printf = false;
+  }
+
+  template <typename... args_t>
+  void printf (char const* format, args_t... args)
+  {
+    if (!headless::mute_printf)
+    {
+      std::printf (format, args...);
+    }
+  }
+}
+
+#define CUCKOO_DPRINTF(...) cuckoo::printf (__VA_ARGS__)
@@ -0,0 +1,57 @@
+// HEADLESS STAND-IN:
+//
+// The subset of cuckoo/maths/maths.h used by SHOT1 & SHOT2, so their simulations can be built without pigeon.
+// See headless/CMakeLists.txt.
+
+
+#pragma once
+
+#include <cmath>                       // for std::cos, std::sin, std::sqrt, std::fmod
+
+
+namespace cuckoo::maths
+{
+  struct vec4
+  {
+    vec4 (void) = default;
+    vec4 (float x_, float y_, float z_, float w_) : x (x_), y (y_), z (z_), w (w_) {}
+
+    float x = 0.f;
+    float y = 0.f;
+    float z = 0.f;
+    float w = 0.f;
+  };
+
+  /// @brief column-major, as pigeon's sprite batch expects
+  struct mat4
+  {
+    float m [16] = {};
+  };
+
+  inline mat4 transpose (mat4 const& a)
+  {
+    mat4 t;
+    for (unsigned row = 0u; row < 4u; ++row)
+    {
+      for (unsigned column = 0u; column < 4u; ++column)
+      {
+        t.m [column * 4u + row] = a.m [row * 4u + column];
+      }
+    }
+    return t;
+  }
+
+  template <typename type_t> constexpr type_t two_pi (void) { return (type_t)6.283185307179586; }
+
+  template <typename type_t> type_t lerp (type_t a, type_t b, type_t t) { return a + (b - a) * t; }
+  template <typename type_t> type_t min (type_t a, type_t b) { return a < b ? a : b; }
+  template <typename type_t> type_t max (type_t a, type_t b) { return a > b ? a : b; }
+  template <typename type_t> type_t cos (type_t x) { return std::cos (x); }
+  template <typename type_t> type_t sin (type_t x) { return std::sin (x); }
+  template <typename type_t> type_t sqrt (type_t x) { return std::sqrt (x); }
+  template <typename type_t> type_t mod (type_t a, type_t b) { return std::fmod (a, b); }
+  template <typename type_t> type_t radians (type_t degrees) { return degrees * (type_t)0.017453292519943295; }
+}
+
+using cuckoo::maths::vec4;
+using cuckoo::maths::mat4;
@@ -0,0 +1,7 @@
+// HEADLESS STAND-IN:
+//
+// cuckoo/time/time.h is included by SHOT1's player, which uses none of it, so its simulation can be built without pigeon.
+// See headless/CMakeLists.txt.
+
+
+#pragma once
@@ -0,0 +1,32 @@
+// HEADLESS STAND-IN:
+//
+// The subset of pigeon/gfx/driver.h used by SHOT1 & SHOT2, so their simulations can be built without pigeon.
+// There is no window, the screen size is whatever the benchmark sets it to.
+// See headless/CMakeLists.txt.
+
+
+#pragma once
+
+
+namespace pigeon::gfx::driver
+{
+  struct screen_size_t
+  {
+    unsigned x = 0u;
+    unsigned y = 0u;
+  };
+
+  namespace headless
+  {
+    inline screen_size_t screen_size = { 1280u, 720u };
+  }
+
+  inline screen_size_t get_screen_size (void) { return headless::screen_size; }
+
+  /// @brief there is nothing to present to, the renderer's points go to its headless backend, if it has one
+  template <typename renderer_t>
+  void render (renderer_t& renderer)
+  {
+    renderer.headless_submit ();
+  }
+}
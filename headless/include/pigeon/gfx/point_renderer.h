@@ -0,0 +1,130 @@
+// HEADLESS STAND-IN:
+//
+// A point sink with the same interface as pigeon's point_renderer.
+// Rather than drawing, it counts & checksums every point it is given, so:
+// - the particle system's render pack & submit costs are still paid (nothing can be optimised away)
+// - two builds that should draw the same points can be compared by checksum
+// It also measures how far apart consecutive points are, a proxy for how well the point stream's order suits render's caches.
+// If a backend is installed (e.g. the software rasteriser, see headless/software_rasteriser.h),
+// the points are also kept, as a real renderer keeps its vertex buffer, and handed to it by pigeon::gfx::driver::render.
+// See headless/CMakeLists.txt.
+
+
+#pragma once
+
+#include "cuckoo/core/asserts.h"       // for CUCKOO_ASSERT
+#include "cuckoo/maths/maths.h"        // for vec4
+
+#include <cmath>                       // for std::fabs
+#include <cstdint>                     // for uint32_t, uint64_t
+#include <cstring>                     // for std::memcpy
+#include <vector>                      // for std::vector
+
+
+namespace pigeon::gfx
+{
+  struct descriptor_point_renderer
+  {
+    unsigned max_points = 0u;
+  };
+
+  namespace headless
+  {
+    /// @brief what the last completed batch drew, the renderer itself is owned by the particle system
+    struct point_batch_stats_t
+    {
+      unsigned long long num_points = 0u;
+      uint64_t checksum = 0u;
+      double step_sum = 0.0;               // sum of |dx| + |dy| between consecutive points, in pixels
+    };
+
+    inline point_batch_stats_t last_batch;
+
+    /// @brief one point, as it was passed to point_renderer::draw
+    struct point_vertex_t
+    {
+      float x;
+      float y;
+      vec4  colour;
+    };
+
+    /// @brief consumes a completed batch, called by pigeon::gfx::driver::render
+    using point_backend_t = void (*) (point_vertex_t const* points, unsigned long long num_points, void* user_data);
+
+    inline point_backend_t backend = nullptr; // when null, points are only counted & checksummed
+    inline void* backend_user_data = nullptr;
+  }
+
+  class point_renderer
+  {
+  public:
+    bool initialise (descriptor_point_renderer const& desc)
+    {
+      max_points = desc.max_points;
+      vertices.clear ();
+      vertices.reserve (headless::backend ? max_points : 0u);
+      return true;
+    }
+
+    void start_batch (void)
+    {
+      num_points = 0u;
+      checksum = 0u;
+      step_sum = 0.0;
+      vertices.clear ();
+    }
+
+    void draw (float x, float y, vec4 const& colour)
+    {
+      // order dependent, so points drawn in a different order give a different checksum
+      checksum = (checksum ^ bits (x)) * 0x100000001b3ull;
+      checksum = (checksum ^ bits (y)) * 0x100000001b3ull;
+      checksum = (checksum ^ bits (colour.x) ^ ((uint64_t)bits (colour.w) << 32u)) * 0x100000001b3ull;
+      step_sum += (num_points ? (double)(std::fabs (x - last_x) + std::fabs (y - last_y)) : 0.0);
+      last_x = x;
+      last_y = y;
+      ++num_points;
+
+      if (headless::backend)
+      {
+        vertices.push_back ({ x, y, colour });
+      }
+    }
+
+    void end_batch (void)
+    {
+      CUCKOO_ASSERT (num_points <= max_points);
+      headless::last_batch = { num_points, checksum, step_sum };
+    }
+
+    /// @brief hand the completed batch to the backend, if there is one
+    void headless_submit (void)
+    {
+      if (headless::backend)
+      {
+        headless::backend (vertices.data (), vertices.size (), headless::backend_user_data);
+      }
+    }
+
+    void release (void)
+    {
+      vertices = {};
+    }
+
+  private:
+    static uint32_t bits (float value)
+    {
+      uint32_t result;
+      std::memcpy (&result, &value, sizeof (result));
+      return result;
+    }
+
+    unsigned max_points = 0u;
+    unsigned long long num_points = 0u;
+    uint64_t checksum = 0u;
+    double step_sum = 0.0;
+    float last_x = 0.f;
+    float last_y = 0.f;
+    std::vector <headless::point_vertex_t> vertices; // only filled when there is a backend
+  };
+}
@@ -0,0 +1,31 @@
+// HEADLESS STAND-IN:
+//
+// The subset of pigeon/gfx/sprite_batch.h used by SHOT1, so its simulation can be built without pigeon.
+// There is nothing to draw to, sprites are dropped. See headless/CMakeLists.txt.
+
+
+#pragma once
+
+#include "cuckoo/core/asserts.h"       // for CUCKOO_ASSERT, which SHOT1's player gets through pigeon's headers
+#include "pigeon/gfx/spritesheet.h"    // for texture_rect, pigeon::gfx::image
+
+
+namespace pigeon::gfx
+{
+  struct descriptor_sprite_batch
+  {
+    image*   source_image = nullptr;
+    unsigned max_sprites = 0u;
+  };
+
+  struct sprite_batch
+  {
+    bool initialise (descriptor_sprite_batch const&) { return true; }
+    void release (void) {}
+    bool start_batch (void) { return true; }
+    void end_batch (void) {}
+
+    void draw (texture_rect const&, float const* /*matrix*/) {}
+    void draw (texture_rect const&, float /*x*/, float /*y*/, float /*angle*/, float /*origin_x*/, float /*origin_y*/, float /*width*/, float /*height*/) {}
+  };
+}
@@ -0,0 +1,54 @@
+// HEADLESS STAND-IN:
+//
+// The subset of pigeon/gfx/spritesheet.h used by SHOT1, so its simulation can be built without pigeon.
+// There is no texture: SHOT1 only asks the spritesheet for its sprites' sizes (they are the objects' sizes in the game),
+// which are fixed here. See headless/CMakeLists.txt.
+
+
+#pragma once
+
+#include <cstring>                     // for std::strcmp
+
+
+struct texture_rect
+{
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+
+namespace pigeon::gfx
+{
+  struct image
+  {
+  };
+
+  struct spritesheet
+  {
+    bool initialise (char const*) { return true; }
+    void release (void) {}
+
+    /// @return the named sprite's rect, or nullptr if there is no such sprite
+    texture_rect const* get_sprite_info (char const* name) const
+    {
+      static struct { char const* name; texture_rect rect; } const sprites [] =
+      {
+        { "tile_0.png",   {   0, 0, 32, 32 } },
+        { "player_0.png", {  32, 0, 64, 64 } },
+        { "player_1.png", {  96, 0, 96, 96 } },
+        { "wall.png",     { 192, 0, 32, 32 } },
+      };
+      for (auto const& sprite : sprites)
+      {
+        if (std::strcmp (sprite.name, name) == 0)
+        {
+          return &sprite.rect;
+        }
+      }
+      return nullptr;
+    }
+
+    image* get_image (void) { return nullptr; }
+  };
+}
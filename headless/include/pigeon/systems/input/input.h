@@ -0,0 +1,42 @@
+// HEADLESS STAND-IN:
+//
+// The subset of pigeon/systems/input/input.h used by SHOT1, so its simulation can be built without pigeon.
+// There is no keyboard or controller: the keys held down are whatever the harness sets, see headless::keys_down.
+// See headless/CMakeLists.txt.
+
+
+#pragma once
+
+
+namespace cuckoo::input
+{
+  enum class keyboard_key_flag : unsigned
+  {
+    LEFT  = 1u << 0,
+    RIGHT = 1u << 1,
+    UP    = 1u << 2,
+    DOWN  = 1u << 3,
+  };
+
+  enum class controller_button_flag : unsigned
+  {
+    LEFT  = 1u << 0,
+    RIGHT = 1u << 1,
+    UP    = 1u << 2,
+    DOWN  = 1u << 3,
+  };
+}
+
+namespace pigeon::input
+{
+  namespace headless
+  {
+    /// @brief keyboard_key_flag bits of the keys held down
+    inline unsigned keys_down = 0u;
+  }
+
+  inline bool is_key_down (cuckoo::input::keyboard_key_flag key) { return (headless::keys_down & (unsigned)key) != 0u; }
+
+  /// @brief no controller is ever connected
+  inline bool is_down (unsigned /*controller*/, cuckoo::input::controller_button_flag) { return false; }
+}
@@ -0,0 +1,413 @@
+// SHOT1 GOLDEN TRACE:
+//
+// A determinism check of SHOT1's tile update & collisions (see common/golden_trace.h).
+// 2 copies of the same world (tiles, player & walls) are run side by side, from the same seed & the same scripted input:
+//   reference | plain scalar copies, frozen here, of what tiles_t::update & resolve_collisions did before any optimisation:
+//             | one tile at a time, one pair at a time, each response applied as soon as its pair is found
+//   variant   | what SHOT1 actually runs: tiles_t::update & resolve_collisions
+// Everything else (the player's update & replacement, replacing eaten tiles) is run by the same code for both.
+// After every frame, every tile's position, direction & angle and the player's position, points & kind are compared,
+// within --tolerance, and the run reports the first frame & tile (or the player) that diverged, exiting with 1 if any did.
+//
+// The player is steered by a repeatable script (a new direction, or none, every --hold frames, drawn from --seed),
+// so it crosses the screen eating tiles and runs into the walls.
+// With --record, the variant's per frame hashes are written out, --compare checks this build's against them.
+// With --rollback N, the variant is also kept in a rollback ring (see SHOT1's rollback.h) and every N frames is restored
+// to N - 1 frames ago & simulated forward again from the same input, so it must still match the reference exactly
+// (an N that is not a multiple of --keyframe restores onto deltas, not only keyframes).
+
+
+#include "pigeon/gfx/driver.h"            // for pigeon::gfx::driver::headless::screen_size
+#include "pigeon/gfx/spritesheet.h"       // for pigeon::gfx::spritesheet
+#include "pigeon/systems/input/input.h"   // for pigeon::input::headless::keys_down
+
+#include "constants.h"                    // for NUM_TILES, TILE_SPEED_MOVEMENT, TILE_SPEED_ROTATION, ...
+#include "collision.h"                    // for resolve_collisions
+#include "frame_context.h"                // for frame_context_t, frame_context_capture
+#include "tiles.h"                        // for tiles_t, get_tile_texture_rect
+#include "extra/player.h"                 // for player_t, initialise_player, check_player_needs_replacing
+#include "extra/walls.h"                  // for wall_t, walls_t
+#include "rollback.h"                     // for rollback_ring_t
+
+#include "../common/golden_trace.h"       // for golden_checker_t, golden_hash_t, golden_trace_write, golden_trace_read
+#include "../common/random.h"             // for random_t, random_seed, random_next
+
+#include <cstdio>                         // for std::printf, std::snprintf
+#include <cstdlib>                        // for std::strtoul, std::strtod, std::strtoull
+#include <cstring>                        // for std::strcmp, std::strlen
+#include <memory>                         // for std::unique_ptr
+#include <vector>                         // for std::vector
+
+
+// OPTIONS
+
+struct golden_options_t
+{
+  unsigned           num_frames = 1800u;       // long enough for the player to turn fast & back again
+  double             elapsed_seconds = 1.0 / 60.0;
+  unsigned           hold_frames = 30u;        // frames each scripted input is held for
+  unsigned long long seed = 0u;                // SHOT1's own seed, see main.cpp
+  double             tolerance = 1e-9;         // SHOT1 simulates in double
+  char const*        record_path = nullptr;    // write the variant's per frame hashes here
+  char const*        compare_path = nullptr;   // check the variant's per frame hashes against these
+  unsigned           rollback_frames = 0u;     // restore the variant this often, 0 for never
+  unsigned           keyframe_frames = 30u;    // the rollback ring's keyframe interval, as SHOT1's default
+};
+
+static void print_usage (char const* name)
+{
+  std::printf ("usage: %s [--frames N] [--dt SECONDS] [--hold N] [--seed N] [--tolerance T] [--record FILE] [--compare FILE]\n"
+    "  [--rollback N [--keyframe N]]\n", name);
+  std::printf ("  --frames     frames compared (default 1800)\n");
+  std::printf ("  --dt         fixed time step of every frame (default 1/60)\n");
+  std::printf ("  --hold       frames each scripted input is held for (default 30)\n");
+  std::printf ("  --seed       seed of the tiles & the input script (default 0, as SHOT1)\n");
+  std::printf ("  --tolerance  largest difference allowed, relative to the larger value (at least 1), 0 for exact (default 1e-9)\n");
+  std::printf ("  --record     write the variant's per frame hashes to FILE\n");
+  std::printf ("  --compare    check the variant's per frame hashes against a trace written by --record\n");
+  std::printf ("  --rollback   every N frames, roll the variant back N - 1 frames & simulate them again (default 0, never)\n");
+  std::printf ("  --keyframe   frames between the rollback ring's keyframes (default 30)\n");
+}
+
+/// @return false if the program should exit, without running the check
+static bool parse_options (int argc, char** argv, golden_options_t& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    char const* name = argv [i];
+    char const* value = i + 1 < argc ? argv [i + 1] : nullptr;
+
+    if (std::strcmp (name, "--help") == 0 || std::strcmp (name, "-h") == 0)
+    {
+      print_usage (argv [0]);
+      return false;
+    }
+    if (!value)
+    {
+      std::printf ("missing value for %s\n", name);
+      print_usage (argv [0]);
+      return false;
+    }
+
+    if (std::strcmp (name, "--frames") == 0)         options.num_frames = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--dt") == 0)        options.elapsed_seconds = std::strtod (value, nullptr);
+    else if (std::strcmp (name, "--hold") == 0)      options.hold_frames = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--seed") == 0)      options.seed = std::strtoull (value, nullptr, 0);
+    else if (std::strcmp (name, "--tolerance") == 0) options.tolerance = std::strtod (value, nullptr);
+    else if (std::strcmp (name, "--record") == 0)    options.record_path = value;
+    else if (std::strcmp (name, "--compare") == 0)   options.compare_path = value;
+    else if (std::strcmp (name, "--rollback") == 0)  options.rollback_frames = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--keyframe") == 0)  options.keyframe_frames = (unsigned)std::strtoul (value, nullptr, 10);
+    else
+    {
+      std::printf ("unknown option %s\n", name);
+      print_usage (argv [0]);
+      return false;
+    }
+    ++i;
+  }
+
+  if (options.num_frames == 0u || options.elapsed_seconds <= 0.0 || options.hold_frames == 0u)
+  {
+    std::printf ("--frames, --dt & --hold must all be greater than 0\n");
+    return false;
+  }
+  return true;
+}
+
+
+// REFERENCE
+
+/// @brief check whether 2 AABBs, positioned at their centres, overlap (by more than the 4 pixels allowed)
+static bool reference_is_overlapping (double lhs_x, double lhs_y, double lhs_width, double lhs_height,
+  double rhs_x, double rhs_y, double rhs_width, double rhs_height)
+{
+  double const overlap = 4.0;
+  return lhs_x - (lhs_width - overlap) / 2.0 < rhs_x + (rhs_width - overlap) / 2.0
+    && lhs_x + (lhs_width - overlap) / 2.0 > rhs_x - (rhs_width - overlap) / 2.0
+    && lhs_y - (lhs_height - overlap) / 2.0 < rhs_y + (rhs_height - overlap) / 2.0
+    && lhs_y + (lhs_height - overlap) / 2.0 > rhs_y - (rhs_height - overlap) / 2.0;
+}
+
+/// @brief move an object of size 'width' x 'height' at 'position' out of the wall it overlaps
+static void reference_push_out_of_wall (vector4& position, double width, double height, wall_t const& wall)
+{
+  if (wall.get_id () == WALL_ID_LEFT)        position.x = wall.position.x + wall.size / 2.0 + width / 2.0;
+  else if (wall.get_id () == WALL_ID_RIGHT)  position.x = wall.position.x - wall.size / 2.0 - width / 2.0;
+  else if (wall.get_id () == WALL_ID_TOP)    position.y = wall.position.y - wall.size / 2.0 - height / 2.0;
+  else if (wall.get_id () == WALL_ID_BOTTOM) position.y = wall.position.y + wall.size / 2.0 + height / 2.0;
+}
+
+/// @brief REFERENCE: tiles_t::update, one tile at a time
+static void reference_tiles_update (tiles_t& tiles, double elapsed)
+{
+  for (unsigned i = 0u; i < NUM_TILES; ++i)
+  {
+    tiles.position [i].x += tiles.direction [i].x * TILE_SPEED_MOVEMENT * elapsed;
+    tiles.position [i].y += tiles.direction [i].y * TILE_SPEED_MOVEMENT * elapsed;
+
+    tiles.angle_radians [i] += (float)TILE_SPEED_ROTATION * elapsed;
+    tiles.angle_radians [i] = cuckoo::maths::mod (tiles.angle_radians [i], cuckoo::maths::two_pi <float> ());
+  }
+}
+
+/// @brief REFERENCE: resolve_collisions, one pair at a time: player v tile, player v wall, then tile v wall
+static void reference_resolve_collisions (pigeon::gfx::spritesheet& spritesheet, player_t& player, tiles_t& tiles, walls_t const& walls)
+{
+  texture_rect const* const tile_rect = get_tile_texture_rect (spritesheet, TILE_ID_NORMAL);
+
+  // PLAYER v TILE: the player scores the tile, which is eaten
+  for (unsigned i = 0u; i < NUM_TILES; ++i)
+  {
+    texture_rect const* const player_rect = get_player_texture_rect (spritesheet, player.get_id ());
+    if (reference_is_overlapping (player.position.x, player.position.y, player_rect->width, player_rect->height,
+      tiles.position [i].x, tiles.position [i].y, tile_rect->width, tile_rect->height))
+    {
+      ++player.num_points;
+      if (player.get_id () == PLAYER_ID_NORMAL && player.num_points % PLAYER_FAST_POINTS_SWITCH == 0u)
+      {
+        player.new_player_id = PLAYER_ID_FAST;
+      }
+      tiles.on_eaten ((int)i); // the only way to mark a tile eaten
+    }
+  }
+
+  // PLAYER v WALL: the player is pushed back out
+  for (wall_t const& wall : walls.data)
+  {
+    texture_rect const* const player_rect = get_player_texture_rect (spritesheet, player.get_id ());
+    if (reference_is_overlapping (player.position.x, player.position.y, player_rect->width, player_rect->height,
+      wall.position.x, wall.position.y, wall.size, wall.size))
+    {
+      reference_push_out_of_wall (player.position, player_rect->width, player_rect->height, wall);
+    }
+  }
+
+  // TILE v WALL: the tile is reflected & pushed back out
+  for (unsigned i = 0u; i < NUM_TILES; ++i)
+  {
+    for (wall_t const& wall : walls.data)
+    {
+      if (reference_is_overlapping (tiles.position [i].x, tiles.position [i].y, tile_rect->width, tile_rect->height,
+        wall.position.x, wall.position.y, wall.size, wall.size))
+      {
+        if (wall.get_id () == WALL_ID_LEFT || wall.get_id () == WALL_ID_RIGHT)
+        {
+          tiles.direction [i].x = -tiles.direction [i].x;
+        }
+        else
+        {
+          tiles.direction [i].y = -tiles.direction [i].y;
+        }
+        reference_push_out_of_wall (tiles.position [i], tile_rect->width, tile_rect->height, wall);
+      }
+    }
+  }
+}
+
+
+// WORLDS
+
+/// @brief one of the 2 worlds, the walls are shared (nothing changes them)
+struct golden_world_t
+{
+  std::unique_ptr <tiles_t> tiles { new tiles_t () }; // ~70 KB at NUM_TILES = 1 << 10, zeroed
+  player_t*                 player = nullptr;
+
+  ~golden_world_t (void)
+  {
+    if (player)
+    {
+      release_player (player);
+    }
+  }
+};
+
+/// @brief one frame of the variant: what SHOT1 runs each tick
+static void step_variant (golden_world_t& world, golden_options_t const& options, unsigned frame,
+  pigeon::gfx::spritesheet& spritesheet, frame_context_t& frame_context)
+{
+  world.player->begin_tick ();
+  world.tiles->begin_tick ();
+  world.player->update (options.elapsed_seconds, spritesheet);
+  world.tiles->update (options.elapsed_seconds);
+  resolve_collisions (spritesheet, *world.player, *world.tiles, frame_context);
+  check_player_needs_replacing (world.player);
+
+  random_set_seed (options.seed + 1u + frame); // as the reference, see main
+  *world.tiles = replace_expired_tiles (*world.tiles);
+}
+
+static uint64_t hash_world (golden_world_t const& world)
+{
+  golden_hash_t hash;
+  for (unsigned i = 0u; i < NUM_TILES; ++i)
+  {
+    hash.add (world.tiles->position [i].x);
+    hash.add (world.tiles->position [i].y);
+    hash.add (world.tiles->direction [i].x);
+    hash.add (world.tiles->direction [i].y);
+    hash.add (world.tiles->angle_radians [i]);
+  }
+  hash.add (world.player->position.x);
+  hash.add (world.player->position.y);
+  hash.add (world.player->num_points);
+  hash.add (world.player->get_id ());
+  return hash.value;
+}
+
+
+int main (int argc, char** argv)
+{
+  golden_options_t options;
+  if (!parse_options (argc, argv, options))
+  {
+    return 1;
+  }
+
+  pigeon::gfx::driver::headless::screen_size = { SCREEN_WIDTH, SCREEN_HEIGHT };
+  pigeon::gfx::spritesheet spritesheet = {};
+  frame_context_t frame_context;
+  frame_context_capture (frame_context);
+
+  golden_world_t reference;
+  golden_world_t variant;
+  for (golden_world_t* world : { &reference, &variant })
+  {
+    // every tile set up from the seed, the same in both worlds
+    random_set_seed (options.seed);
+    for (unsigned i = 0u; i < NUM_TILES; ++i)
+    {
+      world->tiles->initialise_tile ((int)i);
+    }
+    initialise_player (world->player);
+  }
+
+  random_t script;
+  random_seed (script, options.seed, 1u);
+
+  std::printf ("SHOT1 golden trace: %u frames of %u tiles, dt %g, input held for %u frames, seed %llu\n",
+    options.num_frames, NUM_TILES, options.elapsed_seconds, options.hold_frames, options.seed);
+
+  rollback_ring_t rollback;
+  std::vector <unsigned> frame_keys; // the input each frame was simulated with, to simulate it again
+  if (options.rollback_frames > 0u)
+  {
+    rollback.initialise (options.rollback_frames, options.keyframe_frames);
+    frame_keys.resize (options.num_frames);
+  }
+
+  golden_checker_t checker (options.tolerance);
+  unsigned num_eaten = 0u;
+  for (unsigned frame = 0u; frame < options.num_frames; ++frame)
+  {
+    if (frame % options.hold_frames == 0u)
+    {
+      pigeon::input::headless::keys_down = random_next (script) & 15u; // any of left, right, up & down
+    }
+
+    // both worlds replace their eaten tiles from the same numbers
+    unsigned const points_before = reference.player->num_points;
+    reference.player->begin_tick ();
+    reference.tiles->begin_tick ();
+    reference.player->update (options.elapsed_seconds, spritesheet);
+    reference_tiles_update (*reference.tiles, options.elapsed_seconds);
+    reference_resolve_collisions (spritesheet, *reference.player, *reference.tiles, frame_context.walls);
+    check_player_needs_replacing (reference.player);
+    random_set_seed (options.seed + 1u + frame);
+    *reference.tiles = replace_expired_tiles (*reference.tiles);
+    num_eaten += reference.player->num_points - points_before;
+
+    step_variant (variant, options, frame, spritesheet, frame_context);
+
+    if (rollback.is_enabled ())
+    {
+      frame_keys [frame] = pigeon::input::headless::keys_down;
+      rollback.record (*variant.player, *variant.tiles, options.elapsed_seconds); // tick 'frame'
+      if ((frame + 1u) % options.rollback_frames == 0u)
+      {
+        unsigned const restored_frame = frame + 1u - options.rollback_frames;
+        if (!rollback.restore (restored_frame, variant.player, *variant.tiles))
+        {
+          std::printf ("  rollback    : FAILED to restore frame %u\n", restored_frame);
+          return 1;
+        }
+        for (unsigned replayed = restored_frame + 1u; replayed <= frame; ++replayed)
+        {
+          pigeon::input::headless::keys_down = frame_keys [replayed];
+          step_variant (variant, options, replayed, spritesheet, frame_context);
+          rollback.record (*variant.player, *variant.tiles, options.elapsed_seconds);
+        }
+      }
+    }
+
+    checker.begin_frame (frame);
+    for (unsigned i = 0u; i < NUM_TILES; ++i)
+    {
+      tiles_t const& r = *reference.tiles;
+      tiles_t const& v = *variant.tiles;
+      checker.compare ("tile", i, "position_x", r.position [i].x, v.position [i].x);
+      checker.compare ("tile", i, "position_y", r.position [i].y, v.position [i].y);
+      checker.compare ("tile", i, "direction_x", r.direction [i].x, v.direction [i].x);
+      checker.compare ("tile", i, "direction_y", r.direction [i].y, v.direction [i].y);
+      checker.compare ("tile", i, "angle_radians", r.angle_radians [i], v.angle_radians [i]);
+    }
+    checker.compare ("player", 0u, "position_x", reference.player->position.x, variant.player->position.x);
+    checker.compare ("player", 0u, "position_y", reference.player->position.y, variant.player->position.y);
+    checker.compare ("player", 0u, "num_points", reference.player->num_points, variant.player->num_points);
+    checker.compare ("player", 0u, "id", reference.player->get_id (), variant.player->get_id ());
+    checker.end_frame (hash_world (reference), hash_world (variant));
+  }
+
+  auto print = [] (char const* text, void*) { std::printf ("  %s", text); };
+  std::printf ("  eaten       : %u tiles (by the reference's player)\n", num_eaten);
+  if (rollback.is_enabled ())
+  {
+    rollback_stats_t const& stats = rollback.get_stats ();
+    std::printf ("  rollback    : %llu restores, %llu ticks recorded (%llu keyframes, %.1f tiles patched a tick), %.1f MB reserved\n",
+      stats.num_restores, stats.num_records, stats.num_keyframes, (double)stats.num_patches / (double)stats.num_records,
+      (double)rollback.get_reserved_bytes () / (1024.0 * 1024.0));
+    std::printf ("  rollback    : %.4f ms a record, %.4f ms a restore\n",
+      stats.record_seconds * 1000.0 / (double)stats.num_records,
+      stats.num_restores ? stats.restore_seconds * 1000.0 / (double)stats.num_restores : 0.0);
+  }
+  checker.report (print, nullptr);
+  bool is_failed = checker.has_diverged ();
+
+  char trace_name [256];
+  std::snprintf (trace_name, sizeof (trace_name), "SHOT1 tiles %u dt %g hold %u seed %llu",
+    NUM_TILES, options.elapsed_seconds, options.hold_frames, options.seed);
+  if (options.record_path)
+  {
+    bool const is_recorded = golden_trace_write (options.record_path, trace_name, checker.get_variant_hashes ());
+    std::printf ("  record      : %s %s\n", is_recorded ? "wrote" : "FAILED to write", options.record_path);
+    is_failed |= !is_recorded;
+  }
+  if (options.compare_path)
+  {
+    std::vector <uint64_t> expected;
+    if (!golden_trace_read (options.compare_path, trace_name, expected))
+    {
+      std::printf ("  compare     : FAILED to read %s, or it was recorded with other options\n", options.compare_path);
+      is_failed = true;
+    }
+    else
+    {
+      std::vector <uint64_t> const& actual = checker.get_variant_hashes ();
+      unsigned const first_difference = golden_trace_first_difference (expected, actual);
+      unsigned const num_compared = (unsigned)(expected.size () < actual.size () ? expected.size () : actual.size ());
+      if (first_difference < num_compared)
+      {
+        std::printf ("  compare     : DIVERGED from %s at frame %u (of %u)\n", options.compare_path, first_difference, num_compared);
+        is_failed = true;
+      }
+      else
+      {
+        std::printf ("  compare     : MATCH, %u frames bit identical to %s\n", num_compared, options.compare_path);
+      }
+    }
+  }
+
+  frame_context_release (frame_context);
+  return is_failed ? 1 : 0;
+}
@@ -0,0 +1,535 @@
+// SHOT2 HEADLESS BENCHMARK:
+//
+// Runs SHOT2's particle_system_t for a fixed number of frames at a fixed time step,
+// with no window & no GPU: the point renderer is a stand-in that checksums every point submitted to it.
+// Reports, per measured frame:
+//   update      | particle_system_t::update, ns per active particle
+//   render pack | particle_system_t::render (packing & submitting every point), ns per point drawn
+//   active      | active particles against the configured capacity
+//   checksum    | of every point drawn, builds that should draw the same points must match
+//   locality    | mean distance between consecutively drawn points, lower is friendlier to render's caches
+//   reorder     | with --reorder, the Morton sorts' cost (part of update, see morton_order.h)
+//   raster      | with --raster or --dump, the software rasteriser's cost (part of render pack), ns per point drawn
+//   allocations | heap allocations (through operator new) per frame, --zero-alloc fails the run if any measured frame allocates
+//   telemetry   | records logged through the telemetry log (drained to the muted cuckoo::printf, so only queuing is paid for)
+//   governor    | with --budget, the frame governor's decisions & where it settled (see frame_governor.h),
+//               | --load starts busy threads halfway through the measured frames, to see it react to a busier machine
+// The last line of the report is a single CSV row, so the rows of several runs can be collected into a table.
+//
+// With --dump, the last frame is also written out as an image (see software_rasteriser.h).
+// With --trace, every thread's work over the measured frames is written out as a Chrome trace (see common/trace.h).
+// With --checkpoint-save, the world the measured frames start from is saved, and --checkpoint-load starts from a saved
+// world rather than warming up (see common/world_checkpoint.h): a checkpointed run draws exactly what the run that saved
+// it drew, so a large start state (e.g. --particles 8388608) is set up once & then loaded in milliseconds.
+// With --perf, the CPU's counters (cycles, instructions, cache & branch misses) over the measured frames' update & render
+// are reported per frame & per particle, where Linux allows it (see common/perf_counters.h).
+//
+// The capacity, spawn rate, worker count & page mode default to SHOT2's, or its SHOT2_* environment variables
+// (see particle_config.h), and can be set on the command line. For thread scaling, run once per worker count,
+// see the shot2_bench_scaling target in headless/CMakeLists.txt.
+
+
+#include "cuckoo/core/logger.h"        // for cuckoo::headless::mute_printf
+#include "pigeon/gfx/driver.h"         // for pigeon::gfx::driver::headless::screen_size
+#include "pigeon/gfx/point_renderer.h" // for pigeon::gfx::headless::last_batch
+
+#include "constants.h"                 // for PARTICLE_MODE, PARTICLE_FUSED_PACK, PARTICLE_PIPELINED
+#include "particle_config.h"           // for particle_config_t, particle_config_from_environment
+#include "frame_context.h"             // for frame_context_t, frame_context_capture
+#include "particle_system.h"           // for particle_system_t
+#include "frame_governor.h"            // for frame_governor_t
+
+#include "../common/telemetry_log.h"   // for telemetry_log
+#include "../common/trace.h"           // for trace_start, trace_write, TRACE_ZONE
+#include "../common/perf_counters.h"   // for perf_profile, perf_zone_t
+#include "../common/fixed_timestep.h"  // for fixed_timestep_t
+#define ALLOC_TRACKER_IMPLEMENTATION       // the counting operators new & delete live here
+#include "../common/alloc_tracker.h"   // for alloc_tracker, ALLOC_ZONE
+
+#include "software_rasteriser.h"       // for software_rasteriser_t
+
+#include <atomic>                      // for std::atomic
+#include <chrono>                      // for std::chrono::steady_clock
+#include <cmath>                       // for std::sqrt
+#include <cstdint>                     // for uint64_t
+#include <cstdio>                      // for std::printf
+#include <cstdlib>                     // for std::strtoul, std::strtod
+#include <cstring>                     // for std::strcmp
+#include <thread>                      // for std::thread
+#include <vector>                      // for std::vector
+
+
+// OPTIONS
+
+struct bench_options_t
+{
+  unsigned num_frames = 600u;
+  unsigned num_warmup_frames = 200u;    // long enough for the default spawn rate to fill the default capacity
+  double   elapsed_seconds = 1.0 / 60.0;
+  unsigned screen_width = 1280u;
+  unsigned screen_height = 720u;
+
+  bool        is_rasterised = false;    // splat every frame with the software rasteriser
+  char const* dump_path = nullptr;      // write the last frame here, implies is_rasterised
+  unsigned    num_load_threads = 0u;    // busy threads started halfway through the measured frames
+  char const* trace_path = nullptr;     // write a trace of the measured frames here
+  bool        is_perf_counted = false;  // read the CPU's counters over the measured frames
+  bool        is_zero_alloc = false;    // fail if any measured frame allocates
+  char const* checkpoint_save_path = nullptr; // save the world here, after the warm-up
+  char const* checkpoint_load_path = nullptr; // start from this world, in place of the warm-up
+
+  particle_config_t config = particle_config_from_environment ();
+};
+
+static void print_usage (char const* name)
+{
+  int const indent = (int)std::strlen (name);
+  std::printf ("usage: %s [--frames N] [--warmup N] [--dt SECONDS] [--width PIXELS] [--height PIXELS]\n", name);
+  std::printf ("       %*s [--particles N] [--spawn-rate N] [--threads N] [--pages small|transparent|explicit] [--reorder FRAMES]\n", indent, "");
+  std::printf ("       %*s [--affectors wind,vortex,turbulence|none] [--budget MS] [--load THREADS]\n", indent, "");
+  std::printf ("       %*s [--raster] [--dump FILE] [--trace FILE] [--perf] [--zero-alloc]\n", indent, "");
+  std::printf ("       %*s [--checkpoint-save FILE] [--checkpoint-load FILE]\n", indent, "");
+  std::printf ("  --frames           measured frames (default 600)\n");
+  std::printf ("  --warmup           frames run before measuring (default 200)\n");
+  std::printf ("  --dt               fixed time step of every frame (default 1/60)\n");
+  std::printf ("  --width            screen width the emitters are placed for (default 1280)\n");
+  std::printf ("  --height           screen height the emitters are placed for (default 720)\n");
+  std::printf ("  --particles        particle capacity (default from particle_config.h, as are the next 5)\n");
+  std::printf ("  --spawn-rate       particles spawned per frame\n");
+  std::printf ("  --threads          workers\n");
+  std::printf ("  --pages            page mode of the particle storage\n");
+  std::printf ("  --reorder          frames between Morton reorders, 0 for none\n");
+  std::printf ("  --affectors        force fields, a comma separated list or none\n");
+  std::printf ("  --budget           frame time budget the governor adapts the spawn rate & workers to (default from particle_config.h)\n");
+  std::printf ("  --load             busy threads competing for the CPU over the second half of the measured frames (default 0)\n");
+  std::printf ("  --raster           draw every frame with the software rasteriser, as a render load\n");
+  std::printf ("  --dump             rasterise & write the last frame to FILE, a PNG if it ends in .png, otherwise a PPM\n");
+  std::printf ("  --trace            write a timeline of every thread's work over the measured frames to FILE, for chrome://tracing or Perfetto\n");
+  std::printf ("  --perf             report the CPU's counters (cycles, instructions, L1D, LLC & branch misses) per frame & per particle\n");
+  std::printf ("  --zero-alloc       fail (exit code 1) if any measured frame makes a heap allocation\n");
+  std::printf ("  --checkpoint-save  write the world the measured frames start from to FILE\n");
+  std::printf ("  --checkpoint-load  start from the world in FILE, written by --checkpoint-save with the same options, with no warm-up\n");
+}
+
+/// @return false if the program should exit, without running the benchmark
+static bool parse_options (int argc, char** argv, bench_options_t& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    char const* name = argv [i];
+    char const* value = i + 1 < argc ? argv [i + 1] : nullptr;
+
+    if (std::strcmp (name, "--help") == 0 || std::strcmp (name, "-h") == 0)
+    {
+      print_usage (argv [0]);
+      return false;
+    }
+    if (std::strcmp (name, "--raster") == 0)
+    {
+      options.is_rasterised = true;
+      continue;
+    }
+    if (std::strcmp (name, "--perf") == 0)
+    {
+      options.is_perf_counted = true;
+      continue;
+    }
+    if (std::strcmp (name, "--zero-alloc") == 0)
+    {
+      options.is_zero_alloc = true;
+      continue;
+    }
+    if (!value)
+    {
+      std::printf ("missing value for %s\n", name);
+      print_usage (argv [0]);
+      return false;
+    }
+
+    if (std::strcmp (name, "--frames") == 0)       options.num_frames = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--warmup") == 0)  options.num_warmup_frames = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--dt") == 0)      options.elapsed_seconds = std::strtod (value, nullptr);
+    else if (std::strcmp (name, "--width") == 0)   options.screen_width = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--height") == 0)  options.screen_height = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--dump") == 0)    options.dump_path = value, options.is_rasterised = true;
+    else if (std::strcmp (name, "--particles") == 0)  options.config.max_particles = (unsigned)std::strtoul (value, nullptr, 0);
+    else if (std::strcmp (name, "--spawn-rate") == 0) options.config.spawn_rate = (unsigned)std::strtoul (value, nullptr, 0);
+    else if (std::strcmp (name, "--threads") == 0)    options.config.num_threads = (unsigned)std::strtoul (value, nullptr, 0);
+    else if (std::strcmp (name, "--reorder") == 0)    options.config.reorder_interval = (unsigned)std::strtoul (value, nullptr, 0);
+    else if (std::strcmp (name, "--budget") == 0)    options.config.frame_budget_ms = (float)std::strtod (value, nullptr);
+    else if (std::strcmp (name, "--trace") == 0)     options.trace_path = value;
+    else if (std::strcmp (name, "--load") == 0)      options.num_load_threads = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--checkpoint-save") == 0) options.checkpoint_save_path = value;
+    else if (std::strcmp (name, "--checkpoint-load") == 0) options.checkpoint_load_path = value;
+    else if (std::strcmp (name, "--affectors") == 0)
+    {
+      if (!particle_affectors_from_names (value, options.config.affectors))
+      {
+        std::printf ("unknown affector in %s\n", value);
+        return false;
+      }
+    }
+    else if (std::strcmp (name, "--pages") == 0)
+    {
+      if (!page_mode_from_name (value, options.config.page_mode))
+      {
+        std::printf ("unknown page mode %s\n", value);
+        return false;
+      }
+    }
+    else
+    {
+      std::printf ("unknown option %s\n", name);
+      print_usage (argv [0]);
+      return false;
+    }
+    ++i;
+  }
+
+  if (options.num_frames == 0u || options.elapsed_seconds <= 0.0 || options.screen_width == 0u || options.screen_height == 0u)
+  {
+    std::printf ("--frames, --dt, --width & --height must all be greater than 0\n");
+    return false;
+  }
+  if (options.checkpoint_load_path)
+  {
+    options.num_warmup_frames = 0u; // the checkpoint is the warmed up world
+  }
+  if (!particle_config_validate (options.config))
+  {
+    std::printf ("particle config clamped to: %u particles, %u spawned per frame, %u threads\n",
+      options.config.max_particles, options.config.spawn_rate, options.config.num_threads);
+  }
+  return true;
+}
+
+static char const* particle_mode_name (void)
+{
+  switch (PARTICLE_MODE)
+  {
+  case PARTICLE_MODE_POOL:     return "POOL";
+  case PARTICLE_MODE_ANALYTIC: return "ANALYTIC";
+  case PARTICLE_MODE_RING:     return "RING";
+  }
+  return "?";
+}
+
+
+// BENCHMARK
+
+/// @brief measured totals over every measured frame
+struct bench_totals_t
+{
+  double             update_seconds = 0.0;
+  double             render_seconds = 0.0;
+  unsigned long long num_active = 0u;      // sum of each frame's active particles
+  unsigned long long num_drawn = 0u;       // sum of each frame's points drawn
+  double             step_sum = 0.0;       // sum of each frame's distances between consecutive points
+  unsigned           num_frames_at_max = 0u;
+  double             frame_seconds_squared = 0.0; // sum of each frame's (update + render) squared, for the spread
+  uint64_t           checksum = 0u;
+
+  unsigned long long num_allocations = 0u; // heap allocations, see alloc_tracker.h
+  unsigned long long num_allocated_bytes = 0u;
+
+  double             raster_seconds = 0.0;  // included in render_seconds
+  bool               is_measuring = false;  // false during the warm-up
+};
+
+/// @brief the software rasteriser, as the headless point renderer's backend
+struct bench_raster_t
+{
+  software_rasteriser_t rasteriser;
+  bench_totals_t*       totals = nullptr;
+};
+
+static void raster_backend (pigeon::gfx::headless::point_vertex_t const* points, unsigned long long num_points, void* user_data)
+{
+  bench_raster_t& raster = *(bench_raster_t*)user_data;
+  std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now ();
+  {
+    TRACE_ZONE ("raster");
+    raster.rasteriser.splat (points, num_points);
+  }
+  if (raster.totals->is_measuring)
+  {
+    raster.totals->raster_seconds += std::chrono::duration <double> (std::chrono::steady_clock::now () - start).count ();
+  }
+}
+
+int main (int argc, char** argv)
+{
+  bench_options_t options;
+  if (!parse_options (argc, argv, options))
+  {
+    return 1;
+  }
+
+  pigeon::gfx::driver::headless::screen_size = { options.screen_width, options.screen_height };
+
+  // competing load, see --load
+  std::atomic <bool> is_loaded { false };
+  std::atomic <bool> is_finished { false };
+  std::vector <std::thread> load_threads;
+  for (unsigned i = 0u; i < options.num_load_threads; ++i)
+  {
+    load_threads.emplace_back ([&] ()
+    {
+      volatile unsigned long long spin = 0u;
+      while (!is_finished.load (std::memory_order_relaxed))
+      {
+        if (is_loaded.load (std::memory_order_relaxed))
+        {
+          spin = spin + 1u;
+        }
+        else
+        {
+          std::this_thread::yield ();
+        }
+      }
+    });
+  }
+  auto const stop_load = [&] ()
+  {
+    is_finished = true;
+    for (std::thread& t : load_threads)
+    {
+      t.join ();
+    }
+  };
+
+  telemetry_log.start ([] (char const* text, void*) { cuckoo::printf ("%s", text); }, nullptr);
+
+  // opened before the rasteriser & the particle system start their workers, so those are counted (the load threads
+  // & the telemetry log's thread, started above, are not), the warm-up's counts are cleared when it ends
+  if (options.is_perf_counted)
+  {
+    perf_profile.open ();
+  }
+
+  bench_totals_t totals;
+  bench_raster_t raster;
+  if (options.is_rasterised)
+  {
+    // clear to the same colour as SHOT2's driver descriptor
+    raster.rasteriser.set_clear_colour (0.f, 0.f, 0.f, 1.f);
+    // sized for as many points as the particle system will draw, so splat never allocates
+    particle_config_t capacity = options.config;
+    particle_config_validate (capacity);
+    raster.rasteriser.initialise (options.screen_width, options.screen_height, capacity.max_particles, options.config.num_threads);
+    raster.totals = &totals;
+    // must be installed before the particle system's point renderer is initialised
+    pigeon::gfx::headless::backend = raster_backend;
+    pigeon::gfx::headless::backend_user_data = &raster;
+  }
+
+  particle_system_t particle_system;
+  if (!particle_system.initialise (options.config))
+  {
+    std::printf ("particle_system.initialise failed\n");
+    stop_load ();
+    return 1;
+  }
+
+  particle_config_t const config = particle_system.get_config (); // as initialised, the governor may change the live one
+
+  // the warmed up world, see --checkpoint-load & --checkpoint-save
+  double checkpoint_load_seconds = 0.0;
+  double checkpoint_save_seconds = 0.0;
+  bool is_checkpoint_saved = false;
+  if (options.checkpoint_load_path)
+  {
+    std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now ();
+    if (!particle_system.load_checkpoint (options.checkpoint_load_path))
+    {
+      std::printf ("could not load checkpoint %s\n", options.checkpoint_load_path);
+      stop_load ();
+      return 1;
+    }
+    checkpoint_load_seconds = std::chrono::duration <double> (std::chrono::steady_clock::now () - start).count ();
+  }
+
+  frame_governor_t governor;
+  governor.initialise (config);
+
+  // the per-frame logging is not part of what is being measured, but queuing it for the telemetry log's thread is
+  cuckoo::headless::mute_printf = true;
+
+  using clock_t = std::chrono::steady_clock;
+  frame_context_t frame_context;
+
+  // exactly one tick of --dt per frame, drawn as it is, so every frame does the same work & the checksum stays comparable
+  fixed_timestep_t timestep;
+  timestep.initialise (1.0 / options.elapsed_seconds, 1u, false);
+  long long num_active_particles = 0;
+
+  for (unsigned frame = 0u; frame < options.num_warmup_frames + options.num_frames; ++frame)
+  {
+    totals.is_measuring = frame >= options.num_warmup_frames;
+    // saved before anything is measured, counted or traced
+    if (options.checkpoint_save_path && frame == options.num_warmup_frames)
+    {
+      clock_t::time_point const start = clock_t::now ();
+      is_checkpoint_saved = particle_system.save_checkpoint (options.checkpoint_save_path);
+      checkpoint_save_seconds = std::chrono::duration <double> (clock_t::now () - start).count ();
+    }
+    if (options.trace_path && frame == options.num_warmup_frames)
+    {
+      trace_set_lane (TRACE_LANE_MAIN, "main");
+      trace_start (1u << 22);
+    }
+    if (options.is_perf_counted && frame == options.num_warmup_frames)
+    {
+      perf_profile.clear ();
+    }
+    if (options.is_zero_alloc && frame == options.num_warmup_frames)
+    {
+      alloc_tracker.enforce_after (0u);
+    }
+    TRACE_ZONE ("frame");
+    is_loaded = frame >= options.num_warmup_frames + options.num_frames / 2u;
+
+    clock_t::time_point const update_start = clock_t::now ();
+    {
+      TRACE_ZONE ("update");
+      ALLOC_ZONE ("update");
+      perf_zone_t perf_zone ("update");
+      frame_context_capture (frame_context);
+      timestep.advance (options.elapsed_seconds);
+      particle_system.update (frame_context, timestep, num_active_particles);
+      perf_zone.set_entities ((unsigned long long)num_active_particles);
+    }
+    clock_t::time_point const render_start = clock_t::now ();
+    {
+      TRACE_ZONE ("render");
+      ALLOC_ZONE ("render");
+      perf_zone_t const perf_zone ("render", (unsigned long long)num_active_particles);
+      particle_system.render ();
+    }
+    clock_t::time_point const render_end = clock_t::now ();
+
+    double const update_seconds = std::chrono::duration <double> (render_start - update_start).count ();
+    double const render_seconds = std::chrono::duration <double> (render_end - render_start).count ();
+    if (governor.end_frame (particle_system.get_simulate_seconds (), render_seconds)) // as SHOT2 does, see main.cpp
+    {
+      particle_system.set_work_split (governor.get_spawn_rate (), governor.get_num_threads ());
+    }
+    perf_profile.end_frame ();
+    alloc_tracker.end_frame (); // violations are counted, and reported below
+
+    if (frame < options.num_warmup_frames)
+    {
+      continue;
+    }
+
+    totals.update_seconds += update_seconds;
+    totals.render_seconds += render_seconds;
+    totals.frame_seconds_squared += (update_seconds + render_seconds) * (update_seconds + render_seconds);
+    totals.num_active += (unsigned long long)num_active_particles;
+    totals.num_allocations += alloc_tracker.get_last_frame ().num_allocations;
+    totals.num_allocated_bytes += alloc_tracker.get_last_frame ().num_bytes;
+    totals.num_drawn += pigeon::gfx::headless::last_batch.num_points;
+    totals.step_sum += pigeon::gfx::headless::last_batch.step_sum;
+    totals.num_frames_at_max += num_active_particles == config.max_particles ? 1u : 0u;
+    totals.checksum = (totals.checksum ^ pigeon::gfx::headless::last_batch.checksum) * 0x100000001b3ull;
+  }
+
+  stop_load ();
+
+  particle_reorder_stats_t const reorder_stats = particle_system.get_reorder_stats ();
+  particle_system.release ();
+  telemetry_log.stop ();
+  trace_stop ();
+  cuckoo::headless::mute_printf = false;
+
+  bool const is_traced = options.trace_path && trace_write (options.trace_path, "shot2_bench");
+
+  bool is_dumped = false;
+  if (options.dump_path)
+  {
+    is_dumped = raster.rasteriser.write_image (options.dump_path);
+  }
+  pigeon::gfx::headless::backend = nullptr;
+
+
+  // REPORT
+
+  double const num_frames = (double)options.num_frames;
+  double const average_active = (double)totals.num_active / num_frames;
+  double const update_ns = totals.num_active ? totals.update_seconds * 1e9 / (double)totals.num_active : 0.0;
+  double const render_ns = totals.num_drawn ? totals.render_seconds * 1e9 / (double)totals.num_drawn : 0.0;
+  double const mean_step = totals.num_drawn > options.num_frames ? totals.step_sum / (double)(totals.num_drawn - options.num_frames) : 0.0;
+  double const frame_ns = totals.num_active ? (totals.update_seconds + totals.render_seconds) * 1e9 / (double)totals.num_active : 0.0;
+
+  std::printf ("SHOT2 headless benchmark\n");
+  std::printf ("  threads     : %u\n", config.num_threads);
+  std::printf ("  particles   : %u capacity, %u spawned per frame, %s pages\n", config.max_particles, config.spawn_rate, page_mode_name (config.page_mode));
+  std::printf ("  mode        : %s, fused pack %s, pipelined %s\n", particle_mode_name (), PARTICLE_FUSED_PACK ? "on" : "off", PARTICLE_PIPELINED ? "on" : "off");
+  std::printf ("  affectors   : %s%s%s%s(%s gather)\n", config.affectors ? "" : "none ",
+    config.affectors & PARTICLE_AFFECTOR_WIND ? "wind " : "", config.affectors & PARTICLE_AFFECTOR_VORTEX ? "vortex " : "",
+    config.affectors & PARTICLE_AFFECTOR_TURBULENCE ? "turbulence " : "", FORCE_FIELD_USE_AVX2 ? "AVX2" : "scalar");
+  std::printf ("  frames      : %u measured (+%u warm-up), dt %.5f s, screen %ux%u\n",
+    options.num_frames, options.num_warmup_frames, options.elapsed_seconds, options.screen_width, options.screen_height);
+  std::printf ("  active      : %.0f average of %u (%.1f%%), at capacity on %u/%u frames\n",
+    average_active, config.max_particles, 100.0 * average_active / (double)config.max_particles, totals.num_frames_at_max, options.num_frames);
+  std::printf ("  update      : %.3f ms/frame, %.3f ns/particle%s\n",
+    totals.update_seconds * 1e3 / num_frames, update_ns, PARTICLE_PIPELINED ? " (time left waiting for the overlapped update)" : "");
+  std::printf ("  render pack : %.3f ms/frame, %.3f ns/point\n", totals.render_seconds * 1e3 / num_frames, render_ns);
+  double const frame_mean = (totals.update_seconds + totals.render_seconds) / num_frames;
+  double const frame_spread = std::sqrt (cuckoo::maths::max (totals.frame_seconds_squared / num_frames - frame_mean * frame_mean, 0.0));
+  std::printf ("  frame       : %.3f ms/frame (+/- %.3f ms), %.3f ns/particle\n", frame_mean * 1e3, frame_spread * 1e3, frame_ns);
+  if (governor.is_enabled ())
+  {
+    std::printf ("  governor    : %.2f ms budget, %u decisions, settled at %u spawned per frame & %u workers%s\n",
+      config.frame_budget_ms, governor.get_num_decisions (), governor.get_spawn_rate (), governor.get_num_threads (),
+      options.num_load_threads ? " (loaded over the second half)" : "");
+  }
+  std::printf ("  locality    : %.2f pixels between consecutive points\n", mean_step);
+  if (reorder_stats.num_reorders > 0u)
+  {
+    // includes the warm-up, the sorts' cost is spread over every frame that was run
+    double const frames_run = (double)(options.num_warmup_frames + options.num_frames);
+    std::printf ("  reorder     : every %u frames, %u sorts, %.3f ms each, %.3f ms/frame amortised, %.3f ns/particle sorted\n",
+      config.reorder_interval, reorder_stats.num_reorders, reorder_stats.seconds * 1e3 / reorder_stats.num_reorders,
+      reorder_stats.seconds * 1e3 / frames_run, reorder_stats.seconds * 1e9 / (double)cuckoo::maths::max (reorder_stats.num_sorted, 1ull));
+  }
+  if (options.is_rasterised)
+  {
+    double const raster_ns = totals.num_drawn ? totals.raster_seconds * 1e9 / (double)totals.num_drawn : 0.0;
+    std::printf ("  raster      : %.3f ms/frame, %.3f ns/point, %ux%u, %u workers\n",
+      totals.raster_seconds * 1e3 / num_frames, raster_ns, options.screen_width, options.screen_height, config.num_threads);
+  }
+  if (options.is_perf_counted)
+  {
+    perf_profile.report ([] (char const* text, void*) { std::printf ("  perf        : %s", text); }, nullptr);
+  }
+  std::printf ("  allocations : %.1f/frame, %.0f bytes/frame%s\n", (double)totals.num_allocations / num_frames, (double)totals.num_allocated_bytes / num_frames,
+    !options.is_zero_alloc ? "" : alloc_tracker.get_num_violations () ? ", zero allocation check FAILED" : ", zero allocation check passed");
+  std::printf ("  telemetry   : %llu records written, %llu dropped\n", telemetry_log.get_num_written (), telemetry_log.get_num_dropped ());
+  if (options.checkpoint_load_path)
+  {
+    std::printf ("  checkpoint  : loaded from %s in %.3f ms\n", options.checkpoint_load_path, checkpoint_load_seconds * 1e3);
+  }
+  if (options.checkpoint_save_path)
+  {
+    std::printf ("  checkpoint  : %s %s in %.3f ms\n", is_checkpoint_saved ? "saved to" : "FAILED to save to", options.checkpoint_save_path,
+      checkpoint_save_seconds * 1e3);
+  }
+  std::printf ("  checksum    : %016llx\n", (unsigned long long)totals.checksum);
+  if (options.trace_path)
+  {
+    std::printf ("  trace       : %s %s, %llu events (%llu dropped)\n", is_traced ? "written to" : "FAILED to write", options.trace_path,
+      (unsigned long long)trace_num_recorded (), (unsigned long long)trace_num_dropped ());
+  }
+  if (options.dump_path)
+  {
+    std::printf ("  last frame  : %s %s\n", is_dumped ? "written to" : "FAILED to write", options.dump_path);
+  }
+  std::printf ("csv,threads,mode,particles,pages,reorder,affectors,frames,dt,average_active,update_ns,render_ns,frame_ns,mean_step,checksum\n");
+  std::printf ("csv,%u,%s,%u,%s,%u,%u,%u,%.5f,%.0f,%.3f,%.3f,%.3f,%.2f,%016llx\n",
+    config.num_threads, particle_mode_name (), config.max_particles, page_mode_name (config.page_mode), config.reorder_interval, config.affectors, options.num_frames, options.elapsed_seconds, average_active, update_ns, render_ns, frame_ns, mean_step, (unsigned long long)totals.checksum);
+
+  raster.rasteriser.release ();
+  bool const is_zero_alloc_failed = options.is_zero_alloc && alloc_tracker.get_num_violations () > 0u;
+  return (options.dump_path && !is_dumped) || (options.trace_path && !is_traced) || is_zero_alloc_failed ? 1 : 0;
+}
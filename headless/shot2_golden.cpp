@@ -0,0 +1,326 @@
+// SHOT2 GOLDEN TRACE:
+//
+// A determinism check of SHOT2's particle update (see common/golden_trace.h).
+// 2 copies of the same particle pool are run side by side, from the same seed & the same emission:
+//   reference | one particle at a time: the force field sampled with plain scalar code, then particle_process
+//   variant   | what the pool actually runs: process_chunk (blocks of particles, force_field_apply's batched gathers)
+//             | over the pool split between --threads workers
+// After every frame's update, every particle's position, velocity & life in the 2 pools is compared, within --tolerance,
+// then both pools are compacted & topped up by the same (scalar) code, so they only ever differ by what the update did.
+// The run reports the first frame & particle that diverged, and exits with 1 if any did.
+//
+// With --record, the variant's per frame hashes are written out, --compare checks this build's against them,
+// e.g. to check a -march=native (SHOT2_BENCH_NATIVE) build, or a new variant, against a known good build's trace.
+
+
+#include "cuckoo/core/logger.h"        // for cuckoo::headless::mute_printf
+#include "pigeon/gfx/driver.h"         // for pigeon::gfx::driver::headless::screen_size
+
+#include "particle_config.h"           // for particle_config_t, particle_affectors_from_names
+#include "frame_context.h"             // for frame_context_t, frame_context_capture
+#include "particle.h"                  // for particle, particle_process, particle_is_dead, emit
+#include "force_field.h"               // for force_field_t, force_field_build
+#include "particle_system.h"           // for process_chunk, particle_chunk_t
+
+#include "../common/golden_trace.h"    // for golden_checker_t, golden_hash_t, golden_trace_write, golden_trace_read
+#include "../common/random.h"          // for random_t, random_seed
+
+#include <cstdio>                      // for std::printf, std::snprintf
+#include <cstdlib>                     // for std::strtoul, std::strtod, std::strtoull
+#include <cstring>                     // for std::strcmp, std::strlen
+#include <functional>                  // for std::ref
+#include <thread>                      // for std::thread
+#include <vector>                      // for std::vector
+
+
+// OPTIONS
+
+struct golden_options_t
+{
+  unsigned           num_frames = 600u;
+  double             elapsed_seconds = 1.0 / 60.0;
+  unsigned           screen_width = 1280u;
+  unsigned           screen_height = 720u;
+  unsigned           max_particles = 1u << 16;  // small enough to compare every particle every frame quickly
+  unsigned           spawn_rate = 1u << 11;
+  unsigned           num_threads = NUM_THREADS;
+  unsigned           affectors = PARTICLE_AFFECTOR_WIND | PARTICLE_AFFECTOR_VORTEX | PARTICLE_AFFECTOR_TURBULENCE;
+  unsigned long long seed = PARTICLE_SEED;
+  double             tolerance = 1e-5;
+  char const*        record_path = nullptr;     // write the variant's per frame hashes here
+  char const*        compare_path = nullptr;    // check the variant's per frame hashes against these
+};
+
+static void print_usage (char const* name)
+{
+  std::printf ("usage: %s [--frames N] [--dt SECONDS] [--width PIXELS] [--height PIXELS] [--particles N] [--spawn-rate N]\n", name);
+  std::printf ("       %*s [--threads N] [--affectors wind,vortex,turbulence|none] [--seed N] [--tolerance T] [--record FILE] [--compare FILE]\n", (int)std::strlen (name), "");
+  std::printf ("  --frames     frames compared (default 600)\n");
+  std::printf ("  --dt         fixed time step of every frame (default 1/60)\n");
+  std::printf ("  --width      screen width the emitters & force field are placed for (default 1280)\n");
+  std::printf ("  --height     screen height the emitters & force field are placed for (default 720)\n");
+  std::printf ("  --particles  pool capacity (default 65536)\n");
+  std::printf ("  --spawn-rate particles emitted per frame (default 2048)\n");
+  std::printf ("  --threads    workers the variant's update is split between (default NUM_THREADS)\n");
+  std::printf ("  --affectors  force fields, sampled by both (default wind,vortex,turbulence)\n");
+  std::printf ("  --seed       seed of the emission (default PARTICLE_SEED)\n");
+  std::printf ("  --tolerance  largest difference allowed, relative to the larger value (at least 1), 0 for exact (default 1e-5)\n");
+  std::printf ("  --record     write the variant's per frame hashes to FILE\n");
+  std::printf ("  --compare    check the variant's per frame hashes against a trace written by --record\n");
+}
+
+/// @return false if the program should exit, without running the check
+static bool parse_options (int argc, char** argv, golden_options_t& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    char const* name = argv [i];
+    char const* value = i + 1 < argc ? argv [i + 1] : nullptr;
+
+    if (std::strcmp (name, "--help") == 0 || std::strcmp (name, "-h") == 0)
+    {
+      print_usage (argv [0]);
+      return false;
+    }
+    if (!value)
+    {
+      std::printf ("missing value for %s\n", name);
+      print_usage (argv [0]);
+      return false;
+    }
+
+    if (std::strcmp (name, "--frames") == 0)          options.num_frames = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--dt") == 0)         options.elapsed_seconds = std::strtod (value, nullptr);
+    else if (std::strcmp (name, "--width") == 0)      options.screen_width = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--height") == 0)     options.screen_height = (unsigned)std::strtoul (value, nullptr, 10);
+    else if (std::strcmp (name, "--particles") == 0)  options.max_particles = (unsigned)std::strtoul (value, nullptr, 0);
+    else if (std::strcmp (name, "--spawn-rate") == 0) options.spawn_rate = (unsigned)std::strtoul (value, nullptr, 0);
+    else if (std::strcmp (name, "--threads") == 0)    options.num_threads = (unsigned)std::strtoul (value, nullptr, 0);
+    else if (std::strcmp (name, "--seed") == 0)       options.seed = std::strtoull (value, nullptr, 0);
+    else if (std::strcmp (name, "--tolerance") == 0)  options.tolerance = std::strtod (value, nullptr);
+    else if (std::strcmp (name, "--record") == 0)     options.record_path = value;
+    else if (std::strcmp (name, "--compare") == 0)    options.compare_path = value;
+    else if (std::strcmp (name, "--affectors") == 0)
+    {
+      if (!particle_affectors_from_names (value, options.affectors))
+      {
+        std::printf ("unknown affector in %s\n", value);
+        return false;
+      }
+    }
+    else
+    {
+      std::printf ("unknown option %s\n", name);
+      print_usage (argv [0]);
+      return false;
+    }
+    ++i;
+  }
+
+  if (options.num_frames == 0u || options.elapsed_seconds <= 0.0 || options.screen_width == 0u || options.screen_height == 0u
+    || options.max_particles == 0u || options.spawn_rate == 0u || options.num_threads == 0u || options.num_threads > MAX_THREADS)
+  {
+    std::printf ("--frames, --dt, --width, --height, --particles & --spawn-rate must all be greater than 0, --threads 1 to %u\n", MAX_THREADS);
+    return false;
+  }
+  return true;
+}
+
+
+// WORLDS
+
+/// @brief one of the 2 particle pools
+struct golden_world_t
+{
+  std::vector <particle> particles;
+  unsigned               count = 0u;
+  random_t               random;       // the emission's stream, seeded the same for both worlds
+};
+
+/// @brief REFERENCE: the force field's acceleration at one particle, bilinearly sampled one node at a time
+static void reference_apply_field (force_field_t const& field, particle& p, float elapsed_seconds)
+{
+  float const max_node = (float)force_field_t::NUM_CELLS - .001f;
+  float const node_x = cuckoo::maths::min (cuckoo::maths::max ((p.position_x - field.origin_x) * field.nodes_per_pixel_x, 0.f), max_node);
+  float const node_y = cuckoo::maths::min (cuckoo::maths::max ((p.position_y - field.origin_y) * field.nodes_per_pixel_y, 0.f), max_node);
+  unsigned const column = (unsigned)node_x;
+  unsigned const row = (unsigned)node_y;
+  float const weight_x = node_x - (float)column;
+  float const weight_y = node_y - (float)row;
+
+  auto sample = [&] (float const* acceleration)
+  {
+    float const bottom = cuckoo::maths::lerp (acceleration [force_field_t::slot (column, row)], acceleration [force_field_t::slot (column + 1u, row)], weight_x);
+    float const top = cuckoo::maths::lerp (acceleration [force_field_t::slot (column, row + 1u)], acceleration [force_field_t::slot (column + 1u, row + 1u)], weight_x);
+    return cuckoo::maths::lerp (bottom, top, weight_y);
+  };
+  p.velocity_x += sample (field.acceleration_x) * elapsed_seconds;
+  p.velocity_y += sample (field.acceleration_y) * elapsed_seconds;
+}
+
+/// @brief REFERENCE: update every particle in turn
+static void reference_update (golden_world_t& world, particle_type_info_t const* types, force_field_t const* field, float elapsed_seconds)
+{
+  for (unsigned i = 0u; i < world.count; ++i)
+  {
+    particle& p = world.particles [i];
+    if (field)
+    {
+      reference_apply_field (*field, p, elapsed_seconds);
+    }
+    particle_process (p, types, elapsed_seconds);
+  }
+}
+
+/// @brief VARIANT: the pool's update, process_chunk over 'num_threads' chunks, one worker each
+static void variant_update (golden_world_t& world, particle_type_info_t const* types, force_field_t const* field, float elapsed_seconds,
+  unsigned num_threads)
+{
+  particle_chunk_t chunks [MAX_THREADS];
+  std::vector <std::thread> threads;
+  unsigned const chunk_size = (world.count + num_threads - 1u) / num_threads;
+  for (unsigned i = 0u; i < num_threads; ++i)
+  {
+    chunks [i].begin = cuckoo::maths::min (i * chunk_size, world.count);
+    chunks [i].end = cuckoo::maths::min (chunks [i].begin + chunk_size, world.count);
+    threads.emplace_back (process_chunk, world.particles.data (), types, std::ref (chunks [i]), field, elapsed_seconds);
+  }
+  for (std::thread& thread : threads)
+  {
+    thread.join ();
+  }
+}
+
+/// @brief BOTH: keep the survivors in order, then emit up to the spawn rate
+static void compact_and_emit (golden_world_t& world, particle_type_info_t const* types, unsigned spawn_rate)
+{
+  unsigned num_survivors = 0u;
+  for (unsigned i = 0u; i < world.count; ++i)
+  {
+    if (!particle_is_dead (world.particles [i], types))
+    {
+      world.particles [num_survivors++] = world.particles [i];
+    }
+  }
+  unsigned const num_emitted = cuckoo::maths::min (spawn_rate, (unsigned)world.particles.size () - num_survivors);
+  emit (world.random, world.particles.data (), nullptr, types, num_survivors, num_emitted);
+  world.count = num_survivors + num_emitted;
+}
+
+static uint64_t hash_world (golden_world_t const& world)
+{
+  golden_hash_t hash;
+  hash.add (world.count);
+  for (unsigned i = 0u; i < world.count; ++i)
+  {
+    particle const& p = world.particles [i];
+    hash.add (p.position_x);
+    hash.add (p.position_y);
+    hash.add (p.velocity_x);
+    hash.add (p.velocity_y);
+    hash.add (p.life_remaining);
+    hash.add (p.type);
+  }
+  return hash.value;
+}
+
+
+int main (int argc, char** argv)
+{
+  golden_options_t options;
+  if (!parse_options (argc, argv, options))
+  {
+    return 1;
+  }
+  cuckoo::headless::mute_printf = true;
+
+  pigeon::gfx::driver::headless::screen_size = { options.screen_width, options.screen_height };
+  frame_context_t frame_context;
+  frame_context_capture (frame_context);
+  particle_type_info_t const* types = frame_context.particle_types;
+
+  force_field_t field;
+  force_field_build (field, options.affectors, options.screen_width, options.screen_height);
+  force_field_t const* field_used = options.affectors ? &field : nullptr;
+
+  golden_world_t reference;
+  golden_world_t variant;
+  for (golden_world_t* world : { &reference, &variant })
+  {
+    world->particles.resize (options.max_particles);
+    random_seed (world->random, options.seed, 0u);
+    compact_and_emit (*world, types, options.spawn_rate);
+  }
+
+  std::printf ("SHOT2 golden trace: %u frames of %u particles (%u emitted per frame), affectors %u, %u worker(s), dt %g, seed %llu, AVX2 gathers %s\n",
+    options.num_frames, options.max_particles, options.spawn_rate, options.affectors, options.num_threads,
+    options.elapsed_seconds, options.seed, FORCE_FIELD_USE_AVX2 ? "on" : "off");
+
+  golden_checker_t checker (options.tolerance);
+  float const elapsed_seconds = (float)options.elapsed_seconds;
+  for (unsigned frame = 0u; frame < options.num_frames; ++frame)
+  {
+    reference_update (reference, types, field_used, elapsed_seconds);
+    variant_update (variant, types, field_used, elapsed_seconds, options.num_threads);
+
+    checker.begin_frame (frame);
+    checker.compare ("pool", 0u, "count", reference.count, variant.count);
+    unsigned const count = cuckoo::maths::min (reference.count, variant.count);
+    for (unsigned i = 0u; i < count; ++i)
+    {
+      particle const& r = reference.particles [i];
+      particle const& v = variant.particles [i];
+      checker.compare ("particle", i, "position_x", r.position_x, v.position_x);
+      checker.compare ("particle", i, "position_y", r.position_y, v.position_y);
+      checker.compare ("particle", i, "velocity_x", r.velocity_x, v.velocity_x);
+      checker.compare ("particle", i, "velocity_y", r.velocity_y, v.velocity_y);
+      checker.compare ("particle", i, "life_remaining", r.life_remaining, v.life_remaining);
+      checker.compare ("particle", i, "type", r.type, v.type);
+    }
+    checker.end_frame (hash_world (reference), hash_world (variant));
+
+    compact_and_emit (reference, types, options.spawn_rate);
+    compact_and_emit (variant, types, options.spawn_rate);
+  }
+
+  auto print = [] (char const* text, void*) { std::printf ("  %s", text); };
+  checker.report (print, nullptr);
+  bool is_failed = checker.has_diverged ();
+
+  // the trace is named after everything that decides what is simulated, but not the workers, which must not change it
+  char trace_name [256];
+  std::snprintf (trace_name, sizeof (trace_name), "SHOT2 particles %u spawn-rate %u affectors %u dt %g seed %llu size %ux%u",
+    options.max_particles, options.spawn_rate, options.affectors, options.elapsed_seconds, options.seed, options.screen_width, options.screen_height);
+  if (options.record_path)
+  {
+    bool const is_recorded = golden_trace_write (options.record_path, trace_name, checker.get_variant_hashes ());
+    std::printf ("  record      : %s %s\n", is_recorded ? "wrote" : "FAILED to write", options.record_path);
+    is_failed |= !is_recorded;
+  }
+  if (options.compare_path)
+  {
+    std::vector <uint64_t> expected;
+    if (!golden_trace_read (options.compare_path, trace_name, expected))
+    {
+      std::printf ("  compare     : FAILED to read %s, or it was recorded with other options\n", options.compare_path);
+      is_failed = true;
+    }
+    else
+    {
+      std::vector <uint64_t> const& actual = checker.get_variant_hashes ();
+      unsigned const first_difference = golden_trace_first_difference (expected, actual);
+      unsigned const num_compared = (unsigned)cuckoo::maths::min (expected.size (), actual.size ());
+      if (first_difference < num_compared)
+      {
+        std::printf ("  compare     : DIVERGED from %s at frame %u (of %u)\n", options.compare_path, first_difference, num_compared);
+        is_failed = true;
+      }
+      else
+      {
+        std::printf ("  compare     : MATCH, %u frames bit identical to %s\n", num_compared, options.compare_path);
+      }
+    }
+  }
+
+  return is_failed ? 1 : 0;
+}
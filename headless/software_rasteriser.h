@@ -0,0 +1,360 @@
+// SOFTWARE RASTERISER:
+//
+// A CPU backend for the headless point renderer (see include/pigeon/gfx/point_renderer.h).
+// Every point covers a single pixel, as it does with pigeon's point_renderer,
+// and is alpha blended over the pixel in submission order into a float RGBA framebuffer.
+// The framebuffer can be written out as a PPM or PNG image, to compare an optimised build against the reference by eye
+// (or by diffing the images), and the cost of splatting a full PARTICLE_MAX batch makes a realistic render load for the benchmarks.
+//
+// Threading: the framebuffer is split into horizontal bands, one per worker, so no two workers ever write the same pixel.
+// The points are binned by band first, with the same count / exclusive prefix sum / scatter as the particle pool's compaction,
+// so each band still sees its points in submission order and the blended result does not depend on the number of workers.
+//   1. COUNT   | each worker counts how many of its chunk of points land in each band (off screen points are culled)
+//   2. SUM     | exclusive prefix sum, band major, gives each (band, chunk) its offset in the binned index buffer
+//   3. SCATTER | each worker writes the indices of its chunk's points, with the pixel each covers, into the bins
+//   4. SPLAT   | each worker clears its band & blends the band's points, one pixel per point (SSE2, all 4 channels at once)
+
+
+#pragma once
+
+#include "cuckoo/core/asserts.h"       // for CUCKOO_ASSERT
+#include "cuckoo/maths/maths.h"        // for cuckoo::maths::min, cuckoo::maths::max
+#include "pigeon/gfx/point_renderer.h" // for pigeon::gfx::headless::point_vertex_t
+
+#include "../common/trace.h"           // for TRACE_LANE_RASTER
+#include "../common/worker_pool.h"     // for worker_pool_t
+
+#include <cstdint>                     // for uint8_t, uint32_t
+#include <cstdio>                      // for std::fopen, std::fwrite, std::fclose
+#include <cstring>                     // for std::strlen, std::strcmp
+#include <vector>                      // for std::vector
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTERISER_USE_SSE2 1
+#include <emmintrin.h>                 // for __m128, _mm_*
+#else
+#define RASTERISER_USE_SSE2 0
+#endif
+
+
+/// @brief one framebuffer pixel, straight (not premultiplied) alpha
+struct alignas (16) raster_pixel_t
+{
+  float r;
+  float g;
+  float b;
+  float a;
+};
+
+/// @brief one point in the bins, with the pixel COUNT found it covers, so SPLAT does not work it out again
+struct raster_binned_t
+{
+  unsigned point;
+  unsigned pixel;
+};
+
+/// @brief see 'SOFTWARE RASTERISER' above
+class software_rasteriser_t
+{
+public:
+  static unsigned const MAX_THREADS = 64u;
+
+  /// @param width, height framebuffer size in pixels, the screen origin is at its centre with +ve y up, as in pigeon
+  /// @param max_points the most points a splat is given, the binning buffers are sized for them here, once
+  /// @param num_threads workers (& framebuffer bands) used by splat
+  bool initialise (unsigned width_, unsigned height_, unsigned max_points, unsigned num_threads_)
+  {
+    if (width_ == 0u || height_ == 0u || num_threads_ == 0u)
+    {
+      return false;
+    }
+    width = width_;
+    height = height_;
+    num_threads = cuckoo::maths::min (cuckoo::maths::min (num_threads_, MAX_THREADS), height);
+    workers.initialise (num_threads, TRACE_LANE_RASTER, "raster");
+    framebuffer.assign ((size_t)width * height, { clear_colour.r, clear_colour.g, clear_colour.b, clear_colour.a });
+    binned.resize (max_points);
+    pixel_of.resize (max_points);
+    return true;
+  }
+
+  /// @brief the colour every pixel is reset to at the start of each splat
+  void set_clear_colour (float r, float g, float b, float a)
+  {
+    clear_colour = { r, g, b, a };
+  }
+
+  /// @brief clear the framebuffer and blend every point into it, in order
+  /// @param num_points at most the max_points given to initialise
+  void splat (pigeon::gfx::headless::point_vertex_t const* points, unsigned long long num_points)
+  {
+    CUCKOO_ASSERT (num_points <= binned.size ());
+    unsigned const count = (unsigned)num_points;
+
+    unsigned const chunk_size = (count + num_threads - 1u) / num_threads;
+    unsigned const band_height = (height + num_threads - 1u) / num_threads;
+
+    // 1. COUNT
+    run_workers ([&] (unsigned worker)
+    {
+      unsigned* counts = bin_counts [worker];
+      for (unsigned band = 0u; band < num_threads; ++band)
+      {
+        counts [band] = 0u;
+      }
+
+      unsigned const begin = cuckoo::maths::min (worker * chunk_size, count);
+      unsigned const end = cuckoo::maths::min (begin + chunk_size, count);
+      for (unsigned i = begin; i < end; ++i)
+      {
+        unsigned pixel = OFF_SCREEN;
+        if (!pixel_index (points [i], pixel))
+        {
+          pixel_of [i] = OFF_SCREEN;
+          continue;
+        }
+        pixel_of [i] = pixel;
+        ++counts [(pixel / width) / band_height];
+      }
+    });
+
+    // 2. SUM
+    unsigned offset = 0u;
+    for (unsigned band = 0u; band < num_threads; ++band)
+    {
+      band_begin [band] = offset;
+      for (unsigned chunk = 0u; chunk < num_threads; ++chunk)
+      {
+        bin_offsets [chunk][band] = offset;
+        offset += bin_counts [chunk][band];
+      }
+    }
+    band_begin [num_threads] = offset;
+
+    // 3. SCATTER
+    run_workers ([&] (unsigned worker)
+    {
+      unsigned* offsets = bin_offsets [worker];
+      unsigned const begin = cuckoo::maths::min (worker * chunk_size, count);
+      unsigned const end = cuckoo::maths::min (begin + chunk_size, count);
+      for (unsigned i = begin; i < end; ++i)
+      {
+        unsigned const pixel = pixel_of [i];
+        if (pixel != OFF_SCREEN)
+        {
+          binned [offsets [(pixel / width) / band_height]++] = { i, pixel };
+        }
+      }
+    });
+
+    // 4. SPLAT
+    run_workers ([&] (unsigned band)
+    {
+      unsigned const first_row = cuckoo::maths::min (band * band_height, height);
+      unsigned const last_row = cuckoo::maths::min (first_row + band_height, height);
+      raster_pixel_t const clear = { clear_colour.r, clear_colour.g, clear_colour.b, clear_colour.a };
+      for (size_t p = (size_t)first_row * width; p < (size_t)last_row * width; ++p)
+      {
+        framebuffer [p] = clear;
+      }
+
+      for (unsigned i = band_begin [band]; i < band_begin [band + 1u]; ++i)
+      {
+        raster_binned_t const& bin = binned [i];
+        blend (framebuffer [bin.pixel], points [bin.point].colour);
+      }
+    });
+  }
+
+  /// @brief write the framebuffer to 'path', as a PNG if the path ends in ".png", otherwise as a binary PPM
+  /// @return false if the file could not be written
+  bool write_image (char const* path) const
+  {
+    size_t const length = std::strlen (path);
+    bool const is_png = length >= 4u && std::strcmp (path + length - 4u, ".png") == 0;
+
+    // 8 bit RGB, top row first
+    std::vector <uint8_t> rgb ((size_t)width * height * 3u);
+    for (size_t p = 0u; p < framebuffer.size (); ++p)
+    {
+      rgb [p * 3u + 0u] = to_byte (framebuffer [p].r);
+      rgb [p * 3u + 1u] = to_byte (framebuffer [p].g);
+      rgb [p * 3u + 2u] = to_byte (framebuffer [p].b);
+    }
+
+    std::FILE* file = std::fopen (path, "wb");
+    if (!file)
+    {
+      return false;
+    }
+    bool const is_written = is_png ? write_png (file, rgb) : write_ppm (file, rgb);
+    return std::fclose (file) == 0 && is_written;
+  }
+
+  void release (void)
+  {
+    workers.release ();
+    framebuffer = {};
+    binned = {};
+    pixel_of = {};
+  }
+
+  unsigned get_width (void) const { return width; }
+  unsigned get_height (void) const { return height; }
+  raster_pixel_t const* get_pixels (void) const { return framebuffer.data (); }
+
+
+private:
+  static unsigned const OFF_SCREEN = 0xffffffffu;
+
+  /// @brief which pixel a point covers, pigeon's origin is the centre of the screen with +ve y up
+  /// @return false if the point is off screen
+  bool pixel_index (pigeon::gfx::headless::point_vertex_t const& point, unsigned& pixel) const
+  {
+    float const column = point.x + (float)width * .5f;
+    float const row = (float)height * .5f - point.y;
+    if (!(column >= 0.f && column < (float)width && row >= 0.f && row < (float)height)) // also rejects NaNs
+    {
+      return false;
+    }
+    pixel = (unsigned)row * width + (unsigned)column;
+    return true;
+  }
+
+  /// @brief source over: destination = destination + (source - destination) * source alpha, all 4 channels at once
+  static void blend (raster_pixel_t& destination, vec4 const& colour)
+  {
+#if RASTERISER_USE_SSE2
+    __m128 const source = _mm_set_ps (colour.w, colour.z, colour.y, colour.x);
+    __m128 const alpha = _mm_shuffle_ps (source, source, _MM_SHUFFLE (3, 3, 3, 3));
+    __m128 const current = _mm_load_ps (&destination.r);
+    _mm_store_ps (&destination.r, _mm_add_ps (current, _mm_mul_ps (_mm_sub_ps (source, current), alpha)));
+#else
+    float const alpha = colour.w;
+    destination.r += (colour.x - destination.r) * alpha;
+    destination.g += (colour.y - destination.g) * alpha;
+    destination.b += (colour.z - destination.b) * alpha;
+    destination.a += (colour.w - destination.a) * alpha;
+#endif
+  }
+
+  /// @brief run function (worker) on every worker & wait for them all
+  template <typename function_t>
+  void run_workers (function_t const& function)
+  {
+    workers.run (num_threads, function);
+  }
+
+  static uint8_t to_byte (float value)
+  {
+    return (uint8_t)(cuckoo::maths::min (cuckoo::maths::max (value, 0.f), 1.f) * 255.f + .5f);
+  }
+
+
+  // IMAGE FILES
+
+  bool write_ppm (std::FILE* file, std::vector <uint8_t> const& rgb) const
+  {
+    std::fprintf (file, "P6\n%u %u\n255\n", width, height);
+    return std::fwrite (rgb.data (), 1u, rgb.size (), file) == rgb.size ();
+  }
+
+  /// @brief an uncompressed PNG: the image data is zlib wrapped but only uses 'stored' deflate blocks, so no compressor is needed
+  bool write_png (std::FILE* file, std::vector <uint8_t> const& rgb) const
+  {
+    // every row starts with its filter type, 0 = none
+    size_t const row_bytes = (size_t)width * 3u;
+    std::vector <uint8_t> raw;
+    raw.reserve ((row_bytes + 1u) * height);
+    for (unsigned row = 0u; row < height; ++row)
+    {
+      raw.push_back (0u);
+      raw.insert (raw.end (), rgb.begin () + row * row_bytes, rgb.begin () + (row + 1u) * row_bytes);
+    }
+
+    std::vector <uint8_t> zlib = { 0x78u, 0x01u };
+    for (size_t offset = 0u; ; offset += 65535u)
+    {
+      size_t const length = cuckoo::maths::min (raw.size () - offset, (size_t)65535u);
+      bool const is_last = offset + length >= raw.size ();
+      zlib.push_back (is_last ? 1u : 0u);
+      zlib.push_back ((uint8_t)length);
+      zlib.push_back ((uint8_t)(length >> 8u));
+      zlib.push_back ((uint8_t)~length);
+      zlib.push_back ((uint8_t)(~length >> 8u));
+      zlib.insert (zlib.end (), raw.begin () + offset, raw.begin () + offset + length);
+      if (is_last)
+      {
+        break;
+      }
+    }
+    append_u32 (zlib, adler32 (raw));
+
+    std::vector <uint8_t> header;
+    append_u32 (header, width);
+    append_u32 (header, height);
+    header.insert (header.end (), { 8u, 2u, 0u, 0u, 0u }); // 8 bits per channel, RGB, deflate, no filtering, not interlaced
+
+    static uint8_t const signature [8] = { 0x89u, 'P', 'N', 'G', '\r', '\n', 0x1au, '\n' };
+    return std::fwrite (signature, 1u, sizeof (signature), file) == sizeof (signature)
+      && write_png_chunk (file, "IHDR", header)
+      && write_png_chunk (file, "IDAT", zlib)
+      && write_png_chunk (file, "IEND", {});
+  }
+
+  static bool write_png_chunk (std::FILE* file, char const type [4], std::vector <uint8_t> const& data)
+  {
+    std::vector <uint8_t> chunk;
+    append_u32 (chunk, (uint32_t)data.size ());
+    chunk.insert (chunk.end (), type, type + 4);
+    chunk.insert (chunk.end (), data.begin (), data.end ());
+    append_u32 (chunk, crc32 (chunk.data () + 4u, chunk.size () - 4u)); // over the type & data, not the length
+    return std::fwrite (chunk.data (), 1u, chunk.size (), file) == chunk.size ();
+  }
+
+  static void append_u32 (std::vector <uint8_t>& bytes, uint32_t value)
+  {
+    bytes.insert (bytes.end (), { (uint8_t)(value >> 24u), (uint8_t)(value >> 16u), (uint8_t)(value >> 8u), (uint8_t)value });
+  }
+
+  static uint32_t crc32 (uint8_t const* bytes, size_t count)
+  {
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0u; i < count; ++i)
+    {
+      crc ^= bytes [i];
+      for (unsigned bit = 0u; bit < 8u; ++bit)
+      {
+        crc = (crc >> 1u) ^ (0xedb88320u & (0u - (crc & 1u)));
+      }
+    }
+    return ~crc;
+  }
+
+  static uint32_t adler32 (std::vector <uint8_t> const& bytes)
+  {
+    uint32_t a = 1u;
+    uint32_t b = 0u;
+    for (uint8_t byte : bytes)
+    {
+      a = (a + byte) % 65521u;
+      b = (b + a) % 65521u;
+    }
+    return (b << 16u) | a;
+  }
+
+  unsigned width = 0u;
+  unsigned height = 0u;
+  unsigned num_threads = 1u;
+  raster_pixel_t clear_colour = { 0.f, 0.f, 0.f, 1.f };
+
+  std::vector <raster_pixel_t>  framebuffer; // width * height, top row first
+  std::vector <raster_binned_t> binned;      // grouped by band, in submission order within each band
+  std::vector <unsigned>        pixel_of;    // each point's pixel (OFF_SCREEN if culled), written by COUNT & read by SCATTER
+
+  worker_pool_t workers;
+
+  unsigned bin_counts [MAX_THREADS][MAX_THREADS] = {};  // [chunk][band]
+  unsigned bin_offsets [MAX_THREADS][MAX_THREADS] = {}; // [chunk][band]
+  unsigned band_begin [MAX_THREADS + 1u] = {};
+};